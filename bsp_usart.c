@@ -1,836 +1,3155 @@
-/**
-  ******************************************************************************
-  * @file    bsp_usart.c
-  * @brief   This file provides code for usart operation
-			 bsp_usart V1.0, 2025/4/1
-			 bsp_usart v1.1, 2025/11/24
-				1, Add CM7 DCache support
-				2, Change default DMA size from 16 to 32
-										
-
-  ******************************************************************************
-  * @attention
-  *
-  * Copyright (c) 2025 kripac@163.com
-  * All rights reserved.
-  *
-  * This software is licensed under terms that can be found in the LICENSE file
-  * in the root directory of this software component.
-  * If no LICENSE file comes with this software, it is provided AS-IS.
-  * 
-  ******************************************************************************
-  */
-
-/* Includes ------------------------------------------------------------------*/
-#include "bsp_usart.h"
-#include "cmsis_os.h"
-#include "usart.h"
-
-/* Private defines -----------------------------------------------------------*/
-#define CACHE_SUPPORT
-
-/* USART1 --------------------------------------------------------------------*/
-#ifdef USE_USART1
-
-#define UART1_RX_DMA_BUF_LEN	(32u)
-#define UART1_RX_RB_LEN			(129u)			// Recommend: 2^n + 1 bytes
-
-
-extern osSemaphoreId_t	Usart1RxSemHandle;
-
-/* DMA buffer */
-uint8_t	usart1_rx_dma_buf[UART1_RX_DMA_BUF_LEN] __attribute__((aligned(32)));
-
-/* LwRB instance and buffer */
-lwrb_t	usart1_rx_rb;							// Ring buffer instance for RX data
-uint8_t	usart1_rx_rb_data[UART1_RX_RB_LEN];		// Ring buffer data array for RX DMA
-
-
-/**
-  * @brief  Usr defined Rx Event Callback
-  * @param  huart UART handle.
-  * @param	received data size
-  * @retval None
-  */
-void USART1_RxEventCb(UART_HandleTypeDef *huart, uint16_t size)
-{
-	UNUSED(size);	
-	static uint16_t	pos_last;
-	uint16_t		pos;
-	
-	#ifdef CACHE_SUPPORT
-	/* Invalidate DCache for CM7 core */
-	SCB_InvalidateDCache_by_Addr((uint32_t *)&usart1_rx_dma_buf, sizeof(usart1_rx_dma_buf));
-	#endif
-	
-	pos = sizeof(usart1_rx_dma_buf) - __HAL_DMA_GET_COUNTER(huart->hdmarx);
-	if (pos != pos_last)
-	{
-		if (pos > pos_last)
-		{	/* Current position is over previous one */
-			/*
-			 * Processing is done in "linear" mode.
-			 *
-			 * Application processing is fast with single data block,
-			 * length is simply calculated by subtracting pointers
-			 *
-			 * [   0   ]
-			 * [   1   ] <- old_pos |------------------------------------|
-			 * [   2   ]            |                                    |
-			 * [   3   ]            | Single block (len = pos - old_pos) |
-			 * [   4   ]            |                                    |
-			 * [   5   ]            |------------------------------------|
-			 * [   6   ] <- pos
-			 * [   7   ]
-			 * [ N - 1 ]
-			 */
-			if (lwrb_write(&usart1_rx_rb, &usart1_rx_dma_buf[pos_last], pos - pos_last) == NULL)
-			{
-				#ifdef __ENABLE_SHELL
-				printf("usart1 lwrb write fail!\r\n");
-				#endif
-			}
-		}
-		else if (pos < pos_last)
-		{
-			/* "overflow" mode..
-			 *
-			 * Application must process data twice,
-			 * since there are 2 linear memory blocks to handle
-			 *
-			 * [   0   ]            |---------------------------------|
-			 * [   1   ]            | Second block (len = pos)        |
-			 * [   2   ]            |---------------------------------|
-			 * [   3   ] <- pos
-			 * [   4   ] <- old_pos |---------------------------------|
-			 * [   5   ]            |                                 |
-			 * [   6   ]            | First block (len = N - old_pos) |
-			 * [   7   ]            |                                 |
-			 * [ N - 1 ]            |---------------------------------|
-			 */
-			if (lwrb_write(&usart1_rx_rb, &usart1_rx_dma_buf[pos_last], sizeof(usart1_rx_dma_buf) - pos_last) == NULL)
-			{
-				#ifdef __ENABLE_SHELL
-				printf("usart1 lwrb write fail!\r\n");
-				#endif
-			}
-			
-			if (pos > 0)	/* Second block process */
-			{
-				if (lwrb_write(&usart1_rx_rb, &usart1_rx_dma_buf[0], pos) == NULL)
-				{
-					#ifdef __ENABLE_SHELL
-					printf("usart1 lwrb write fail!\r\n");
-					#endif
-				}
-			}
-		}
-		pos_last = pos;		/* Save current position as old for next transfers */
-	}	/* if (pos != pos_last) */
-	
-	switch (huart->RxEventType)
-	{
-		case HAL_UART_RXEVENT_IDLE:
-			osSemaphoreRelease(Usart1RxSemHandle);
-			break;		
-		
-		case HAL_UART_RXEVENT_TC: 
-			break;
-		
-		case HAL_UART_RXEVENT_HT:
-			break;
-		
-		default:
-			#ifdef __ENABLE_SHELL
-			printf("RxEventType Error!\r\n");
-			#endif
-			break;
-	}
-}
-
-/**
-  * @brief  UART error callback.
-  * @param  huart UART handle.
-  * @retval None
-  */
-void USART1_ErrorCb(UART_HandleTypeDef *huart)
-{
-	#ifdef __ENABLE_SHELL
-	printf("USART1 Error!\r\n");
-	#endif
-	
-	if (huart == &huart1)
-	{
-		/* Uart1 connected to master serial port */
-
-		/* Clear error flag */
-		__HAL_UART_CLEAR_FLAG(huart, UART_CLEAR_CMF);		//Character Match Clear Flag
-		__HAL_UART_CLEAR_FLAG(huart, UART_CLEAR_IDLEF);		//IDLE line detected Clear Flag
-		
-		/* Not sure if it's useful */
-		__HAL_UART_CLEAR_FLAG(huart, UART_CLEAR_OREF);		//Overrun Error Clear Flag
-		__HAL_UART_CLEAR_FLAG(huart, UART_CLEAR_FEF);		//Framing Error Clear Flag
-		
-		/* Not sure if it's useful */
-		__HAL_UART_CLEAR_FLAG(huart, UART_CLEAR_PEF);		//Parity Error Clear Flag
-		__HAL_UART_CLEAR_FLAG(huart, UART_CLEAR_NEF);		//Noise detected Clear Flag
-		
-		
-		//__HAL_UNLOCK(huart);
-		HAL_UARTEx_ReceiveToIdle_DMA(huart, usart1_rx_dma_buf, sizeof(usart1_rx_dma_buf));
-	}
-	else
-	{
-		#ifdef __ENABLE_SHELL
-		printf("Other USART1 Error!\r\n");
-		#endif
-	}
-}
-
-/**
-  * @brief  UART1 Init
-  * @param  None
-  * @retval None
-  *			Uart should config to DMA Rx circular mode and enable interrupt
-  */
-void USART1_Init(void)
-{
-	/* Init LwRB ring fifo */
-	lwrb_init(&usart1_rx_rb, usart1_rx_rb_data, sizeof(usart1_rx_rb_data));
-	
-	/* Register rx event call back */
-	HAL_UART_RegisterRxEventCallback(&huart1, USART1_RxEventCb);
-	
-	/* Register error call back */
-	HAL_UART_RegisterCallback(&huart1, HAL_UART_ERROR_CB_ID, USART1_ErrorCb);
-	
-	/* Start UART */
-	HAL_UARTEx_ReceiveToIdle_DMA(&huart1, usart1_rx_dma_buf, sizeof(usart1_rx_dma_buf));
-	
-	/* Disable error interrupt to prevent unexpected crashes*/
-	#if 1
-	ATOMIC_CLEAR_BIT(huart1.Instance->CR3, USART_CR3_EIE);
-	//ATOMIC_CLEAR_BIT(huart->Instance->CR3, USART_CR3_EIE);
-	#endif
-}
-
-/**
-  * @brief  Block mode receive N byte until timeout
-  * @param  huart UART handle.
-  * @param	received data size
-  * @retval None
-  */
-HAL_StatusTypeDef USART1_Receive(uint8_t *pData, uint16_t Size, uint32_t Timeout)
-{
-	uint32_t tick_start;
-    if ((pData == NULL) || (Size == 0U))
-    {
-      return  HAL_ERROR;
-    }
-	
-    /* Init tickstart for timeout management */
-    tick_start = HAL_GetTick();
-	while (lwrb_get_full(&usart1_rx_rb) < Size)
-	{
-		if (((HAL_GetTick() - tick_start) > Timeout) || (Timeout == 0U))
-		{
-			return HAL_TIMEOUT;
-		}
-	}
-	
-	lwrb_read(&usart1_rx_rb, pData, Size);
-	return HAL_OK;
-}
-
-/**
-  * @brief  Receive data from Ring Buffer
-  * @param  Received data
-  * @param	Max data size
-  * @retval Actual received data length
-  */
-uint16_t USART1_ReadRB(uint8_t *pData, uint16_t MaxSize)
-{
-    if ((pData == NULL) || (MaxSize == 0U))
-    {
-      return  0u;
-    }
-	uint16_t RecvSize = lwrb_get_full(&usart1_rx_rb);
-	uint16_t Size = RecvSize < MaxSize ? RecvSize : MaxSize;
-	lwrb_read(&usart1_rx_rb, pData, Size);
-	return Size;
-}
-
-/**
-  * @brief  Clear ring buffer data
-  * @param  None
-  * @retval None
-  */
-void USART1_Reset()
-{
-	/* Reset ring buffer */
-	lwrb_reset(&usart1_rx_rb);
-}
-
-
-HAL_StatusTypeDef USART1_Transmit(const uint8_t *pData, uint16_t Size, uint32_t Timeout)
-{
-	return HAL_UART_Transmit(&huart1, pData, Size, Timeout);
-}
-
-#endif
-
-/* USART2 --------------------------------------------------------------------*/
-#ifdef USE_USART2
-
-#define UART2_RX_DMA_BUF_LEN	(32u)
-#define UART2_RX_RB_LEN			(129u)
-
-
-extern osSemaphoreId_t	Usart2RxSemHandle;
-
-/* DMA buffer */
-uint8_t	usart2_rx_dma_buf[UART2_RX_DMA_BUF_LEN] __attribute__((aligned(32)));
-
-/* LwRB instance and buffer */
-lwrb_t	usart2_rx_rb;							// Ring buffer instance for RX data
-uint8_t	usart2_rx_rb_data[UART2_RX_RB_LEN];		// Ring buffer data array for RX DMA
-
-
-/**
-  * @brief  Usr defined Rx Event Callback
-  * @param  huart UART handle.
-  * @param	received data size
-  * @retval None
-  */
-void USART2_RxEventCb(UART_HandleTypeDef *huart, uint16_t size)
-{
-	UNUSED(size);	
-	static uint16_t	pos_last;
-	uint16_t		pos;
-	
-	#ifdef CACHE_SUPPORT
-	/* Invalidate DCache for CM7 core */
-	SCB_InvalidateDCache_by_Addr((uint32_t *)&usart2_rx_dma_buf, sizeof(usart2_rx_dma_buf));
-	#endif
-	
-	pos = sizeof(usart2_rx_dma_buf) - __HAL_DMA_GET_COUNTER(huart->hdmarx);
-	if (pos != pos_last)
-	{
-		if (pos > pos_last)
-		{	/* Current position is over previous one */
-			/*
-			 * Processing is done in "linear" mode.
-			 *
-			 * Application processing is fast with single data block,
-			 * length is simply calculated by subtracting pointers
-			 *
-			 * [   0   ]
-			 * [   1   ] <- old_pos |------------------------------------|
-			 * [   2   ]            |                                    |
-			 * [   3   ]            | Single block (len = pos - old_pos) |
-			 * [   4   ]            |                                    |
-			 * [   5   ]            |------------------------------------|
-			 * [   6   ] <- pos
-			 * [   7   ]
-			 * [ N - 1 ]
-			 */
-			if (lwrb_write(&usart2_rx_rb, &usart2_rx_dma_buf[pos_last], pos - pos_last) == NULL)
-			{
-				#ifdef __ENABLE_SHELL
-				printf("usart2 lwrb write fail!\r\n");
-				#endif
-			}
-		}
-		else if (pos < pos_last)
-		{
-			/* "overflow" mode..
-			 *
-			 * Application must process data twice,
-			 * since there are 2 linear memory blocks to handle
-			 *
-			 * [   0   ]            |---------------------------------|
-			 * [   1   ]            | Second block (len = pos)        |
-			 * [   2   ]            |---------------------------------|
-			 * [   3   ] <- pos
-			 * [   4   ] <- old_pos |---------------------------------|
-			 * [   5   ]            |                                 |
-			 * [   6   ]            | First block (len = N - old_pos) |
-			 * [   7   ]            |                                 |
-			 * [ N - 1 ]            |---------------------------------|
-			 */
-			if (lwrb_write(&usart2_rx_rb, &usart2_rx_dma_buf[pos_last], sizeof(usart2_rx_dma_buf) - pos_last) == NULL)
-			{
-				#ifdef __ENABLE_SHELL
-				printf("usart2 lwrb write fail!\r\n");
-				#endif
-			}
-			
-			if (pos > 0)	/* Second block process */
-			{
-				if (lwrb_write(&usart2_rx_rb, &usart2_rx_dma_buf[0], pos) == NULL)
-				{
-					#ifdef __ENABLE_SHELL
-					printf("usart2 lwrb write fail!\r\n");
-					#endif
-				}
-			}
-		}
-		pos_last = pos;		/* Save current position as old for next transfers */
-	}	/* if (pos != pos_last) */
-	
-	switch (huart->RxEventType)
-	{
-		case HAL_UART_RXEVENT_IDLE:
-			osSemaphoreRelease(Usart2RxSemHandle);
-			break;		
-		
-		case HAL_UART_RXEVENT_TC: 
-			break;
-		
-		case HAL_UART_RXEVENT_HT:
-			break;
-		
-		default:
-			#ifdef __ENABLE_SHELL
-			printf("RxEventType Error!\r\n");
-			#endif
-			break;
-	}
-}
-
-/**
-  * @brief  UART error callback.
-  * @param  huart UART handle.
-  * @retval None
-  */
-void USART2_ErrorCb(UART_HandleTypeDef *huart)
-{
-	#ifdef __ENABLE_SHELL
-	printf("USART2 Error!\r\n");
-	#endif
-	
-	if (huart == &huart2)
-	{
-		/* Uart2 connected to master serial port */
-
-		/* Clear error flag */
-		__HAL_UART_CLEAR_FLAG(huart, UART_CLEAR_CMF);		//Character Match Clear Flag
-		__HAL_UART_CLEAR_FLAG(huart, UART_CLEAR_IDLEF);		//IDLE line detected Clear Flag
-		
-		/* Not sure if it's useful */
-		__HAL_UART_CLEAR_FLAG(huart, UART_CLEAR_OREF);		//Overrun Error Clear Flag
-		__HAL_UART_CLEAR_FLAG(huart, UART_CLEAR_FEF);		//Framing Error Clear Flag
-		
-		/* Not sure if it's useful */
-		__HAL_UART_CLEAR_FLAG(huart, UART_CLEAR_PEF);		//Parity Error Clear Flag
-		__HAL_UART_CLEAR_FLAG(huart, UART_CLEAR_NEF);		//Noise detected Clear Flag
-		
-		
-		//__HAL_UNLOCK(huart);
-		HAL_UARTEx_ReceiveToIdle_DMA(huart, usart2_rx_dma_buf, sizeof(usart2_rx_dma_buf));
-	}
-	else
-	{
-		#ifdef __ENABLE_SHELL
-		printf("Other USART2 Error!\r\n");
-		#endif
-	}
-}
-
-/**
-  * @brief  UART2 Init
-  * @param  None
-  * @retval None
-  *			Uart should config to DMA Rx circular mode and enable interrupt
-  */
-void USART2_Init(void)
-{
-	/* Init LwRB ring fifo */
-	lwrb_init(&usart2_rx_rb, usart2_rx_rb_data, sizeof(usart2_rx_rb_data));
-	
-	/* Register rx event call back */
-	HAL_UART_RegisterRxEventCallback(&huart2, USART2_RxEventCb);
-	
-	/* Register error call back */
-	HAL_UART_RegisterCallback(&huart2, HAL_UART_ERROR_CB_ID, USART2_ErrorCb);
-	
-	/* Start UART */
-	HAL_UARTEx_ReceiveToIdle_DMA(&huart2, usart2_rx_dma_buf, sizeof(usart2_rx_dma_buf));
-	
-	/* Disable error interrupt to prevent unexpected crashes*/
-	#if 1
-	ATOMIC_CLEAR_BIT(huart2.Instance->CR3, USART_CR3_EIE);
-	//ATOMIC_CLEAR_BIT(huart->Instance->CR3, USART_CR3_EIE);
-	#endif
-}
-
-/**
-  * @brief  Block mode receive N byte until timeout
-  * @param  huart UART handle.
-  * @param	received data size
-  * @retval None
-  */
-HAL_StatusTypeDef USART2_Receive(uint8_t *pData, uint16_t Size, uint32_t Timeout)
-{
-	uint32_t tick_start;
-    if ((pData == NULL) || (Size == 0U))
-    {
-      return  HAL_ERROR;
-    }
-	
-    /* Init tickstart for timeout management */
-    tick_start = HAL_GetTick();
-	while (lwrb_get_full(&usart2_rx_rb) < Size)
-	{
-		if (((HAL_GetTick() - tick_start) > Timeout) || (Timeout == 0U))
-		{
-			return HAL_TIMEOUT;
-		}
-	}
-	
-	lwrb_read(&usart2_rx_rb, pData, Size);
-	return HAL_OK;
-}
-
-/**
-  * @brief  Receive data from Ring Buffer
-  * @param  Received data
-  * @param	Max data size
-  * @retval Actual received data length
-  */
-uint16_t USART2_ReadRB(uint8_t *pData, uint16_t MaxSize)
-{
-    if ((pData == NULL) || (MaxSize == 0U))
-    {
-      return  0u;
-    }
-	uint16_t RecvSize = lwrb_get_full(&usart2_rx_rb);
-	uint16_t Size = RecvSize < MaxSize ? RecvSize : MaxSize;
-	lwrb_read(&usart2_rx_rb, pData, Size);
-	return Size;
-}
-
-/**
-  * @brief  Clear ring buffer data
-  * @param  None
-  * @retval None
-  */
-void USART2_Reset()
-{
-	/* Reset ring buffer */
-	lwrb_reset(&usart2_rx_rb);
-}
-
-
-HAL_StatusTypeDef USART2_Transmit(const uint8_t *pData, uint16_t Size, uint32_t Timeout)
-{
-	return HAL_UART_Transmit(&huart2, pData, Size, Timeout);
-}
-
-#endif
-
-/* USART3 --------------------------------------------------------------------*/
-#ifdef USE_USART3
-
-#define UART3_RX_DMA_BUF_LEN	(32u)
-#define UART3_RX_RB_LEN			(129u)
-
-
-extern osSemaphoreId_t	Usart3RxSemHandle;
-
-/* DMA buffer */
-uint8_t	usart3_rx_dma_buf[UART3_RX_DMA_BUF_LEN] __attribute__((aligned(32)));
-
-/* LwRB instance and buffer */
-lwrb_t	usart3_rx_rb;							// Ring buffer instance for RX data
-uint8_t	usart3_rx_rb_data[UART3_RX_RB_LEN];		// Ring buffer data array for RX DMA
-
-
-/**
-  * @brief  Usr defined Rx Event Callback
-  * @param  huart UART handle.
-  * @param	received data size
-  * @retval None
-  */
-void USART3_RxEventCb(UART_HandleTypeDef *huart, uint16_t size)
-{
-	UNUSED(size);	
-	static uint16_t	pos_last;
-	uint16_t		pos;
-	
-	#ifdef CACHE_SUPPORT
-	/* Invalidate DCache for CM7 core */
-	SCB_InvalidateDCache_by_Addr((uint32_t *)&usart3_rx_dma_buf, sizeof(usart3_rx_dma_buf));
-	#endif
-	
-	pos = sizeof(usart3_rx_dma_buf) - __HAL_DMA_GET_COUNTER(huart->hdmarx);
-	if (pos != pos_last)
-	{
-		if (pos > pos_last)
-		{	/* Current position is over previous one */
-			/*
-			 * Processing is done in "linear" mode.
-			 *
-			 * Application processing is fast with single data block,
-			 * length is simply calculated by subtracting pointers
-			 *
-			 * [   0   ]
-			 * [   1   ] <- old_pos |------------------------------------|
-			 * [   2   ]            |                                    |
-			 * [   3   ]            | Single block (len = pos - old_pos) |
-			 * [   4   ]            |                                    |
-			 * [   5   ]            |------------------------------------|
-			 * [   6   ] <- pos
-			 * [   7   ]
-			 * [ N - 1 ]
-			 */
-			if (lwrb_write(&usart3_rx_rb, &usart3_rx_dma_buf[pos_last], pos - pos_last) == NULL)
-			{
-				#ifdef __ENABLE_SHELL
-				printf("usart3 lwrb write fail!\r\n");
-				#endif
-			}
-		}
-		else if (pos < pos_last)
-		{
-			/* "overflow" mode..
-			 *
-			 * Application must process data twice,
-			 * since there are 2 linear memory blocks to handle
-			 *
-			 * [   0   ]            |---------------------------------|
-			 * [   1   ]            | Second block (len = pos)        |
-			 * [   2   ]            |---------------------------------|
-			 * [   3   ] <- pos
-			 * [   4   ] <- old_pos |---------------------------------|
-			 * [   5   ]            |                                 |
-			 * [   6   ]            | First block (len = N - old_pos) |
-			 * [   7   ]            |                                 |
-			 * [ N - 1 ]            |---------------------------------|
-			 */
-			if (lwrb_write(&usart3_rx_rb, &usart3_rx_dma_buf[pos_last], sizeof(usart3_rx_dma_buf) - pos_last) == NULL)
-			{
-				#ifdef __ENABLE_SHELL
-				printf("usart3 lwrb write fail!\r\n");
-				#endif
-			}
-			
-			if (pos > 0)	/* Second block process */
-			{
-				if (lwrb_write(&usart3_rx_rb, &usart3_rx_dma_buf[0], pos) == NULL)
-				{
-					#ifdef __ENABLE_SHELL
-					printf("usart3 lwrb write fail!\r\n");
-					#endif
-				}
-			}
-		}
-		pos_last = pos;		/* Save current position as old for next transfers */
-	}	/* if (pos != pos_last) */
-	
-	switch (huart->RxEventType)
-	{
-		case HAL_UART_RXEVENT_IDLE:
-			osSemaphoreRelease(Usart3RxSemHandle);
-			break;		
-		
-		case HAL_UART_RXEVENT_TC: 
-			break;
-		
-		case HAL_UART_RXEVENT_HT:
-			break;
-		
-		default:
-			#ifdef __ENABLE_SHELL
-			printf("RxEventType Error!\r\n");
-			#endif
-			break;
-	}
-}
-
-/**
-  * @brief  UART error callback.
-  * @param  huart UART handle.
-  * @retval None
-  */
-void USART3_ErrorCb(UART_HandleTypeDef *huart)
-{
-	#ifdef __ENABLE_SHELL
-	printf("USART3 Error!\r\n");
-	#endif
-	
-	if (huart == &huart3)
-	{
-		/* Uart2 connected to master serial port */
-
-		/* Clear error flag */
-		__HAL_UART_CLEAR_FLAG(huart, UART_CLEAR_CMF);		//Character Match Clear Flag
-		__HAL_UART_CLEAR_FLAG(huart, UART_CLEAR_IDLEF);		//IDLE line detected Clear Flag
-		
-		/* Not sure if it's useful */
-		__HAL_UART_CLEAR_FLAG(huart, UART_CLEAR_OREF);		//Overrun Error Clear Flag
-		__HAL_UART_CLEAR_FLAG(huart, UART_CLEAR_FEF);		//Framing Error Clear Flag
-		
-		/* Not sure if it's useful */
-		__HAL_UART_CLEAR_FLAG(huart, UART_CLEAR_PEF);		//Parity Error Clear Flag
-		__HAL_UART_CLEAR_FLAG(huart, UART_CLEAR_NEF);		//Noise detected Clear Flag
-		
-		
-		//__HAL_UNLOCK(huart);
-		HAL_UARTEx_ReceiveToIdle_DMA(huart, usart3_rx_dma_buf, sizeof(usart3_rx_dma_buf));
-	}
-	else
-	{
-		#ifdef __ENABLE_SHELL
-		printf("Other USART3 Error!\r\n");
-		#endif
-	}
-}
-
-/**
-  * @brief  UART3 Init
-  * @param  None
-  * @retval None
-  *			Uart should config to DMA Rx circular mode and enable interrupt
-  */
-void USART3_Init(void)
-{
-	/* Init LwRB ring fifo */
-	lwrb_init(&usart3_rx_rb, usart3_rx_rb_data, sizeof(usart3_rx_rb_data));
-	
-	/* Register rx event call back */
-	HAL_UART_RegisterRxEventCallback(&huart3, USART3_RxEventCb);
-	
-	/* Register error call back */
-	HAL_UART_RegisterCallback(&huart3, HAL_UART_ERROR_CB_ID, USART3_ErrorCb);
-	
-	/* Start UART */
-	HAL_UARTEx_ReceiveToIdle_DMA(&huart3, usart3_rx_dma_buf, sizeof(usart3_rx_dma_buf));
-	
-	/* Disable error interrupt to prevent unexpected crashes*/
-	#if 1
-	ATOMIC_CLEAR_BIT(huart3.Instance->CR3, USART_CR3_EIE);
-	//ATOMIC_CLEAR_BIT(huart->Instance->CR3, USART_CR3_EIE);
-	#endif
-}
-
-/**
-  * @brief  Block mode receive N byte until timeout
-  * @param  huart UART handle.
-  * @param	received data size
-  * @retval None
-  */
-HAL_StatusTypeDef USART3_Receive(uint8_t *pData, uint16_t Size, uint32_t Timeout)
-{
-	uint32_t tick_start;
-    if ((pData == NULL) || (Size == 0U))
-    {
-      return  HAL_ERROR;
-    }
-	
-    /* Init tickstart for timeout management */
-    tick_start = HAL_GetTick();
-	while (lwrb_get_full(&usart3_rx_rb) < Size)
-	{
-		if (((HAL_GetTick() - tick_start) > Timeout) || (Timeout == 0U))
-		{
-			return HAL_TIMEOUT;
-		}
-	}
-	
-	lwrb_read(&usart3_rx_rb, pData, Size);
-	return HAL_OK;
-}
-
-/**
-  * @brief  Receive data from Ring Buffer
-  * @param  Received data
-  * @param	Max data size
-  * @retval Actual received data length
-  */
-uint16_t USART3_ReadRB(uint8_t *pData, uint16_t MaxSize)
-{
-    if ((pData == NULL) || (MaxSize == 0U))
-    {
-      return  0u;
-    }
-	uint16_t RecvSize = lwrb_get_full(&usart3_rx_rb);
-	uint16_t Size = RecvSize < MaxSize ? RecvSize : MaxSize;
-	lwrb_read(&usart3_rx_rb, pData, Size);
-	return Size;
-}
-
-/**
-  * @brief  Clear ring buffer data
-  * @param  None
-  * @retval None
-  */
-void USART3_Reset()
-{
-	/* Reset ring buffer */
-	lwrb_reset(&usart3_rx_rb);
-}
-
-
-HAL_StatusTypeDef USART3_Transmit(const uint8_t *pData, uint16_t Size, uint32_t Timeout)
-{
-	return HAL_UART_Transmit(&huart3, pData, Size, Timeout);
-}
-
-#endif
-
-
-
-
-///**
-//  * @brief  Repeat mode start.
-//  * @param  None
-//  * @retval None
-//  */
-//void UART_IT_Start()
-//{
-//	__HAL_UART_ENABLE_IT(&huart1, UART_IT_RXNE);
-//	__HAL_UART_ENABLE_IT(&huart3, UART_IT_RXNE);
-//	
-//	ATOMIC_CLEAR_BIT(huart1.Instance->CR3, USART_CR3_EIE);
-//	ATOMIC_CLEAR_BIT(huart3.Instance->CR3, USART_CR3_EIE);
-//}
-
-
-/* Redefine fputc() to use UART1 for printf() function */
-/* ---------------------------------------------------------------------------*/
-#if 0
-/* UART1 */
-#define AC6_ENABLE
-
-#ifdef AC6_ENABLE
-__ASM(".global __use_no_semihosting");
-#else
-#pragma import(__use_no_semihosting)
-struct __FILE
-{
-    int handle;
-};
-#endif
-
-FILE __stdout;
-
-/* Define _sys_exit() to avoid using half-host mode */
-void _sys_exit(int x)
-{
-    x = x;
-}
-/* Redefine fputc */
-int fputc(int ch, FILE *f)
-{
-    //ITM_SendChar(ch);
-	HAL_UART_Transmit(&huart1, (uint8_t *)&ch, 1, 10);
-    return ch;
-}
-/* __use_no_semihosting was requested, but _ttywrch was */
-void _ttywrch(int ch)
-{
-    ch = ch;
-}
-#endif
-
+/**
+  ******************************************************************************
+  * @file    bsp_usart.c
+  * @brief   This file provides code for usart operation
+			 bsp_usart V1.0, 2025/4/1
+			 bsp_usart v1.1, 2025/11/24
+				1, Add CM7 DCache support
+				2, Change default DMA size from 16 to 32
+			 bsp_usart v1.2, 2026/10/16
+				1, Table driven port engine, one RxEventCb/ErrorCb for all ports
+				2, Non-blocking transmit through DMA drained TX queue
+				3, Zero copy peek/skip read API
+				4, Direct RX mode, DMA buffer used as ring buffer
+				5, Receive sleeps on thread flag instead of polling
+				6, RX watermark notification on HT/TC events
+				7, Per port statistics and health counters
+				8, Optional callback execution time profiling
+				9, Character match framing with frame queue
+				10, Receiver timeout framing, Modbus RTU with CRC check
+				11, Running RX CRC accumulated per DMA block
+				12, Selectable DCache strategy, range invalidate by default
+				13, Baud rate aware buffer sizing, adaptive RX watermark
+				14, Double buffer DMA reception with in place blocks
+				15, Wait on several ports from one task with event flags
+				16, Non blocking all or nothing transmit, panic flush, log backend
+				17, RX event timestamps, read with byte arrival times
+				18, Error interrupts stay enabled, lossless recovery and error report
+				19, RTS flow control driven by ring buffer level
+				20, Several independent readers of one port stream
+				21, RX forwarding to the other core of dual core parts
+				22, Asynchronous receive requests with completion callback
+										
+
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 kripac@163.com
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  * 
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "bsp_usart.h"
+#include "bsp_usart_crc.h"
+#include "cmsis_os.h"
+#include "usart.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+
+#if (USART_CACHE_MODE == USART_CACHE_FULL) || (USART_CACHE_MODE == USART_CACHE_RANGE)
+#define CACHE_SUPPORT
+#endif
+
+/* BSP_USART_Poll() event flags hold one bit per port table entry */
+#define USART_POLL_MAX_PORTS	(24u)
+
+/*
+ * Buffer auto sizing, used by ports with non zero UARTx_RX_POOL_LEN.
+ * DMA buffer gives HT/TC events no more often than USART_DMA_EVT_US, ring
+ * buffer holds what arrives while consumer is USART_RX_LATENCY_US late.
+ */
+#ifndef USART_DMA_EVT_US
+#define USART_DMA_EVT_US		(200u)
+#endif
+#ifndef USART_RX_LATENCY_US
+#define USART_RX_LATENCY_US		(5000u)
+#endif
+
+/* TX queue length of each port, 0 fall back to polling HAL_UART_Transmit */
+#ifndef USART_TX_RB_LEN_DEFAULT
+#define USART_TX_RB_LEN_DEFAULT	(256u)
+#endif
+
+/* Modbus RTU inter frame gap, 3.5 characters or fixed above 19200 baud */
+#define MODBUS_GAP_X10			(35u)
+#define MODBUS_GAP_US			(1750u)
+#define MODBUS_GAP_BAUD			(19200u)
+#define MODBUS_FRAME_MIN		(4u)			// Address, function code and CRC
+
+#ifndef UART1_RX_DMA_BUF_LEN
+#define UART1_RX_DMA_BUF_LEN	(32u)
+#endif
+#ifndef UART1_RX_RB_LEN
+#define UART1_RX_RB_LEN			(129u)			// Recommend: 2^n + 1 bytes, 0 use DMA buffer as ring buffer
+#endif
+#ifndef UART1_TX_RB_LEN
+#define UART1_TX_RB_LEN			USART_TX_RB_LEN_DEFAULT
+#endif
+#ifndef UART1_RX_POOL_LEN
+#define UART1_RX_POOL_LEN		(0u)			// Non zero: DMA and ring buffer are sized at init and carved from it
+#endif
+
+#ifndef UART2_RX_DMA_BUF_LEN
+#define UART2_RX_DMA_BUF_LEN	(32u)
+#endif
+#ifndef UART2_RX_RB_LEN
+#define UART2_RX_RB_LEN			(129u)
+#endif
+#ifndef UART2_TX_RB_LEN
+#define UART2_TX_RB_LEN			USART_TX_RB_LEN_DEFAULT
+#endif
+#ifndef UART2_RX_POOL_LEN
+#define UART2_RX_POOL_LEN		(0u)
+#endif
+
+#ifndef UART3_RX_DMA_BUF_LEN
+#define UART3_RX_DMA_BUF_LEN	(32u)
+#endif
+#ifndef UART3_RX_RB_LEN
+#define UART3_RX_RB_LEN			(129u)
+#endif
+#ifndef UART3_TX_RB_LEN
+#define UART3_TX_RB_LEN			USART_TX_RB_LEN_DEFAULT
+#endif
+#ifndef UART3_RX_POOL_LEN
+#define UART3_RX_POOL_LEN		(0u)
+#endif
+
+#ifndef UART4_RX_DMA_BUF_LEN
+#define UART4_RX_DMA_BUF_LEN	(32u)
+#endif
+#ifndef UART4_RX_RB_LEN
+#define UART4_RX_RB_LEN			(129u)
+#endif
+#ifndef UART4_TX_RB_LEN
+#define UART4_TX_RB_LEN			USART_TX_RB_LEN_DEFAULT
+#endif
+#ifndef UART4_RX_POOL_LEN
+#define UART4_RX_POOL_LEN		(0u)
+#endif
+
+#ifndef UART5_RX_DMA_BUF_LEN
+#define UART5_RX_DMA_BUF_LEN	(32u)
+#endif
+#ifndef UART5_RX_RB_LEN
+#define UART5_RX_RB_LEN			(129u)
+#endif
+#ifndef UART5_TX_RB_LEN
+#define UART5_TX_RB_LEN			USART_TX_RB_LEN_DEFAULT
+#endif
+#ifndef UART5_RX_POOL_LEN
+#define UART5_RX_POOL_LEN		(0u)
+#endif
+
+#ifndef UART6_RX_DMA_BUF_LEN
+#define UART6_RX_DMA_BUF_LEN	(32u)
+#endif
+#ifndef UART6_RX_RB_LEN
+#define UART6_RX_RB_LEN			(129u)
+#endif
+#ifndef UART6_TX_RB_LEN
+#define UART6_TX_RB_LEN			USART_TX_RB_LEN_DEFAULT
+#endif
+#ifndef UART6_RX_POOL_LEN
+#define UART6_RX_POOL_LEN		(0u)
+#endif
+
+#ifndef UART7_RX_DMA_BUF_LEN
+#define UART7_RX_DMA_BUF_LEN	(32u)
+#endif
+#ifndef UART7_RX_RB_LEN
+#define UART7_RX_RB_LEN			(129u)
+#endif
+#ifndef UART7_TX_RB_LEN
+#define UART7_TX_RB_LEN			USART_TX_RB_LEN_DEFAULT
+#endif
+#ifndef UART7_RX_POOL_LEN
+#define UART7_RX_POOL_LEN		(0u)
+#endif
+
+#ifndef UART8_RX_DMA_BUF_LEN
+#define UART8_RX_DMA_BUF_LEN	(32u)
+#endif
+#ifndef UART8_RX_RB_LEN
+#define UART8_RX_RB_LEN			(129u)
+#endif
+#ifndef UART8_TX_RB_LEN
+#define UART8_TX_RB_LEN			USART_TX_RB_LEN_DEFAULT
+#endif
+#ifndef UART8_RX_POOL_LEN
+#define UART8_RX_POOL_LEN		(0u)
+#endif
+
+#ifndef LPUART1_RX_DMA_BUF_LEN
+#define LPUART1_RX_DMA_BUF_LEN	(32u)
+#endif
+#ifndef LPUART1_RX_RB_LEN
+#define LPUART1_RX_RB_LEN		(129u)
+#endif
+#ifndef LPUART1_TX_RB_LEN
+#define LPUART1_TX_RB_LEN		USART_TX_RB_LEN_DEFAULT
+#endif
+#ifndef LPUART1_RX_POOL_LEN
+#define LPUART1_RX_POOL_LEN		(0u)
+#endif
+
+/* Private macro -------------------------------------------------------------*/
+
+/* Cache maintenance by address must not touch lines shared with other data */
+#ifdef CACHE_SUPPORT
+#define USART_CACHE_ASSERT(name, dma_len, tx_len, pool_len)						\
+	_Static_assert(((dma_len) % USART_CACHE_LINE) == 0u, #name " RX DMA buffer must be whole cache lines");	\
+	_Static_assert(((pool_len) % USART_CACHE_LINE) == 0u, #name " RX pool must be whole cache lines");		\
+	_Static_assert(((tx_len) % USART_CACHE_LINE) == 0u, #name " TX queue must be whole cache lines");		\
+	_Static_assert((__alignof__(name##_rx_dma_buf) % USART_CACHE_LINE) == 0u, #name " RX DMA buffer alignment"); \
+	_Static_assert((__alignof__(name##_tx_rb_data) % USART_CACHE_LINE) == 0u, #name " TX queue alignment")
+#else
+#define USART_CACHE_ASSERT(name, dma_len, tx_len, pool_len)						\
+	_Static_assert(1, "")
+#endif
+
+/*
+ * Define DMA buffer, ring buffer data arrays and port descriptor of one port.
+ * DMA and TX queue buffers are cache line aligned and placed by USART_CACHE_MODE.
+ * With a RX pool, DMA and ring buffer are carved from it at init instead.
+ */
+#define USART_PORT_DEFINE(name, handle, sem, dma_len, rb_len, tx_len, pool_len)	\
+	extern osSemaphoreId_t	sem;												\
+	uint8_t	name##_rx_dma_buf[(pool_len) ? 1u : (dma_len)] USART_DMA_MEM;		\
+	uint8_t	name##_rx_rb_data[((pool_len) || !(rb_len)) ? 1u : (rb_len)];		\
+	uint8_t	name##_rx_pool[(pool_len) ? (pool_len) : 1u] USART_DMA_MEM;			\
+	uint8_t	name##_tx_rb_data[(tx_len) ? (tx_len) : 1u] USART_DMA_MEM;			\
+	USART_CACHE_ASSERT(name, dma_len, tx_len, pool_len);						\
+	BSP_USART_Port_t name##_port =												\
+	{																			\
+		.huart		= &handle,													\
+		.rx_dma_buf	= name##_rx_dma_buf,										\
+		.rx_dma_len	= (dma_len),												\
+		.rx_rb_data	= name##_rx_rb_data,										\
+		.rx_rb_len	= (rb_len),													\
+		.rx_sem		= &sem,														\
+		.tx_rb_data	= name##_tx_rb_data,										\
+		.tx_rb_len	= (tx_len),													\
+		.rx_pool	= (pool_len) ? name##_rx_pool : NULL,						\
+		.rx_pool_len = (pool_len),												\
+	}
+
+/* Enter/exit interrupt critical section, nestable */
+#define USART_ENTER_CRITICAL()	uint32_t primask_bit = __get_PRIMASK(); __disable_irq()
+#define USART_EXIT_CRITICAL()	__set_PRIMASK(primask_bit)
+
+/* Per port thin wrappers of generic API */
+#define USART_PORT_WRAPPERS(PORT, name)											\
+	void PORT##_Init(void)														\
+	{																			\
+		BSP_USART_Init(&name##_port);											\
+	}																			\
+	void PORT##_Reset(void)														\
+	{																			\
+		BSP_USART_Reset(&name##_port);											\
+	}																			\
+	HAL_StatusTypeDef PORT##_Transmit(const uint8_t *pData, uint16_t Size, uint32_t Timeout) \
+	{																			\
+		return BSP_USART_Transmit(&name##_port, pData, Size, Timeout);			\
+	}																			\
+	HAL_StatusTypeDef PORT##_Receive(uint8_t *pData, uint16_t Size, uint32_t Timeout) \
+	{																			\
+		return BSP_USART_Receive(&name##_port, pData, Size, Timeout);			\
+	}																			\
+	uint16_t PORT##_ReadRB(uint8_t *pData, uint16_t MaxSize)					\
+	{																			\
+		return BSP_USART_ReadRB(&name##_port, pData, MaxSize);					\
+	}
+
+/* Measure callback execution time */
+#ifdef USART_PROFILE
+#define USART_PROF_START()			uint32_t prof_t0 = BSP_USART_TIMESTAMP()
+#define USART_PROF_END(port, evt)	USART_ProfRecord((port), (evt), BSP_USART_TIMESTAMP() - prof_t0)
+#else
+#define USART_PROF_START()
+#define USART_PROF_END(port, evt)
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+
+#ifdef USE_USART1
+USART_PORT_DEFINE(usart1, huart1, Usart1RxSemHandle, UART1_RX_DMA_BUF_LEN, UART1_RX_RB_LEN, UART1_TX_RB_LEN, UART1_RX_POOL_LEN);
+#endif
+
+#ifdef USE_USART2
+USART_PORT_DEFINE(usart2, huart2, Usart2RxSemHandle, UART2_RX_DMA_BUF_LEN, UART2_RX_RB_LEN, UART2_TX_RB_LEN, UART2_RX_POOL_LEN);
+#endif
+
+#ifdef USE_USART3
+USART_PORT_DEFINE(usart3, huart3, Usart3RxSemHandle, UART3_RX_DMA_BUF_LEN, UART3_RX_RB_LEN, UART3_TX_RB_LEN, UART3_RX_POOL_LEN);
+#endif
+
+#ifdef USE_UART4
+USART_PORT_DEFINE(uart4, huart4, Uart4RxSemHandle, UART4_RX_DMA_BUF_LEN, UART4_RX_RB_LEN, UART4_TX_RB_LEN, UART4_RX_POOL_LEN);
+#endif
+
+#ifdef USE_UART5
+USART_PORT_DEFINE(uart5, huart5, Uart5RxSemHandle, UART5_RX_DMA_BUF_LEN, UART5_RX_RB_LEN, UART5_TX_RB_LEN, UART5_RX_POOL_LEN);
+#endif
+
+#ifdef USE_USART6
+USART_PORT_DEFINE(usart6, huart6, Usart6RxSemHandle, UART6_RX_DMA_BUF_LEN, UART6_RX_RB_LEN, UART6_TX_RB_LEN, UART6_RX_POOL_LEN);
+#endif
+
+#ifdef USE_UART7
+USART_PORT_DEFINE(uart7, huart7, Uart7RxSemHandle, UART7_RX_DMA_BUF_LEN, UART7_RX_RB_LEN, UART7_TX_RB_LEN, UART7_RX_POOL_LEN);
+#endif
+
+#ifdef USE_UART8
+USART_PORT_DEFINE(uart8, huart8, Uart8RxSemHandle, UART8_RX_DMA_BUF_LEN, UART8_RX_RB_LEN, UART8_TX_RB_LEN, UART8_RX_POOL_LEN);
+#endif
+
+#ifdef USE_LPUART1
+USART_PORT_DEFINE(lpuart1, hlpuart1, Lpuart1RxSemHandle, LPUART1_RX_DMA_BUF_LEN, LPUART1_RX_RB_LEN, LPUART1_TX_RB_LEN, LPUART1_RX_POOL_LEN);
+#endif
+
+/* Port table used by the shared callbacks, NULL terminated */
+static BSP_USART_Port_t *const usart_port_tbl[] =
+{
+#ifdef USE_USART1
+	&usart1_port,
+#endif
+#ifdef USE_USART2
+	&usart2_port,
+#endif
+#ifdef USE_USART3
+	&usart3_port,
+#endif
+#ifdef USE_UART4
+	&uart4_port,
+#endif
+#ifdef USE_UART5
+	&uart5_port,
+#endif
+#ifdef USE_USART6
+	&usart6_port,
+#endif
+#ifdef USE_UART7
+	&uart7_port,
+#endif
+#ifdef USE_UART8
+	&uart8_port,
+#endif
+#ifdef USE_LPUART1
+	&lpuart1_port,
+#endif
+	NULL
+};
+
+/* Event flags shared by all ports, created by BSP_USART_PollInit() */
+static osEventFlagsId_t usart_poll_ef = NULL;
+
+/* Task completing asynchronous receives, set by BSP_USART_AsyncRun() */
+static volatile osThreadId_t usart_async_thread = NULL;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Queue a frame which ends at given stream offset
+  * @param  port Port descriptor
+  * @param	end Stream offset after the last byte of frame
+  * @retval None
+  */
+static void USART_FramePush(BSP_USART_Port_t *port, uint32_t end)
+{
+	uint8_t w = port->frame_w;
+	
+	if ((uint8_t)(w - port->frame_r) >= BSP_USART_FRAME_Q_LEN)
+	{	/* Queue full, bytes stay in ring buffer and are skipped by next frame */
+		port->stats.frame_drop++;
+	}
+	else
+	{
+		port->frame_q[w & (BSP_USART_FRAME_Q_LEN - 1u)].offset = port->frame_start;
+		port->frame_q[w & (BSP_USART_FRAME_Q_LEN - 1u)].len = (uint16_t)(end - port->frame_start);
+		port->frame_q[w & (BSP_USART_FRAME_Q_LEN - 1u)].crc = BSP_CRC_Final(port->rx_crc_type, port->rx_crc);
+		port->frame_w = w + 1u;
+	}
+	port->frame_start = end;
+	port->rx_crc = BSP_CRC_Start(port->rx_crc_type);
+}
+
+/**
+  * @brief  Move ring buffer read index to the slowest attached reader
+  * @param  port Port descriptor
+  * @retval None
+  *			Caller blocks interrupts.
+  */
+static void USART_ReaderSync(BSP_USART_Port_t *port)
+{
+	uint32_t	rd_off = port->rx_total - lwrb_get_full(&port->rx_rb);
+	uint32_t	min = port->rx_total;
+	uint8_t		i;
+	
+	for (i = 0u; i < port->reader_num; i++)
+	{
+		if ((port->reader[i]->attached != 0u) && ((int32_t)(port->reader[i]->pos - min) < 0))
+		{
+			min = port->reader[i]->pos;
+		}
+	}
+	if ((int32_t)(min - rd_off) > 0)
+	{
+		lwrb_skip(&port->rx_rb, min - rd_off);
+	}
+}
+
+/**
+  * @brief  Apply reader overrun policies before writing into ring buffer
+  * @param  port Port descriptor
+  * @param	len Bytes about to be written
+  * @retval None
+  *			Readers that would lose data move up or detach, BLOCK readers
+  *			stay and the writer drops what does not fit.
+  */
+static void USART_ReaderMakeRoom(BSP_USART_Port_t *port, uint16_t len)
+{
+	BSP_USART_Reader_t	*rd;
+	uint32_t			floor;
+	uint8_t				i;
+	
+	if (lwrb_get_free(&port->rx_rb) >= len)
+	{
+		return;
+	}
+	
+	/* Oldest stream offset that still fits after the write */
+	floor = port->rx_total + len - (port->rx_rb.size - 1u);
+	if ((int32_t)(floor - port->rx_total) > 0)
+	{
+		floor = port->rx_total;
+	}
+	
+	for (i = 0u; i < port->reader_num; i++)
+	{
+		rd = port->reader[i];
+		if ((rd->attached == 0u) || (rd->policy == BSP_USART_RD_BLOCK) || ((int32_t)(rd->pos - floor) >= 0))
+		{
+			continue;
+		}
+		rd->ovr = 1u;
+		if (rd->policy == BSP_USART_RD_DROP_OLDEST)
+		{
+			rd->drop += floor - rd->pos;
+			rd->pos = floor;
+		}
+		else
+		{
+			rd->attached = 0u;
+		}
+	}
+	USART_ReaderSync(port);
+}
+
+/**
+  * @brief  Wake readers waiting in BSP_USART_ReaderWait()
+  * @param  port Port descriptor
+  * @retval None
+  */
+static void USART_ReaderNotify(BSP_USART_Port_t *port)
+{
+	BSP_USART_Reader_t	*rd;
+	uint8_t				i;
+	
+	for (i = 0u; i < port->reader_num; i++)
+	{
+		rd = port->reader[i];
+		if ((rd->waiter != NULL) && ((rd->attached == 0u) || (rd->pos != port->rx_total)))
+		{
+			osThreadFlagsSet(rd->waiter, USART_READER_THREAD_FLAG);
+		}
+	}
+}
+
+/**
+  * @brief  Account one linear block accepted into ring buffer
+  * @param  port Port descriptor
+  * @param	data Block start
+  * @param	len Block length
+  * @retval None
+  *			Finds frame delimiters and updates running CRC on new data, the
+  *			block is still hot in cache.
+  */
+static void USART_RxAccept(BSP_USART_Port_t *port, const uint8_t *data, uint16_t len)
+{
+	const uint8_t	*p = data;
+	const uint8_t	*hit;
+	
+	if (port->frame_mode == BSP_USART_FRAME_CHAR)
+	{
+		while ((hit = memchr(p, port->frame_char, len - (p - data))) != NULL)
+		{
+			port->rx_crc = BSP_CRC_Update(port->rx_crc_type, port->rx_crc, p, hit + 1 - p);
+			USART_FramePush(port, port->rx_total + (hit - data) + 1u);
+			p = hit + 1;
+		}
+	}
+	port->rx_crc = BSP_CRC_Update(port->rx_crc_type, port->rx_crc, p, len - (p - data));
+	port->rx_total += len;
+}
+
+/**
+  * @brief  Close the frame being received on a line gap
+  * @param  port Port descriptor
+  * @retval None
+  */
+static void USART_FrameGap(BSP_USART_Port_t *port)
+{
+	uint32_t len = port->rx_total - port->frame_start;
+	
+	if (len == 0u)
+	{
+		return;
+	}
+	
+	/* CRC over a Modbus frame with its CRC appended is 0 */
+	if ((port->frame_mode == BSP_USART_FRAME_MODBUS) && ((len < MODBUS_FRAME_MIN) || (port->rx_crc != 0u)))
+	{	/* Bad frame, bytes stay in ring buffer and are skipped by next frame */
+		port->stats.frame_crc_err++;
+		port->frame_start = port->rx_total;
+		port->rx_crc = BSP_CRC_Start(port->rx_crc_type);
+	}
+	else
+	{
+		USART_FramePush(port, port->rx_total);
+	}
+}
+
+/**
+  * @brief  Bits of one character on the line
+  * @param  init UART init parameters
+  * @retval Bit times x2, for half stop bits
+  */
+static uint32_t USART_CharBitsX2(const UART_InitTypeDef *init)
+{
+	/* Start bit and data bits, parity is part of word length */
+	uint32_t bits_x2 = 2u * (1u + ((init->WordLength == UART_WORDLENGTH_9B) ? 9u :
+								   (init->WordLength == UART_WORDLENGTH_7B) ? 7u : 8u));
+	switch (init->StopBits)
+	{
+		case UART_STOPBITS_0_5:	bits_x2 += 1u;	break;
+		case UART_STOPBITS_1_5:	bits_x2 += 3u;	break;
+		case UART_STOPBITS_2:	bits_x2 += 4u;	break;
+		default:				bits_x2 += 2u;	break;
+	}
+	return bits_x2;
+}
+
+/**
+  * @brief  Receiver timeout of a port in bit times
+  * @param  port Port descriptor
+  * @retval RTO value, counted from the end of last stop bit
+  */
+static uint32_t USART_RtoBits(BSP_USART_Port_t *port)
+{
+	const UART_InitTypeDef	*init = &port->huart->Init;
+	uint32_t				rto;
+	
+	if ((port->frame_mode == BSP_USART_FRAME_MODBUS) && (init->BaudRate > MODBUS_GAP_BAUD))
+	{
+		rto = (uint32_t)(((uint64_t)MODBUS_GAP_US * init->BaudRate + 999999u) / 1000000u);
+	}
+	else
+	{
+		rto = (USART_CharBitsX2(init) * port->frame_gap + 19u) / 20u;
+	}
+	return rto > USART_RTOR_RTO ? USART_RTOR_RTO : rto;
+}
+
+/**
+  * @brief  Carve DMA and ring buffer from RX pool, sized by baud rate
+  * @param  port Port descriptor
+  * @retval None
+  *			DMA buffer gives HT/TC events at most every USART_DMA_EVT_US and
+  *			takes up to half of the pool. Ring buffer holds what arrives
+  *			during the consumer latency plus one DMA buffer.
+  */
+static void USART_AutoSize(BSP_USART_Port_t *port)
+{
+	const uint32_t	line = USART_CACHE_LINE;
+	uint32_t		rate = (uint32_t)((uint64_t)port->huart->Init.BaudRate * 2u / USART_CharBitsX2(&port->huart->Init));
+	uint32_t		latency = (port->rx_latency_us != 0u) ? port->rx_latency_us : USART_RX_LATENCY_US;
+	uint32_t		pool = port->rx_pool_len;
+	uint32_t		dma_max = ((pool / 2u) > 0xFFFFu ? 0xFFFFu : (pool / 2u)) & ~(line - 1u);
+	uint32_t		dma;
+	uint32_t		rb;
+	
+	/* HT and TC, two events per buffer pass */
+	dma = (uint32_t)(((uint64_t)rate * 2u * USART_DMA_EVT_US + 999999u) / 1000000u);
+	dma = (dma + line - 1u) & ~(line - 1u);
+	dma = (dma > dma_max) ? dma_max : dma;
+	dma = (dma < line) ? line : dma;
+	
+	/* lwrb keeps one byte free */
+	rb = (uint32_t)(((uint64_t)rate * latency + 999999u) / 1000000u) + dma + 1u;
+	if (rb > (pool - dma))
+	{
+		#ifdef __ENABLE_SHELL
+		printf("usart rx pool too small, %lu us latency needs %lu bytes!\r\n",
+			(unsigned long)latency, (unsigned long)(dma + rb));
+		#endif
+		rb = pool - dma;
+	}
+	rb = (rb > 0xFFFFu) ? 0xFFFFu : rb;
+	
+	port->rx_dma_buf = port->rx_pool;
+	port->rx_dma_len = dma;
+	port->rx_rb_data = port->rx_pool + dma;
+	port->rx_rb_len = rb;
+}
+
+/**
+  * @brief  Follow RX watermark to the average burst size
+  * @param  port Port descriptor
+  * @retval None
+  *			Called on IDLE, a burst is everything accepted since previous
+  *			one. Consumer is woken about twice per burst, never later than
+  *			half of ring buffer.
+  */
+static void USART_WatermarkAdapt(BSP_USART_Port_t *port)
+{
+	uint32_t burst = port->rx_total - port->rx_burst_start;
+	uint32_t level;
+	uint32_t cap = (port->rx_rb.size - 1u) / 2u;
+	
+	port->rx_burst_start = port->rx_total;
+	
+	/* Moving average with 1/8 weight, kept x8 */
+	port->rx_burst_avg += burst - (port->rx_burst_avg >> 3);
+	level = (port->rx_burst_avg >> 3) / 2u;
+	level = (level < port->rx_wm_min) ? port->rx_wm_min : level;
+	level = (level > cap) ? cap : level;
+	port->rx_notify_level = (level == 0u) ? 1u : level;
+}
+
+/**
+  * @brief  Copy one linear DMA block into ring buffer
+  * @param  port Port descriptor
+  * @param	data Block start
+  * @param	len Block length
+  * @retval None
+  */
+static void USART_RxWrite(BSP_USART_Port_t *port, const uint8_t *data, uint16_t len)
+{
+	size_t written;
+	
+	if (port->rx_fwd != NULL)
+	{
+		written = port->rx_fwd(port->rx_fwd_ctx, data, len);
+	}
+	else
+	{
+		if (port->reader_num != 0u)
+		{
+			USART_ReaderMakeRoom(port, len);
+		}
+		written = lwrb_write(&port->rx_rb, data, len);
+	}
+	
+	USART_RxAccept(port, data, written);
+	port->stats.rx_bytes += written;
+	if (written < len)
+	{
+		port->stats.rx_drop += len - written;
+		#ifdef __ENABLE_SHELL
+		printf("usart lwrb write fail!\r\n");
+		#endif
+	}
+}
+
+/**
+  * @brief  Stop sender once ring buffer reaches high watermark
+  * @param  port Port descriptor
+  * @param	full Ring buffer level
+  * @retval None
+  *			USART RTS follows RDR, pausing DMA requests leaves the next byte
+  *			there and hardware deasserts RTS. A GPIO RTS is driven high.
+  */
+static void USART_RtsHold(BSP_USART_Port_t *port, uint16_t full)
+{
+	if ((port->rts_high == 0u) || (port->rts_held != 0u) || (full < port->rts_high))
+	{
+		return;
+	}
+	
+	port->rts_held = 1u;
+	port->stats.rts_hold++;
+	if (port->rts_gpio != NULL)
+	{
+		HAL_GPIO_WritePin(port->rts_gpio, port->rts_pin, GPIO_PIN_SET);
+	}
+	else
+	{
+		ATOMIC_CLEAR_BIT(port->huart->Instance->CR3, USART_CR3_DMAR);
+	}
+	
+	/* HAL reports no IDLE when DMA stopped at buffer end, consumer must drain anyway */
+	osSemaphoreRelease(*port->rx_sem);
+}
+
+/**
+  * @brief  Let sender go on once consumer drained ring buffer to low watermark
+  * @param  port Port descriptor
+  * @retval None
+  *			Called by consumer after each read.
+  */
+static void USART_RtsRelease(BSP_USART_Port_t *port)
+{
+	if ((port->rts_held == 0u) || (lwrb_get_full(&port->rx_rb) > port->rts_low))
+	{
+		return;
+	}
+	
+	USART_ENTER_CRITICAL();
+	if (port->rts_held != 0u)
+	{
+		port->rts_held = 0u;
+		if (port->rts_gpio != NULL)
+		{
+			HAL_GPIO_WritePin(port->rts_gpio, port->rts_pin, GPIO_PIN_RESET);
+		}
+		else
+		{
+			/* DMA request of the byte waiting in RDR is raised again */
+			ATOMIC_SET_BIT(port->huart->Instance->CR3, USART_CR3_DMAR);
+		}
+	}
+	USART_EXIT_CRITICAL();
+}
+
+/**
+  * @brief  Start DMA on the next linear block of TX queue if DMA is idle
+  * @param  port Port descriptor
+  * @retval None
+  *			Called from task and from TX complete callback
+  */
+static void USART_TxKick(BSP_USART_Port_t *port)
+{
+	uint8_t	*addr;
+	size_t	len;
+	USART_ENTER_CRITICAL();
+	
+	if (port->tx_dma_len == 0u)
+	{
+		len = lwrb_get_linear_block_read_length(&port->tx_rb);
+		if (len > 0u)
+		{
+			addr = lwrb_get_linear_block_read_address(&port->tx_rb);
+			
+			#ifdef CACHE_SUPPORT
+			/* Write back DCache for CM7 core before DMA reads the queue */
+			SCB_CleanDCache_by_Addr((uint32_t *)addr, len);
+			#endif
+			
+			port->tx_dma_len = len;
+			if (HAL_UART_Transmit_DMA(port->huart, addr, len) != HAL_OK)
+			{
+				port->tx_dma_len = 0u;
+			}
+		}
+	}
+	
+	USART_EXIT_CRITICAL();
+}
+
+/**
+  * @brief  Publish bytes DMA wrote into the ring buffer, direct mode only
+  * @param  port Port descriptor
+  * @param	len New bytes since previous event
+  * @retval None
+  *			Write index follows DMA position. When consumer is too slow DMA has
+  *			already overwritten the oldest data, skip it to stay in step.
+  */
+static void USART_RxAdvance(BSP_USART_Port_t *port, uint16_t len)
+{
+	size_t advanced = lwrb_advance(&port->rx_rb, len);
+	
+	port->stats.rx_bytes += len;
+	if (advanced < len)
+	{
+		port->stats.rx_drop += len - advanced;
+		port->rx_ovr++;
+		lwrb_skip(&port->rx_rb, len - advanced);
+		lwrb_advance(&port->rx_rb, len - advanced);
+		#ifdef __ENABLE_SHELL
+		printf("usart dma buffer overrun!\r\n");
+		#endif
+	}
+}
+
+/**
+  * @brief  Drop unread data before DMA restarts at buffer start, direct mode only
+  * @param  port Port descriptor
+  * @retval None
+  *			Restarted DMA overwrites unread bytes, so ring buffer indexes go
+  *			back to 0 with it. Caller blocks interrupts.
+  */
+static void USART_RxRestartDirect(BSP_USART_Port_t *port)
+{
+	BSP_USART_Reader_t	*rd;
+	uint8_t				i;
+	
+	port->stats.err_drop += lwrb_get_full(&port->rx_rb);
+	port->rx_ovr++;
+	lwrb_reset(&port->rx_rb);
+	
+	for (i = 0u; i < port->reader_num; i++)
+	{
+		rd = port->reader[i];
+		if ((rd->attached != 0u) && (rd->pos != port->rx_total))
+		{
+			rd->ovr = 1u;
+			rd->drop += port->rx_total - rd->pos;
+			rd->pos = port->rx_total;
+		}
+	}
+}
+
+/**
+  * @brief  Consume data from ring buffer read index on
+  * @param  port Port descriptor
+  * @param	pData Copy of the data, NULL to skip only
+  * @param	len Bytes to consume, at most the buffered level
+  * @param	ovr rx_ovr read before the level len was taken from
+  * @retval len, 0 when direct mode RX interrupt dropped data since ovr
+  *			In direct mode RX interrupt moves the read index too when DMA
+  *			overwrites unread data. Data is copied first and the read index
+  *			moves under lock only if no overrun happened meanwhile, else the
+  *			copy may be torn and nothing is consumed, take the level again.
+  */
+static uint16_t USART_RxRead(BSP_USART_Port_t *port, uint8_t *pData, uint16_t len, uint32_t ovr)
+{
+	if (port->rx_rb_len != 0u)
+	{
+		return (uint16_t)((pData != NULL) ? lwrb_read(&port->rx_rb, pData, len) : lwrb_skip(&port->rx_rb, len));
+	}
+	
+	if (pData != NULL)
+	{
+		lwrb_peek(&port->rx_rb, 0u, pData, len);
+	}
+	{
+		USART_ENTER_CRITICAL();
+		len = (port->rx_ovr == ovr) ? (uint16_t)lwrb_skip(&port->rx_rb, len) : 0u;
+		USART_EXIT_CRITICAL();
+	}
+	return len;
+}
+
+/**
+  * @brief  Check if port has data for BSP_USART_Poll()
+  * @param  port Port descriptor
+  * @retval 1 when ready
+  */
+static uint8_t USART_PollReady(BSP_USART_Port_t *port)
+{
+	uint16_t level = (port->poll_level != 0u) ? port->poll_level : 1u;
+	
+	if (port->dbm_len != 0u)
+	{
+		return (port->dbm_r != port->dbm_w) ? 1u : 0u;
+	}
+	if (port->frame_mode != BSP_USART_FRAME_NONE)
+	{
+		return (port->frame_r != port->frame_w) ? 1u : 0u;
+	}
+	return (lwrb_get_full(&port->rx_rb) >= level) ? 1u : 0u;
+}
+
+/**
+  * @brief  Set port event flag of BSP_USART_Poll() once ready
+  * @param  port Port descriptor
+  * @param	evt Event type
+  * @retval None
+  */
+static void USART_PollSignal(BSP_USART_Port_t *port, BSP_USART_Evt_t evt)
+{
+	if ((usart_poll_ef == NULL) || (port->poll_bit == 0u))
+	{
+		return;
+	}
+	
+	/* Without a level stream data waits for idle line, like rx_sem */
+	if ((port->poll_level == 0u) && (port->dbm_len == 0u) &&
+		((evt == BSP_USART_EVT_HT) || (evt == BSP_USART_EVT_TC)))
+	{
+		return;
+	}
+	if (USART_PollReady(port) != 0u)
+	{
+		osEventFlagsSet(usart_poll_ef, port->poll_bit);
+	}
+}
+
+/**
+  * @brief  Check if pending asynchronous receive can complete
+  * @param  port Port descriptor
+  * @param  req Pending request
+  * @retval 1 ready, 0 not yet
+  */
+static uint8_t USART_AsyncReady(BSP_USART_Port_t *port, const BSP_USART_Async_t *req)
+{
+	uint32_t full = lwrb_get_full(&port->rx_rb);
+	
+	switch (req->mode)
+	{
+		case BSP_USART_ASYNC_LEN:
+			return (full >= req->size) ? 1u : 0u;
+		
+		case BSP_USART_ASYNC_FRAME:
+			return (port->frame_r != port->frame_w) ? 1u : 0u;
+		
+		default:
+			return ((full >= req->size) || ((full != 0u) && (port->async_pause != 0u))) ? 1u : 0u;
+	}
+}
+
+/**
+  * @brief  Take pending request off the port
+  * @param  port Port descriptor
+  * @param  req Request expected pending
+  * @retval 1 caller owns completion, 0 someone else completed or cancelled it
+  */
+static uint8_t USART_AsyncClaim(BSP_USART_Port_t *port, BSP_USART_Async_t *req)
+{
+	uint8_t claimed = 0u;
+	USART_ENTER_CRITICAL();
+	
+	if ((req != NULL) && (port->async == req))
+	{
+		port->async = NULL;
+		claimed = 1u;
+	}
+	
+	USART_EXIT_CRITICAL();
+	return claimed;
+}
+
+/**
+  * @brief  Deliver data of a claimed request and call back
+  * @param  port Port descriptor
+  * @param  req Claimed request
+  * @retval None
+  *			A timed out LEN or FRAME request leaves data buffered, ANY mode
+  *			delivers whatever arrived.
+  */
+static void USART_AsyncFinish(BSP_USART_Port_t *port, BSP_USART_Async_t *req)
+{
+	uint16_t len = 0u;
+	
+	if (req->mode == BSP_USART_ASYNC_FRAME)
+	{
+		len = BSP_USART_ReadFrame(port, req->buf, req->size);
+		len = (len < req->size) ? len : req->size;
+	}
+	else if ((req->mode == BSP_USART_ASYNC_ANY) || (USART_AsyncReady(port, req) != 0u))
+	{
+		len = BSP_USART_ReadRB(port, req->buf, req->size);
+	}
+	port->async_pause = 0u;
+	req->cb(req, (len != 0u) ? HAL_OK : HAL_TIMEOUT, len);
+}
+
+/**
+  * @brief  Complete or hand over asynchronous receive after an RX event
+  * @param  port Port descriptor
+  * @param  evt Event type
+  * @retval None
+  */
+static void USART_AsyncNotify(BSP_USART_Port_t *port, BSP_USART_Evt_t evt)
+{
+	BSP_USART_Async_t	*req = port->async;
+	osThreadId_t		worker = usart_async_thread;
+	
+	if ((evt != BSP_USART_EVT_HT) && (evt != BSP_USART_EVT_TC))
+	{
+		port->async_pause = 1u;
+	}
+	if (USART_AsyncReady(port, req) == 0u)
+	{
+		return;
+	}
+	
+	if (req->from_isr != 0u)
+	{
+		if (USART_AsyncClaim(port, req) != 0u)
+		{
+			USART_AsyncFinish(port, req);
+		}
+	}
+	else if (worker != NULL)
+	{
+		osThreadFlagsSet(worker, USART_ASYNC_THREAD_FLAG);
+	}
+}
+
+/**
+  * @brief  Queue a filled part of a double buffer
+  * @param  port Port descriptor
+  * @param	buf Buffer index
+  * @param	off Block start
+  * @param	len Block length
+  * @retval None
+  */
+static void USART_DbmPush(BSP_USART_Port_t *port, uint8_t buf, uint16_t off, uint16_t len)
+{
+	uint8_t				w = port->dbm_w;
+	BSP_USART_DbmBlk_t	*blk = &port->dbm_q[w & (BSP_USART_DBM_Q_LEN - 1u)];
+	
+	if (len == 0u)
+	{
+		return;
+	}
+	
+	port->stats.rx_bytes += len;
+	port->rx_total += len;
+	if ((uint8_t)(w - port->dbm_r) >= BSP_USART_DBM_Q_LEN)
+	{
+		port->stats.rx_drop += len;
+		return;
+	}
+	blk->buf = buf;
+	blk->off = off;
+	blk->len = len;
+	blk->gen = port->dbm_gen[buf];
+	port->dbm_w = w + 1u;
+}
+
+/**
+  * @brief  Read double buffer DMA position
+  * @param  port Port descriptor
+  * @param	pos Write position in buffer DMA fills
+  * @retval Buffer DMA fills
+  */
+static uint8_t USART_DbmPos(BSP_USART_Port_t *port, uint16_t *pos)
+{
+	DMA_Stream_TypeDef	*dma = (DMA_Stream_TypeDef *)port->huart->hdmarx->Instance;
+	uint32_t			ct;
+	
+	/* Target and counter of the same buffer */
+	do
+	{
+		ct = dma->CR & DMA_SxCR_CT;
+		*pos = port->dbm_len - dma->NDTR;
+	} while (ct != (dma->CR & DMA_SxCR_CT));
+	return ((ct != 0u) ? 1u : 0u) ^ port->dbm_base;
+}
+
+/**
+  * @brief  Check DMA has not written over a double buffer block yet
+  * @param  port Port descriptor
+  * @param	blk Block
+  * @retval 1 when intact
+  *			Refill of a buffer starts at its beginning, blocks above the
+  *			current DMA position survive until DMA gets there.
+  */
+static uint8_t USART_DbmIntact(BSP_USART_Port_t *port, const BSP_USART_DbmBlk_t *blk)
+{
+	uint16_t	pos;
+	uint8_t		ok = 0u;
+	USART_ENTER_CRITICAL();
+	
+	if (blk->gen == port->dbm_gen[blk->buf])
+	{
+		ok = 1u;
+	}
+	else if ((blk->gen + 1u == port->dbm_gen[blk->buf]) && (blk->buf == port->dbm_cur) &&
+			 (USART_DbmPos(port, &pos) == blk->buf) && (pos <= blk->off))
+	{
+		ok = 1u;
+	}
+	
+	USART_EXIT_CRITICAL();
+	return ok;
+}
+
+/**
+  * @brief  Hand filled double buffer data to application
+  * @param  port Port descriptor
+  * @param	idle Also hand over the partly filled current buffer
+  * @retval None
+  *			Shared by DMA complete callbacks and IDLE, which may run at
+  *			different interrupt priorities.
+  */
+static void USART_DbmUpdate(BSP_USART_Port_t *port, uint8_t idle)
+{
+	uint16_t	pos;
+	uint8_t		cur;
+	USART_ENTER_CRITICAL();
+	
+	cur = USART_DbmPos(port, &pos);
+	if (cur != port->dbm_cur)
+	{	/* Buffer completed, rest of it goes to application, DMA now refills the other one */
+		USART_DbmPush(port, port->dbm_cur, port->dbm_off, port->dbm_len - port->dbm_off);
+		port->dbm_cur = cur;
+		port->dbm_off = 0u;
+		port->dbm_gen[cur]++;
+	}
+	
+	if ((idle != 0u) && (pos > port->dbm_off))
+	{
+		USART_DbmPush(port, cur, port->dbm_off, pos - port->dbm_off);
+		port->dbm_off = pos;
+	}
+	
+	USART_EXIT_CRITICAL();
+}
+
+/**
+  * @brief  Double buffer DMA complete callback, M0 and M1
+  * @param  hdma DMA handle
+  * @retval None
+  */
+static void USART_DbmCplt(DMA_HandleTypeDef *hdma)
+{
+	USART_PROF_START();
+	BSP_USART_Port_t *port = BSP_USART_GetPort((UART_HandleTypeDef *)hdma->Parent);
+	
+	if (port != NULL)
+	{
+		USART_DbmUpdate(port, 0u);
+		port->stats.evt_tc++;
+		osSemaphoreRelease(*port->rx_sem);
+		USART_PollSignal(port, BSP_USART_EVT_TC);
+		USART_PROF_END(port, BSP_USART_EVT_TC);
+	}
+}
+
+/**
+  * @brief  Double buffer DMA error callback
+  * @param  hdma DMA handle
+  * @retval None
+  */
+static void USART_DbmError(DMA_HandleTypeDef *hdma)
+{
+	BSP_USART_Port_t *port = BSP_USART_GetPort((UART_HandleTypeDef *)hdma->Parent);
+	
+	if (port != NULL)
+	{
+		port->stats.err_cnt++;
+	}
+	#ifdef __ENABLE_SHELL
+	printf("usart double buffer dma error!\r\n");
+	#endif
+}
+
+/**
+  * @brief  Start double buffer DMA reception
+  * @param  port Port descriptor
+  * @param	first Buffer to fill first
+  * @retval None
+  *			Not a HAL reception, IDLE is serviced by BSP_USART_IRQHandler().
+  */
+static void USART_DbmStart(BSP_USART_Port_t *port, uint8_t first)
+{
+	UART_HandleTypeDef	*huart = port->huart;
+	DMA_HandleTypeDef	*hdma = huart->hdmarx;
+	
+	port->dbm_base = first;
+	port->dbm_cur = first;
+	port->dbm_off = 0u;
+	port->dbm_gen[first]++;
+	
+	/* HT stays disabled without a callback */
+	hdma->XferCpltCallback = USART_DbmCplt;
+	hdma->XferM1CpltCallback = USART_DbmCplt;
+	hdma->XferErrorCallback = USART_DbmError;
+	hdma->XferHalfCpltCallback = NULL;
+	if (HAL_DMAEx_MultiBufferStart_IT(hdma, (uint32_t)(uintptr_t)&huart->Instance->RDR, (uint32_t)(uintptr_t)port->dbm_buf[first],
+									  (uint32_t)(uintptr_t)port->dbm_buf[first ^ 1u], port->dbm_len) != HAL_OK)
+	{
+		#ifdef __ENABLE_SHELL
+		printf("usart double buffer start fail!\r\n");
+		#endif
+		return;
+	}
+	
+	__HAL_UART_CLEAR_FLAG(huart, UART_CLEAR_IDLEF);
+	ATOMIC_SET_BIT(huart->Instance->CR1, USART_CR1_IDLEIE);
+	ATOMIC_SET_BIT(huart->Instance->CR3, USART_CR3_EIE | USART_CR3_DMAR);
+}
+
+#if (USART_CACHE_MODE == USART_CACHE_RANGE)
+/**
+  * @brief  Invalidate DCache lines covering part of RX DMA buffer
+  * @param  port Port descriptor
+  * @param	from First byte
+  * @param	to End, exclusive
+  * @retval None
+  *			Buffer is whole lines, so rounding never leaves it.
+  */
+static void USART_CacheInvalidate(BSP_USART_Port_t *port, uint16_t from, uint16_t to)
+{
+	uint32_t start = from & ~(USART_CACHE_LINE - 1u);
+	uint32_t end = (to + USART_CACHE_LINE - 1u) & ~(USART_CACHE_LINE - 1u);
+	
+	SCB_InvalidateDCache_by_Addr((uint32_t *)&port->rx_dma_buf[start], end - start);
+}
+#endif
+
+/**
+  * @brief  Move data DMA wrote since previous event into ring buffer
+  * @param  port Port descriptor
+  * @retval None
+  *			Shared by RX event callback and IRQ pre-handler
+  */
+static void USART_RxUpdate(BSP_USART_Port_t *port)
+{
+	uint16_t	pos_last;
+	uint16_t	pos;
+	uint16_t	full;
+	
+	#if (USART_CACHE_MODE == USART_CACHE_FULL)
+	/* Invalidate DCache for CM7 core */
+	SCB_InvalidateDCache_by_Addr((uint32_t *)port->rx_dma_buf, port->rx_dma_len);
+	#endif
+	
+	pos_last = port->pos_last;
+	pos = port->rx_dma_len - __HAL_DMA_GET_COUNTER(port->huart->hdmarx);
+	
+	#if (USART_CACHE_MODE == USART_CACHE_RANGE)
+	/* Only lines of new data, position is read first so they are complete */
+	if (pos > pos_last)
+	{
+		USART_CacheInvalidate(port, pos_last, pos);
+	}
+	else if (pos < pos_last)
+	{
+		USART_CacheInvalidate(port, pos_last, port->rx_dma_len);
+		USART_CacheInvalidate(port, 0u, pos);
+	}
+	#endif
+	
+	if (pos != pos_last)
+	{
+		if (port->rx_rb_len == 0u)
+		{	/* Direct mode, DMA buffer is the ring buffer, only move write index */
+			if (pos > pos_last)
+			{
+				USART_RxAccept(port, &port->rx_dma_buf[pos_last], pos - pos_last);
+			}
+			else
+			{
+				port->stats.dma_wrap++;
+				USART_RxAccept(port, &port->rx_dma_buf[pos_last], port->rx_dma_len - pos_last);
+				USART_RxAccept(port, &port->rx_dma_buf[0], pos);
+			}
+			USART_RxAdvance(port, (pos > pos_last) ? (pos - pos_last) : (port->rx_dma_len - pos_last + pos));
+		}
+		else if (pos > pos_last)
+		{	/* Current position is over previous one */
+			/*
+			 * Processing is done in "linear" mode.
+			 *
+			 * Application processing is fast with single data block,
+			 * length is simply calculated by subtracting pointers
+			 *
+			 * [   0   ]
+			 * [   1   ] <- old_pos |------------------------------------|
+			 * [   2   ]            |                                    |
+			 * [   3   ]            | Single block (len = pos - old_pos) |
+			 * [   4   ]            |                                    |
+			 * [   5   ]            |------------------------------------|
+			 * [   6   ] <- pos
+			 * [   7   ]
+			 * [ N - 1 ]
+			 */
+			USART_RxWrite(port, &port->rx_dma_buf[pos_last], pos - pos_last);
+		}
+		else if (pos < pos_last)
+		{
+			port->stats.dma_wrap++;
+			
+			/* "overflow" mode..
+			 *
+			 * Application must process data twice,
+			 * since there are 2 linear memory blocks to handle
+			 *
+			 * [   0   ]            |---------------------------------|
+			 * [   1   ]            | Second block (len = pos)        |
+			 * [   2   ]            |---------------------------------|
+			 * [   3   ] <- pos
+			 * [   4   ] <- old_pos |---------------------------------|
+			 * [   5   ]            |                                 |
+			 * [   6   ]            | First block (len = N - old_pos) |
+			 * [   7   ]            |                                 |
+			 * [ N - 1 ]            |---------------------------------|
+			 */
+			USART_RxWrite(port, &port->rx_dma_buf[pos_last], port->rx_dma_len - pos_last);
+			
+			if (pos > 0)	/* Second block process */
+			{
+				USART_RxWrite(port, &port->rx_dma_buf[0], pos);
+			}
+		}
+		port->pos_last = pos;	/* Save current position as old for next transfers */
+		
+		full = lwrb_get_full(&port->rx_rb);
+		if (full > port->stats.rb_peak)
+		{
+			port->stats.rb_peak = full;
+		}
+		USART_RtsHold(port, full);
+		
+		/* Wake blocked receiver once it has enough data */
+		if ((port->rx_wait_len != 0u) && (full >= port->rx_wait_len))
+		{
+			port->rx_wait_len = 0u;
+			osThreadFlagsSet(port->rx_waiter, USART_RX_THREAD_FLAG);
+		}
+	}	/* if (pos != pos_last) */
+}
+
+/**
+  * @brief  Timestamp data of an RX event
+  * @param  port Port descriptor
+  * @param	evt Event type
+  * @retval None
+  *			IDLE and RTO fire a line gap after last byte, back date them.
+  */
+static void USART_TsRecord(BSP_USART_Port_t *port, BSP_USART_Evt_t evt)
+{
+	uint32_t		ts = BSP_USART_TIMESTAMP();
+	uint32_t		w = port->ts_w;
+	BSP_USART_Ts_t	*e = &port->ts_q[(w - 1u) & (BSP_USART_TS_Q_LEN - 1u)];
+	
+	/* No new data since previous event */
+	if ((w != 0u) && (e->offset == port->rx_total))
+	{
+		return;
+	}
+	if (evt == BSP_USART_EVT_IDLE)
+	{
+		ts -= port->ts_char;
+	}
+	else if (evt == BSP_USART_EVT_RTO)
+	{
+		ts -= port->ts_rto;
+	}
+	
+	e = &port->ts_q[w & (BSP_USART_TS_Q_LEN - 1u)];
+	e->offset = port->rx_total;
+	e->ts = ts;
+	port->ts_w = w + 1u;
+}
+
+/**
+  * @brief  Estimate arrival time of a received byte, caller blocks interrupts
+  * @param  port Port descriptor
+  * @param	offset Stream offset of byte
+  * @retval Timestamp
+  *			Byte arrived one character time per byte before the end of its
+  *			event, but not before the previous event.
+  */
+static uint32_t USART_TsLookup(BSP_USART_Port_t *port, uint32_t offset)
+{
+	uint32_t		w = port->ts_w;
+	uint32_t		r = port->ts_r;
+	uint32_t		ts;
+	uint8_t			prev = 0u;
+	uint32_t		prev_ts = 0u;
+	BSP_USART_Ts_t	*e;
+	
+	if ((w - r) >= BSP_USART_TS_Q_LEN)
+	{
+		r = w - BSP_USART_TS_Q_LEN;
+	}
+	else
+	{	/* Last released event still bounds the first byte after it */
+		prev = 1u;
+		prev_ts = port->ts_q[(r - 1u) & (BSP_USART_TS_Q_LEN - 1u)].ts;
+	}
+	for (; r != w; r++)
+	{
+		e = &port->ts_q[r & (BSP_USART_TS_Q_LEN - 1u)];
+		if ((int32_t)(e->offset - offset) > 0)
+		{
+			ts = e->ts - (e->offset - 1u - offset) * port->ts_char;
+			if ((prev != 0u) && ((int32_t)(ts - prev_ts) < 0))
+			{
+				ts = prev_ts;
+			}
+			return ts;
+		}
+		prev = 1u;
+		prev_ts = e->ts;
+	}
+	
+	/* Events overwritten or not recorded yet */
+	return (r != port->ts_r) ? port->ts_q[(r - 1u) & (BSP_USART_TS_Q_LEN - 1u)].ts : BSP_USART_TIMESTAMP();
+}
+
+/**
+  * @brief  Account an RX event and wake consumers
+  * @param  port Port descriptor
+  * @param	evt Event type
+  * @retval 0 on success, 1 on unknown event
+  */
+static uint8_t USART_RxNotify(BSP_USART_Port_t *port, BSP_USART_Evt_t evt)
+{
+	USART_TsRecord(port, evt);
+	
+	switch (evt)
+	{
+		case BSP_USART_EVT_IDLE:
+			port->stats.evt_idle++;
+			if (port->rx_wm_auto != 0u)
+			{
+				USART_WatermarkAdapt(port);
+			}
+			osSemaphoreRelease(*port->rx_sem);
+			break;		
+		
+		case BSP_USART_EVT_MATCH:
+			/* Frame delimiter received, same as an idle line for consumers */
+			port->stats.evt_match++;
+			osSemaphoreRelease(*port->rx_sem);
+			break;
+		
+		case BSP_USART_EVT_RTO:
+			port->stats.evt_rto++;
+			osSemaphoreRelease(*port->rx_sem);
+			break;
+		
+		case BSP_USART_EVT_ERR:
+			/* Reception restarted, data before the error is ready like on IDLE */
+			osSemaphoreRelease(*port->rx_sem);
+			break;
+		
+		case BSP_USART_EVT_TC: 
+		case BSP_USART_EVT_HT:
+			if (evt == BSP_USART_EVT_TC)
+			{
+				port->stats.evt_tc++;
+			}
+			else
+			{
+				port->stats.evt_ht++;
+			}
+			
+			/* No idle gap in a continuous stream, notify on watermark */
+			if ((port->rx_notify_level != 0u) && (lwrb_get_full(&port->rx_rb) >= port->rx_notify_level))
+			{
+				osSemaphoreRelease(*port->rx_sem);
+			}
+			break;
+		
+		default:
+			return 1u;
+	}
+	USART_PollSignal(port, evt);
+	
+	/* Readers wake like rx_sem */
+	if ((port->reader_num != 0u) && (((evt != BSP_USART_EVT_HT) && (evt != BSP_USART_EVT_TC)) ||
+		((port->rx_notify_level != 0u) && (lwrb_get_full(&port->rx_rb) >= port->rx_notify_level))))
+	{
+		USART_ReaderNotify(port);
+	}
+	if (port->async != NULL)
+	{
+		USART_AsyncNotify(port, evt);
+	}
+	return 0u;
+}
+
+#ifdef USART_PROFILE
+/**
+  * @brief  Account one callback execution
+  * @param  port Port descriptor
+  * @param	evt Event type
+  * @param	ticks Execution time in timestamp ticks
+  * @retval None
+  */
+static void USART_ProfRecord(BSP_USART_Port_t *port, BSP_USART_Evt_t evt, uint32_t ticks)
+{
+	BSP_USART_Prof_t	*prof = &port->prof[evt];
+	uint32_t			bucket = (ticks == 0u) ? 0u : (31u - (uint32_t)__builtin_clz(ticks));
+	
+	if ((prof->count == 0u) || (ticks < prof->min))
+	{
+		prof->min = ticks;
+	}
+	if (ticks > prof->max)
+	{
+		prof->max = ticks;
+	}
+	prof->count++;
+	prof->sum += ticks;
+	prof->hist[bucket < BSP_USART_PROF_BUCKETS ? bucket : (BSP_USART_PROF_BUCKETS - 1u)]++;
+}
+#endif
+
+/**
+  * @brief  Align ring buffer read position to the oldest queued frame
+  * @param  port Port descriptor
+  * @retval Frame length, 0 when no complete frame
+  *			Frames whose start was already consumed or overwritten are dropped,
+  *			bytes in front of a frame are skipped.
+  */
+static uint16_t USART_FrameFront(BSP_USART_Port_t *port)
+{
+	BSP_USART_Frame_t	*frame;
+	uint32_t			rd;
+	uint32_t			ovr;
+	int32_t				ahead;
+	
+	while (port->frame_r != port->frame_w)
+	{
+		frame = &port->frame_q[port->frame_r & (BSP_USART_FRAME_Q_LEN - 1u)];
+		{
+			USART_ENTER_CRITICAL();
+			ovr = port->rx_ovr;
+			rd = port->rx_total - lwrb_get_full(&port->rx_rb);
+			USART_EXIT_CRITICAL();
+		}
+		
+		ahead = (int32_t)(frame->offset - rd);
+		if (ahead < 0)
+		{
+			port->frame_r++;
+			port->stats.frame_drop++;
+		}
+		else if ((ahead == 0) || (USART_RxRead(port, NULL, (uint16_t)ahead, ovr) != 0u))
+		{
+			return frame->len;
+		}
+	}
+	return 0u;
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Find port descriptor of a HAL handle
+  * @param  huart UART handle.
+  * @retval Port descriptor, NULL if the handle is not managed by bsp_usart
+  */
+BSP_USART_Port_t *BSP_USART_GetPort(UART_HandleTypeDef *huart)
+{
+	BSP_USART_Port_t *const *pp;
+	
+	for (pp = usart_port_tbl; *pp != NULL; pp++)
+	{
+		if ((*pp)->huart == huart)
+		{
+			return *pp;
+		}
+	}
+	return NULL;
+}
+
+/**
+  * @brief  Usr defined Rx Event Callback, shared by all ports
+  * @param  huart UART handle.
+  * @param	received data size
+  * @retval None
+  */
+void BSP_USART_RxEventCb(UART_HandleTypeDef *huart, uint16_t size)
+{
+	UNUSED(size);
+	USART_PROF_START();
+	BSP_USART_Port_t	*port = BSP_USART_GetPort(huart);
+	
+	if (port == NULL)
+	{
+		return;
+	}
+	
+	USART_RxUpdate(port);
+	if (USART_RxNotify(port, (BSP_USART_Evt_t)huart->RxEventType) != 0u)
+	{
+		#ifdef __ENABLE_SHELL
+		printf("RxEventType Error!\r\n");
+		#endif
+		return;
+	}
+	
+	USART_PROF_END(port, (BSP_USART_Evt_t)huart->RxEventType);
+}
+
+/**
+  * @brief  USART interrupt pre-handler, shared by all ports
+  * @param  huart UART handle.
+  * @retval None
+  *			Call from USARTx_IRQHandler() before HAL_UART_IRQHandler() when
+  *			character match or receiver timeout framing is used. HAL does not
+  *			service CMF and treats RTOF as an error which aborts DMA reception.
+  */
+void BSP_USART_IRQHandler(UART_HandleTypeDef *huart)
+{
+	BSP_USART_Port_t *port;
+	
+	if (__HAL_UART_GET_FLAG(huart, UART_FLAG_CMF) && READ_BIT(huart->Instance->CR1, USART_CR1_CMIE))
+	{
+		USART_PROF_START();
+		__HAL_UART_CLEAR_FLAG(huart, UART_CLEAR_CMF);
+		
+		port = BSP_USART_GetPort(huart);
+		if (port != NULL)
+		{
+			USART_RxUpdate(port);
+			USART_RxNotify(port, BSP_USART_EVT_MATCH);
+			USART_PROF_END(port, BSP_USART_EVT_MATCH);
+		}
+	}
+	
+	if (__HAL_UART_GET_FLAG(huart, UART_FLAG_IDLE) && READ_BIT(huart->Instance->CR1, USART_CR1_IDLEIE))
+	{	/* Double buffer mode only, HAL reception handles its own IDLE */
+		port = BSP_USART_GetPort(huart);
+		if ((port != NULL) && (port->dbm_len != 0u))
+		{
+			USART_PROF_START();
+			__HAL_UART_CLEAR_FLAG(huart, UART_CLEAR_IDLEF);
+			USART_DbmUpdate(port, 1u);
+			USART_RxNotify(port, BSP_USART_EVT_IDLE);
+			USART_PROF_END(port, BSP_USART_EVT_IDLE);
+		}
+	}
+	
+	if (__HAL_UART_GET_FLAG(huart, UART_FLAG_RTOF) && READ_BIT(huart->Instance->CR1, USART_CR1_RTOIE))
+	{
+		USART_PROF_START();
+		__HAL_UART_CLEAR_FLAG(huart, UART_CLEAR_RTOF);
+		
+		port = BSP_USART_GetPort(huart);
+		if (port != NULL)
+		{
+			USART_RxUpdate(port);
+			USART_FrameGap(port);
+			USART_RxNotify(port, BSP_USART_EVT_RTO);
+			USART_PROF_END(port, BSP_USART_EVT_RTO);
+		}
+	}
+}
+
+/**
+  * @brief  UART error callback, shared by all ports
+  * @param  huart UART handle.
+  * @retval None
+  */
+void BSP_USART_ErrorCb(UART_HandleTypeDef *huart)
+{
+	USART_PROF_START();
+	BSP_USART_Port_t	*port = BSP_USART_GetPort(huart);
+	uint32_t			error = huart->ErrorCode;
+	
+	if (port != NULL)
+	{
+		#ifdef __ENABLE_SHELL
+		printf("USART Error!\r\n");
+		#endif
+		port->stats.err_cnt++;
+		if (error & HAL_UART_ERROR_ORE)
+		{
+			port->stats.err_ore++;
+		}
+		if (error & HAL_UART_ERROR_FE)
+		{
+			port->stats.err_fe++;
+		}
+		if (error & HAL_UART_ERROR_PE)
+		{
+			port->stats.err_pe++;
+		}
+		if (error & HAL_UART_ERROR_NE)
+		{
+			port->stats.err_ne++;
+		}
+
+		if (error & (HAL_UART_ERROR_ORE | HAL_UART_ERROR_FE | HAL_UART_ERROR_PE | HAL_UART_ERROR_NE))
+		{
+			port->stats.err_drop++;
+		}
+		
+		/*
+		 * HAL aborted DMA reception. Bytes stored before the error are kept,
+		 * position state restarts with DMA at buffer start. Events of a lower
+		 * priority interrupt must not see the two halfway.
+		 */
+		{
+			USART_ENTER_CRITICAL();
+			if (port->dbm_len != 0u)
+			{
+				USART_DbmUpdate(port, 1u);
+			}
+			else
+			{
+				USART_RxUpdate(port);
+				port->pos_last = 0u;
+				if (port->rx_rb_len == 0u)
+				{
+					USART_RxRestartDirect(port);
+				}
+			}
+			
+			/* DMA stopped on the bad byte (DDRE), it is still in RDR */
+			__HAL_UART_SEND_REQ(huart, UART_RXDATA_FLUSH_REQUEST);
+			__HAL_UART_CLEAR_FLAG(huart, UART_CLEAR_OREF | UART_CLEAR_FEF | UART_CLEAR_PEF | UART_CLEAR_NEF |
+										 UART_CLEAR_IDLEF | UART_CLEAR_CMF);
+			
+			if (port->dbm_len != 0u)
+			{
+				/* Continue in the buffer handed over longest ago, like on a buffer switch */
+				huart->ErrorCode = HAL_UART_ERROR_NONE;
+				USART_DbmStart(port, port->dbm_cur ^ 1u);
+			}
+			else
+			{
+				HAL_UARTEx_ReceiveToIdle_DMA(huart, port->rx_dma_buf, port->rx_dma_len);
+				if ((port->rts_held != 0u) && (port->rts_gpio == NULL))
+				{	/* Sender stays stopped */
+					ATOMIC_CLEAR_BIT(huart->Instance->CR3, USART_CR3_DMAR);
+				}
+			}
+			USART_EXIT_CRITICAL();
+		}
+		
+		/* Wake consumer, data up to the error may end a frame or reach a level */
+		USART_RxNotify(port, BSP_USART_EVT_ERR);
+		if (port->err_cb != NULL)
+		{
+			port->err_cb(huart, error, port->rx_total);
+		}
+		
+		USART_PROF_END(port, BSP_USART_EVT_ERR);
+	}
+	else
+	{
+		#ifdef __ENABLE_SHELL
+		printf("Other USART Error!\r\n");
+		#endif
+	}
+}
+
+/**
+  * @brief  UART TX complete callback, shared by all ports
+  * @param  huart UART handle.
+  * @retval None
+  */
+void BSP_USART_TxCpltCb(UART_HandleTypeDef *huart)
+{
+	BSP_USART_Port_t *port = BSP_USART_GetPort(huart);
+	
+	if (port == NULL)
+	{
+		return;
+	}
+	
+	/* Release sent block and chain next one */
+	port->stats.tx_bytes += port->tx_dma_len;
+	lwrb_skip(&port->tx_rb, port->tx_dma_len);
+	port->tx_dma_len = 0u;
+	USART_TxKick(port);
+	
+	/* Wake writer waiting for free space */
+	osSemaphoreRelease(port->tx_sem);
+}
+
+/**
+  * @brief  UART port Init
+  * @param  port Port descriptor
+  * @retval None
+  *			Uart should config to DMA Rx circular mode and enable interrupt
+  */
+void BSP_USART_Init(BSP_USART_Port_t *port)
+{
+	/* Re-init restarts reception at buffer start, DMA may still run on old position or buffers */
+	HAL_UART_AbortReceive(port->huart);
+	
+	/* Size buffers from baud rate */
+	if (port->rx_pool != NULL)
+	{
+		USART_AutoSize(port);
+	}
+	
+	/* Init LwRB ring fifo, on top of DMA buffer in direct mode */
+	if (port->rx_rb_len == 0u)
+	{
+		lwrb_init(&port->rx_rb, port->rx_dma_buf, port->rx_dma_len);
+	}
+	else
+	{
+		lwrb_init(&port->rx_rb, port->rx_rb_data, port->rx_rb_len);
+	}
+	port->pos_last = 0;
+	port->poll_bit = BSP_USART_PollBit(port);
+	
+	/* Register rx event call back */
+	HAL_UART_RegisterRxEventCallback(port->huart, BSP_USART_RxEventCb);
+	
+	/* Register error call back */
+	HAL_UART_RegisterCallback(port->huart, HAL_UART_ERROR_CB_ID, BSP_USART_ErrorCb);
+	
+	/* TX queue drained by DMA, needs a TX DMA channel */
+	if ((port->tx_rb_len > 0u) && (port->huart->hdmatx != NULL))
+	{
+		lwrb_init(&port->tx_rb, port->tx_rb_data, port->tx_rb_len);
+		port->tx_dma_len = 0u;
+		if (port->tx_sem == NULL)
+		{
+			port->tx_sem = osSemaphoreNew(1u, 0u, NULL);
+		}
+		if (port->tx_mutex == NULL)
+		{
+			port->tx_mutex = osMutexNew(NULL);
+		}
+		HAL_UART_RegisterCallback(port->huart, HAL_UART_TX_COMPLETE_CB_ID, BSP_USART_TxCpltCb);
+	}
+	
+	/* Timestamps of RX events, profiling shares the counter */
+	BSP_USART_TIMESTAMP_INIT();
+	port->ts_char = (uint32_t)(((uint64_t)BSP_USART_TIMESTAMP_FREQ * USART_CharBitsX2(&port->huart->Init)) /
+							   (2u * port->huart->Init.BaudRate));
+	port->ts_rto = (uint32_t)(((uint64_t)BSP_USART_TIMESTAMP_FREQ * USART_RtoBits(port)) / port->huart->Init.BaudRate);
+	
+	/* Released start entry, no byte arrives before init */
+	port->ts_q[port->ts_w & (BSP_USART_TS_Q_LEN - 1u)].offset = port->rx_total;
+	port->ts_q[port->ts_w & (BSP_USART_TS_Q_LEN - 1u)].ts = BSP_USART_TIMESTAMP();
+	port->ts_w++;
+	port->ts_r = port->ts_w;
+	
+	/* Frame queue starts at current stream position */
+	port->frame_r = port->frame_w;
+	port->frame_start = port->rx_total;
+	BSP_CRC_Init();
+	port->rx_crc = BSP_CRC_Start(port->rx_crc_type);
+	if (port->frame_mode == BSP_USART_FRAME_CHAR)
+	{
+		/* ADD can only be written while USART is disabled */
+		__HAL_UART_DISABLE(port->huart);
+		MODIFY_REG(port->huart->Instance->CR2, USART_CR2_ADD, (uint32_t)port->frame_char << USART_CR2_ADD_Pos);
+		__HAL_UART_ENABLE(port->huart);
+	}
+	else if ((port->frame_mode == BSP_USART_FRAME_RTO) || (port->frame_mode == BSP_USART_FRAME_MODBUS))
+	{
+		/* Timeout follows Init.BaudRate, re-init port after changing it */
+		HAL_UART_ReceiverTimeout_Config(port->huart, USART_RtoBits(port));
+		HAL_UART_EnableReceiverTimeout(port->huart);
+	}
+	
+	/* DMA stops on a receive error instead of storing the bad byte, UE must be off to set it */
+	if (!READ_BIT(port->huart->Instance->CR3, USART_CR3_DDRE))
+	{
+		__HAL_UART_DISABLE(port->huart);
+		ATOMIC_SET_BIT(port->huart->Instance->CR3, USART_CR3_DDRE);
+		__HAL_UART_ENABLE(port->huart);
+	}
+	
+	/* Start UART */
+	if (port->dbm_len != 0u)
+	{
+		port->dbm_r = port->dbm_w;
+		USART_DbmStart(port, 0u);
+	}
+	else
+	{
+		HAL_UARTEx_ReceiveToIdle_DMA(port->huart, port->rx_dma_buf, port->rx_dma_len);
+	}
+	
+	/* Framing interrupt of a previous mode must not cut frames after re-init */
+	ATOMIC_CLEAR_BIT(port->huart->Instance->CR1, USART_CR1_CMIE | USART_CR1_RTOIE);
+	if (port->frame_mode == BSP_USART_FRAME_CHAR)
+	{
+		ATOMIC_SET_BIT(port->huart->Instance->CR1, USART_CR1_CMIE);
+	}
+	else if ((port->frame_mode == BSP_USART_FRAME_RTO) || (port->frame_mode == BSP_USART_FRAME_MODBUS))
+	{
+		ATOMIC_SET_BIT(port->huart->Instance->CR1, USART_CR1_RTOIE);
+	}
+}
+
+/**
+  * @brief  Block mode receive N byte until timeout
+  * @param  port Port descriptor
+  * @param	pData Received data
+  * @param	Size Received data size
+  * @param	Timeout Timeout in ms
+  * @retval HAL status
+  *			Calling task sleeps until RX callback sees Size bytes buffered.
+  *			Only one task may block on a port at a time.
+  */
+HAL_StatusTypeDef BSP_USART_Receive(BSP_USART_Port_t *port, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+	HAL_StatusTypeDef	status = HAL_OK;
+	uint32_t			tick_start;
+	uint32_t			elapsed;
+	uint32_t			ovr;
+    if ((pData == NULL) || (Size == 0U))
+    {
+      return  HAL_ERROR;
+    }
+	
+    /* Init tickstart for timeout management */
+    tick_start = HAL_GetTick();
+	
+	/* Publish wait threshold, drop stale wakeup first */
+	osThreadFlagsClear(USART_RX_THREAD_FLAG);
+	port->rx_waiter = osThreadGetId();
+	port->rx_wait_len = Size;
+	
+	/* Direct mode overrun during the copy drops it, wait for Size newest bytes again */
+	do
+	{
+		ovr = port->rx_ovr;
+		while (lwrb_get_full(&port->rx_rb) < Size)
+		{
+			elapsed = HAL_GetTick() - tick_start;
+			if ((Timeout == 0U) || ((Timeout != HAL_MAX_DELAY) && (elapsed >= Timeout)))
+			{
+				status = HAL_TIMEOUT;
+				break;
+			}
+			osThreadFlagsWait(USART_RX_THREAD_FLAG, osFlagsWaitAny,
+				(Timeout == HAL_MAX_DELAY) ? osWaitForever : BSP_USART_MsToTicks(Timeout - elapsed));
+		}
+	} while ((status == HAL_OK) && (USART_RxRead(port, pData, Size, ovr) == 0u));
+	port->rx_wait_len = 0u;
+	
+	if (status == HAL_OK)
+	{
+		USART_RtsRelease(port);
+	}
+	return status;
+}
+
+/**
+  * @brief  Receive data from Ring Buffer
+  * @param  port Port descriptor
+  * @param  pData Received data
+  * @param	MaxSize Max data size
+  * @retval Actual received data length
+  */
+uint16_t BSP_USART_ReadRB(BSP_USART_Port_t *port, uint8_t *pData, uint16_t MaxSize)
+{
+    if ((pData == NULL) || (MaxSize == 0U))
+    {
+      return  0u;
+    }
+	uint16_t RecvSize;
+	uint16_t Size;
+	uint32_t ovr;
+	
+	/* Direct mode overrun during the copy drops it, read newest data again */
+	do
+	{
+		ovr = port->rx_ovr;
+		RecvSize = lwrb_get_full(&port->rx_rb);
+		Size = RecvSize < MaxSize ? RecvSize : MaxSize;
+	} while ((Size != 0u) && (USART_RxRead(port, pData, Size, ovr) == 0u));
+	USART_RtsRelease(port);
+	return Size;
+}
+
+/**
+  * @brief  Attach a reader, it starts at newest data
+  * @param  port Port descriptor, ring buffer reception (not direct mode)
+  * @param  rd Reader, application owned
+  * @param  policy Overrun policy
+  * @retval HAL_OK, HAL_ERROR when BSP_USART_READER_MAX readers are attached
+  *			Once readers are attached the ring buffer read index follows the
+  *			slowest one, do not use the port read API alongside.
+  */
+HAL_StatusTypeDef BSP_USART_ReaderAttach(BSP_USART_Port_t *port, BSP_USART_Reader_t *rd, BSP_USART_RdPolicy_t policy)
+{
+	HAL_StatusTypeDef status = HAL_ERROR;
+	USART_ENTER_CRITICAL();
+	
+	if (port->reader_num < BSP_USART_READER_MAX)
+	{
+		rd->pos = port->rx_total;
+		rd->policy = policy;
+		rd->ovr = 0u;
+		rd->drop = 0u;
+		rd->waiter = NULL;
+		rd->attached = 1u;
+		port->reader[port->reader_num++] = rd;
+		USART_ReaderSync(port);
+		status = HAL_OK;
+	}
+	
+	USART_EXIT_CRITICAL();
+	return status;
+}
+
+/**
+  * @brief  Detach a reader, also one detached by its overrun policy
+  * @param  port Port descriptor
+  * @param  rd Reader
+  * @retval None
+  */
+void BSP_USART_ReaderDetach(BSP_USART_Port_t *port, BSP_USART_Reader_t *rd)
+{
+	uint8_t i;
+	
+	{
+		USART_ENTER_CRITICAL();
+		rd->attached = 0u;
+		for (i = 0u; i < port->reader_num; i++)
+		{
+			if (port->reader[i] == rd)
+			{
+				port->reader[i] = port->reader[--port->reader_num];
+				break;
+			}
+		}
+		USART_ReaderSync(port);
+		USART_EXIT_CRITICAL();
+	}
+	USART_RtsRelease(port);
+}
+
+/**
+  * @brief  Get unread data of a reader in place
+  * @param  port Port descriptor
+  * @param  rd Reader
+  * @param  blk Filled with up to 2 blocks, second one is the part after wrap
+  * @retval Number of valid blocks, 0 when nothing to read or detached
+  *			Data stays valid until BSP_USART_ReaderSkip(), unless a
+  *			DROP_OLDEST reader is overrun meanwhile, which the skip reports.
+  */
+uint8_t BSP_USART_ReaderPeek(BSP_USART_Port_t *port, BSP_USART_Reader_t *rd, BSP_USART_Block_t blk[2])
+{
+	uint32_t	avail;
+	uint32_t	idx;
+	uint8_t		n = 0u;
+	USART_ENTER_CRITICAL();
+	
+	blk[0].len = 0u;
+	blk[1].len = 0u;
+	avail = port->rx_total - rd->pos;
+	if ((rd->attached != 0u) && (avail != 0u))
+	{
+		/* Reader position relative to ring buffer read index */
+		idx = (uint8_t *)lwrb_get_linear_block_read_address(&port->rx_rb) - port->rx_rb.buff;
+		idx += rd->pos - (port->rx_total - lwrb_get_full(&port->rx_rb));
+		if (idx >= port->rx_rb.size)
+		{
+			idx -= port->rx_rb.size;
+		}
+		
+		blk[0].ptr = &port->rx_rb.buff[idx];
+		blk[0].len = (avail < (port->rx_rb.size - idx)) ? avail : (port->rx_rb.size - idx);
+		n = 1u;
+		if (blk[0].len < avail)
+		{
+			blk[1].ptr = &port->rx_rb.buff[0];
+			blk[1].len = avail - blk[0].len;
+			n = 2u;
+		}
+		rd->ovr = 0u;
+	}
+	
+	USART_EXIT_CRITICAL();
+	return n;
+}
+
+/**
+  * @brief  Release data a reader has used
+  * @param  port Port descriptor
+  * @param  rd Reader
+  * @param  len Bytes used from BSP_USART_ReaderPeek() blocks
+  * @retval Skipped length, 0 when the reader was overrun or detached since
+  *			the peek and its data may have been overwritten
+  */
+uint16_t BSP_USART_ReaderSkip(BSP_USART_Port_t *port, BSP_USART_Reader_t *rd, uint16_t len)
+{
+	uint32_t avail;
+	
+	{
+		USART_ENTER_CRITICAL();
+		avail = port->rx_total - rd->pos;
+		if ((rd->ovr != 0u) || (rd->attached == 0u))
+		{
+			len = 0u;
+		}
+		else
+		{
+			len = (len < avail) ? len : (uint16_t)avail;
+			rd->pos += len;
+			USART_ReaderSync(port);
+		}
+		USART_EXIT_CRITICAL();
+	}
+	USART_RtsRelease(port);
+	return len;
+}
+
+/**
+  * @brief  Wait until a reader has unread data
+  * @param  port Port descriptor
+  * @param  rd Reader
+  * @param	Timeout Timeout in ms, HAL_MAX_DELAY wait forever
+  * @retval HAL_OK with data, HAL_ERROR when detached, HAL_TIMEOUT
+  *			Readers wake on the same events as the port semaphore.
+  */
+HAL_StatusTypeDef BSP_USART_ReaderWait(BSP_USART_Port_t *port, BSP_USART_Reader_t *rd, uint32_t Timeout)
+{
+	uint32_t tick_start = HAL_GetTick();
+	uint32_t elapsed;
+	
+	osThreadFlagsClear(USART_READER_THREAD_FLAG);
+	rd->waiter = osThreadGetId();
+	for (;;)
+	{
+		if (rd->attached == 0u)
+		{
+			rd->waiter = NULL;
+			return HAL_ERROR;
+		}
+		if (rd->pos != port->rx_total)
+		{
+			rd->waiter = NULL;
+			return HAL_OK;
+		}
+		elapsed = HAL_GetTick() - tick_start;
+		if ((Timeout == 0u) || ((Timeout != HAL_MAX_DELAY) && (elapsed >= Timeout)))
+		{
+			rd->waiter = NULL;
+			return HAL_TIMEOUT;
+		}
+		osThreadFlagsWait(USART_READER_THREAD_FLAG, osFlagsWaitAny,
+			(Timeout == HAL_MAX_DELAY) ? osWaitForever : BSP_USART_MsToTicks(Timeout - elapsed));
+	}
+}
+
+/**
+  * @brief  Receive data from ring buffer with its arrival time
+  * @param  port Port descriptor
+  * @param  pData Received data
+  * @param	MaxSize Max data size
+  * @param	t_first Arrival of first byte, may be NULL
+  * @param	t_last Arrival of last byte, may be NULL
+  * @retval Actual received data length
+  *			Times are BSP_USART_TIMESTAMP() ticks at the stop bit of a byte,
+  *			interpolated at the character rate between RX events. Stream mode
+  *			only, frame and double buffer reads do not consume timestamps.
+  */
+uint16_t BSP_USART_ReadRBTs(BSP_USART_Port_t *port, uint8_t *pData, uint16_t MaxSize, uint32_t *t_first, uint32_t *t_last)
+{
+	uint32_t	first;
+	uint32_t	end;
+	uint32_t	full;
+	uint32_t	ovr;
+	uint16_t	Size;
+	
+	if ((pData == NULL) || (MaxSize == 0U))
+	{
+		return 0u;
+	}
+	
+	/* Stream offset of first byte must match the data actually read */
+	do
+	{
+		{
+			USART_ENTER_CRITICAL();
+			ovr = port->rx_ovr;
+			full = lwrb_get_full(&port->rx_rb);
+			first = port->rx_total - full;
+			USART_EXIT_CRITICAL();
+		}
+		Size = (full < MaxSize) ? (uint16_t)full : MaxSize;
+	} while ((Size != 0u) && (USART_RxRead(port, pData, Size, ovr) == 0u));
+	USART_RtsRelease(port);
+	if (Size == 0u)
+	{
+		return 0u;
+	}
+	end = first + Size;
+	
+	{
+		USART_ENTER_CRITICAL();
+		if (t_first != NULL)
+		{
+			*t_first = USART_TsLookup(port, first);
+		}
+		if (t_last != NULL)
+		{
+			*t_last = USART_TsLookup(port, end - 1u);
+		}
+		
+		/* Release events whose data is all read */
+		if ((port->ts_w - port->ts_r) > BSP_USART_TS_Q_LEN)
+		{
+			port->ts_r = port->ts_w - BSP_USART_TS_Q_LEN;
+		}
+		while ((port->ts_r != port->ts_w) &&
+			   ((int32_t)(port->ts_q[port->ts_r & (BSP_USART_TS_Q_LEN - 1u)].offset - end) <= 0))
+		{
+			port->ts_r++;
+		}
+		USART_EXIT_CRITICAL();
+	}
+	return Size;
+}
+
+/**
+  * @brief  Get readable data of ring buffer in place
+  * @param  port Port descriptor
+  * @param  blk Filled with up to 2 blocks, second one is the part after wrap
+  * @retval Number of valid blocks, 0 when ring buffer is empty
+  *			Data stays valid until BSP_USART_Skip() releases it. In direct
+  *			mode DMA may overwrite it first, BSP_USART_Skip() reports that.
+  */
+uint8_t BSP_USART_Peek(BSP_USART_Port_t *port, BSP_USART_Block_t blk[2])
+{
+	uint16_t	full;
+	uint16_t	r;
+	uint8_t		n = 0u;
+	USART_ENTER_CRITICAL();
+	
+	/*
+	 * Direct mode RX interrupt skips overwritten data and so moves the read
+	 * index too, level and index must come from the same moment.
+	 */
+	full = lwrb_get_full(&port->rx_rb);
+	r = (uint8_t *)lwrb_get_linear_block_read_address(&port->rx_rb) - port->rx_rb.buff;
+	port->peek_ovr = port->rx_ovr;
+	
+	blk[0].len = 0u;
+	blk[1].len = 0u;
+	if (full != 0u)
+	{
+		blk[0].ptr = &port->rx_rb.buff[r];
+		blk[0].len = full < (port->rx_rb.size - r) ? full : (port->rx_rb.size - r);
+		n = 1u;
+		if (blk[0].len < full)
+		{
+			blk[1].ptr = &port->rx_rb.buff[0];
+			blk[1].len = full - blk[0].len;
+			n = 2u;
+		}
+	}
+	
+	USART_EXIT_CRITICAL();
+	return n;
+}
+
+/**
+  * @brief  Release bytes returned by BSP_USART_Peek()
+  * @param  port Port descriptor
+  * @param  len Bytes consumed
+  * @retval Actual skipped length, 0 when DMA overran the peeked data in
+  *			direct mode, it may be torn, peek again
+  */
+uint16_t BSP_USART_Skip(BSP_USART_Port_t *port, uint16_t len)
+{
+	{
+		USART_ENTER_CRITICAL();
+		if (port->rx_ovr != port->peek_ovr)
+		{	/* Overwritten part is already skipped by RX interrupt */
+			len = 0u;
+		}
+		else
+		{
+			len = lwrb_skip(&port->rx_rb, len);
+		}
+		USART_EXIT_CRITICAL();
+	}
+	USART_RtsRelease(port);
+	return len;
+}
+
+/**
+  * @brief  Select character match framing, call before BSP_USART_Init()
+  * @param  port Port descriptor
+  * @param  delim Frame delimiter, e.g. '\n' or 0x7E
+  * @retval None
+  *			BSP_USART_IRQHandler() must be called from USARTx_IRQHandler().
+  */
+void BSP_USART_SetFrameChar(BSP_USART_Port_t *port, uint8_t delim)
+{
+	port->frame_char = delim;
+	port->frame_mode = BSP_USART_FRAME_CHAR;
+}
+
+/**
+  * @brief  Select receiver timeout framing, call before BSP_USART_Init()
+  * @param  port Port descriptor, LPUART has no receiver timeout
+  * @param  gap_x10 Line idle time which ends a frame, in 1/10 character times
+  * @retval None
+  *			BSP_USART_IRQHandler() must be called from USARTx_IRQHandler().
+  */
+void BSP_USART_SetFrameTimeout(BSP_USART_Port_t *port, uint16_t gap_x10)
+{
+	port->frame_gap = gap_x10;
+	port->frame_mode = BSP_USART_FRAME_RTO;
+}
+
+/**
+  * @brief  Select Modbus RTU framing, call before BSP_USART_Init()
+  * @param  port Port descriptor, LPUART has no receiver timeout
+  * @retval None
+  *			Frames end after 3.5 character times, 1750us above 19200 baud.
+  *			Only frames with good CRC are queued, CRC bytes included.
+  *			BSP_USART_IRQHandler() must be called from USARTx_IRQHandler().
+  */
+void BSP_USART_SetModbusRTU(BSP_USART_Port_t *port)
+{
+	port->frame_gap = MODBUS_GAP_X10;
+	port->frame_mode = BSP_USART_FRAME_MODBUS;
+	port->rx_crc_type = BSP_CRC16_MODBUS;
+}
+
+/**
+  * @brief  Read one complete frame
+  * @param  port Port descriptor
+  * @param  pData Frame data, delimiter included
+  * @param  MaxSize Buffer size, longer frame is truncated
+  * @retval Frame length, 0 when no complete frame is queued
+  */
+uint16_t BSP_USART_ReadFrame(BSP_USART_Port_t *port, uint8_t *pData, uint16_t MaxSize)
+{
+	uint16_t	len;
+	uint16_t	n;
+	uint32_t	ovr;
+	
+	/* Direct mode overrun during the copy drops it, the frame may be gone too */
+	do
+	{
+		ovr = port->rx_ovr;
+		len = USART_FrameFront(port);
+		if (len == 0u)
+		{
+			return 0u;
+		}
+		n = len < MaxSize ? len : MaxSize;
+	} while ((n != 0u) && (USART_RxRead(port, pData, n, ovr) == 0u));
+	
+	/* Truncated rest, on overrun the next front frame skips it */
+	if (len > n)
+	{
+		USART_RxRead(port, NULL, len - n, ovr);
+	}
+	port->frame_r++;
+	USART_RtsRelease(port);
+	return len;
+}
+
+/**
+  * @brief  Get one complete frame in place
+  * @param  port Port descriptor
+  * @param  blk Filled with up to 2 blocks covering the frame
+  * @retval Frame length, 0 when no complete frame is queued
+  *			Release it with BSP_USART_SkipFrame().
+  */
+uint16_t BSP_USART_PeekFrame(BSP_USART_Port_t *port, BSP_USART_Block_t blk[2])
+{
+	uint16_t len = USART_FrameFront(port);
+	
+	if (len == 0u)
+	{
+		return 0u;
+	}
+	BSP_USART_Peek(port, blk);
+	if (blk[0].len >= len)
+	{
+		blk[0].len = len;
+		blk[1].len = 0u;
+	}
+	else
+	{
+		blk[1].len = len - blk[0].len;
+	}
+	return len;
+}
+
+/**
+  * @brief  Release the frame returned by BSP_USART_PeekFrame()
+  * @param  port Port descriptor
+  * @retval None
+  */
+void BSP_USART_SkipFrame(BSP_USART_Port_t *port)
+{
+	uint32_t ovr = port->rx_ovr;
+	uint16_t len = USART_FrameFront(port);
+	
+	if (len != 0u)
+	{
+		/* On overrun the next front frame skips what is left */
+		USART_RxRead(port, NULL, len, ovr);
+		port->frame_r++;
+		USART_RtsRelease(port);
+	}
+}
+
+/**
+  * @brief  CRC of the oldest queued frame
+  * @param  port Port descriptor
+  * @retval CRC over all frame bytes, 0 when no frame or no CRC type set
+  *			Call before BSP_USART_ReadFrame() or BSP_USART_SkipFrame().
+  */
+uint32_t BSP_USART_GetFrameCrc(BSP_USART_Port_t *port)
+{
+	if (USART_FrameFront(port) == 0u)
+	{
+		return 0u;
+	}
+	return port->frame_q[port->frame_r & (BSP_USART_FRAME_Q_LEN - 1u)].crc;
+}
+
+/**
+  * @brief  Select double buffer DMA reception, call before BSP_USART_Init()
+  * @param  port Port descriptor
+  * @param  buf0, buf1 DMA buffers, cache line aligned and whole lines
+  * @param  len Length of each buffer
+  * @retval None
+  *			DMA fills one buffer while application reads the other, data is
+  *			handed over in place when a buffer is full or line goes idle.
+  *			Ring buffer, framing and CRC are not used in this mode.
+  *			BSP_USART_IRQHandler() must be called from USARTx_IRQHandler().
+  */
+void BSP_USART_SetDoubleBuffer(BSP_USART_Port_t *port, uint8_t *buf0, uint8_t *buf1, uint16_t len)
+{
+	port->dbm_buf[0] = buf0;
+	port->dbm_buf[1] = buf1;
+	port->dbm_len = len;
+}
+
+/**
+  * @brief  Get oldest received double buffer block
+  * @param  port Port descriptor
+  * @param  data Set to block data
+  * @retval Block length, 0 when none
+  *			Block stays owned by application until BSP_USART_DbmRelease().
+  *			Blocks DMA already refilled are dropped and counted in rx_drop.
+  */
+uint16_t BSP_USART_DbmAcquire(BSP_USART_Port_t *port, const uint8_t **data)
+{
+	BSP_USART_DbmBlk_t *blk;
+	
+	while (port->dbm_r != port->dbm_w)
+	{
+		blk = &port->dbm_q[port->dbm_r & (BSP_USART_DBM_Q_LEN - 1u)];
+		if (USART_DbmIntact(port, blk) != 0u)
+		{
+			#ifdef CACHE_SUPPORT
+			/* DMA wrote it, CPU never does, whole lines are safe to drop */
+			SCB_InvalidateDCache_by_Addr((uint32_t *)&port->dbm_buf[blk->buf][blk->off & ~(USART_CACHE_LINE - 1u)],
+				((blk->off + blk->len + USART_CACHE_LINE - 1u) & ~(USART_CACHE_LINE - 1u)) - (blk->off & ~(USART_CACHE_LINE - 1u)));
+			#endif
+			*data = &port->dbm_buf[blk->buf][blk->off];
+			return blk->len;
+		}
+		
+		/* Overrun, application was a whole buffer behind */
+		port->stats.rx_drop += blk->len;
+		port->dbm_r++;
+	}
+	return 0u;
+}
+
+/**
+  * @brief  Give block returned by BSP_USART_DbmAcquire() back to DMA
+  * @param  port Port descriptor
+  * @retval 1 when block data was intact until now, 0 when DMA refilled it meanwhile
+  */
+uint8_t BSP_USART_DbmRelease(BSP_USART_Port_t *port)
+{
+	BSP_USART_DbmBlk_t	*blk = &port->dbm_q[port->dbm_r & (BSP_USART_DBM_Q_LEN - 1u)];
+	uint8_t				ok = USART_DbmIntact(port, blk);
+	
+	if (port->dbm_r == port->dbm_w)
+	{
+		return 0u;
+	}
+	if (!ok)
+	{
+		port->stats.rx_drop += blk->len;
+	}
+	port->dbm_r++;
+	return ok;
+}
+
+/**
+  * @brief  Select running CRC of received data
+  * @param  port Port descriptor
+  * @param  type BSP_CRC_Type_t, BSP_CRC_NONE to disable
+  * @retval None
+  *			CRC restarts at every frame end in framing modes, otherwise on
+  *			BSP_USART_ResetRxCrc(). Modbus RTU mode always uses CRC16.
+  */
+void BSP_USART_SetRxCrc(BSP_USART_Port_t *port, uint8_t type)
+{
+	USART_ENTER_CRITICAL();
+	port->rx_crc_type = type;
+	port->rx_crc = BSP_CRC_Start((BSP_CRC_Type_t)type);
+	USART_EXIT_CRITICAL();
+}
+
+/**
+  * @brief  Get running CRC of received data
+  * @param  port Port descriptor
+  * @param  offset Stream offset the CRC ends at, may be NULL
+  * @retval CRC of bytes accepted since last restart
+  */
+uint32_t BSP_USART_GetRxCrc(BSP_USART_Port_t *port, uint32_t *offset)
+{
+	uint32_t crc;
+	USART_ENTER_CRITICAL();
+	
+	crc = BSP_CRC_Final(port->rx_crc_type, port->rx_crc);
+	if (offset != NULL)
+	{
+		*offset = port->rx_total;
+	}
+	
+	USART_EXIT_CRITICAL();
+	return crc;
+}
+
+/**
+  * @brief  Restart running CRC at current stream position
+  * @param  port Port descriptor
+  * @retval None
+  */
+void BSP_USART_ResetRxCrc(BSP_USART_Port_t *port)
+{
+	USART_ENTER_CRITICAL();
+	port->rx_crc = BSP_CRC_Start(port->rx_crc_type);
+	USART_EXIT_CRITICAL();
+}
+
+/**
+  * @brief  Set RX watermark
+  * @param  port Port descriptor
+  * @param  level Buffered bytes which release port semaphore on HT/TC event,
+  *			0 only notify on IDLE
+  * @retval None
+  */
+void BSP_USART_SetRxWatermark(BSP_USART_Port_t *port, uint16_t level)
+{
+	port->rx_wm_auto = 0u;
+	port->rx_notify_level = level;
+}
+
+/**
+  * @brief  Set RX watermark as percentage of ring buffer capacity
+  * @param  port Port descriptor, must be initialized
+  * @param  percent 1 ~ 100, 0 only notify on IDLE
+  * @retval None
+  */
+void BSP_USART_SetRxWatermarkPct(BSP_USART_Port_t *port, uint8_t percent)
+{
+	uint32_t capacity = port->rx_rb.size - 1u;
+	uint32_t level = (capacity * (percent > 100u ? 100u : percent) + 99u) / 100u;
+	
+	port->rx_wm_auto = 0u;
+	port->rx_notify_level = (percent == 0u) ? 0u : (level == 0u ? 1u : level);
+}
+
+/**
+  * @brief  Let RX watermark follow observed burst sizes
+  * @param  port Port descriptor, must be initialized
+  * @param  min_level Lowest watermark, 0 stop adapting and keep current one
+  * @retval None
+  */
+void BSP_USART_SetRxWatermarkAuto(BSP_USART_Port_t *port, uint16_t min_level)
+{
+	USART_ENTER_CRITICAL();
+	port->rx_wm_auto = (min_level != 0u);
+	port->rx_wm_min = min_level;
+	port->rx_burst_start = port->rx_total;
+	port->rx_burst_avg = (uint32_t)min_level * 2u * 8u;
+	if (port->rx_wm_auto != 0u)
+	{
+		port->rx_notify_level = min_level;
+	}
+	USART_EXIT_CRITICAL();
+}
+
+/**
+  * @brief  Set consumer latency used to size ring buffer, call before BSP_USART_Init()
+  * @param  port Port descriptor with RX pool
+  * @param  us Longest time consumer may not read, 0 use USART_RX_LATENCY_US
+  * @retval None
+  */
+void BSP_USART_SetRxLatency(BSP_USART_Port_t *port, uint32_t us)
+{
+	port->rx_latency_us = us;
+}
+
+/**
+  * @brief  Create event flags of BSP_USART_Poll(), call once after kernel init
+  * @retval osOK, osErrorNoMemory when creation fails
+  */
+osStatus_t BSP_USART_PollInit(void)
+{
+	if (usart_poll_ef == NULL)
+	{
+		usart_poll_ef = osEventFlagsNew(NULL);
+	}
+	return (usart_poll_ef != NULL) ? osOK : osErrorNoMemory;
+}
+
+/**
+  * @brief  Event flag of a port in BSP_USART_Poll() masks
+  * @param  port Port descriptor
+  * @retval Port bit, 0 if port is not in port table
+  */
+uint32_t BSP_USART_PollBit(const BSP_USART_Port_t *port)
+{
+	uint32_t i;
+	
+	for (i = 0u; (usart_port_tbl[i] != NULL) && (i < USART_POLL_MAX_PORTS); i++)
+	{
+		if (usart_port_tbl[i] == port)
+		{
+			return 1uL << i;
+		}
+	}
+	return 0u;
+}
+
+/**
+  * @brief  Set buffered bytes a port needs to be ready in BSP_USART_Poll()
+  * @param  port Port descriptor
+  * @param  level Ready once this many bytes are buffered, checked on every
+  *			RX event, 0 ready on IDLE with any data
+  * @retval None
+  *			Frame and double buffer ports are ready with a whole frame or block.
+  */
+void BSP_USART_SetPollLevel(BSP_USART_Port_t *port, uint16_t level)
+{
+	port->poll_level = level;
+}
+
+/**
+  * @brief  Wait until any of the ports has data
+  * @param  mask Ports to wait on, BSP_USART_PollBit() ored
+  * @param	Timeout Timeout in ms, 0 check only, HAL_MAX_DELAY wait forever
+  * @retval Mask of ready ports, 0 on timeout
+  *			Ready state is level triggered, a port stays ready until read.
+  *			Only one task may poll a port at a time, port semaphores keep
+  *			working for tasks not using this call.
+  */
+uint32_t BSP_USART_Poll(uint32_t mask, uint32_t Timeout)
+{
+	uint32_t tick_start = HAL_GetTick();
+	uint32_t elapsed;
+	uint32_t ready;
+	uint32_t i;
+	
+	if (usart_poll_ef == NULL)
+	{
+		return 0u;
+	}
+	
+	while (1)
+	{
+		/* Flags set after clearing keep the wait from missing data checked below */
+		osEventFlagsClear(usart_poll_ef, mask);
+		ready = 0u;
+		for (i = 0u; (usart_port_tbl[i] != NULL) && (i < USART_POLL_MAX_PORTS); i++)
+		{
+			if (((mask & (1uL << i)) != 0u) && (USART_PollReady(usart_port_tbl[i]) != 0u))
+			{
+				ready |= 1uL << i;
+			}
+		}
+		
+		elapsed = HAL_GetTick() - tick_start;
+		if ((ready != 0u) || (Timeout == 0u) || ((Timeout != HAL_MAX_DELAY) && (elapsed >= Timeout)))
+		{
+			return ready;
+		}
+		osEventFlagsWait(usart_poll_ef, mask, osFlagsWaitAny,
+						 (Timeout == HAL_MAX_DELAY) ? osWaitForever : BSP_USART_MsToTicks(Timeout - elapsed));
+	}
+}
+
+/**
+  * @brief  Set RTS flow control, call before BSP_USART_Init()
+  * @param  port Port descriptor, ring buffer reception
+  * @param  high Ring buffer level that stops the sender, 0 disable
+  * @param  low Level at which it may go on
+  * @param  gpio RTS pin port, NULL for USART RTS with hardware flow control
+  *			configured (RTSE)
+  * @param  pin RTS pin of gpio, active low
+  * @retval None
+  *			Above high leave room for bytes the sender still has in flight,
+  *			a few with a GPIO RTS. In frame modes high must fit the longest
+  *			frame, consumer cannot drain half a frame.
+  */
+void BSP_USART_SetRtsFlow(BSP_USART_Port_t *port, uint16_t high, uint16_t low, GPIO_TypeDef *gpio, uint16_t pin)
+{
+	port->rts_high = high;
+	port->rts_low = (low < high) ? low : 0u;
+	port->rts_gpio = gpio;
+	port->rts_pin = pin;
+	port->rts_held = 0u;
+	if (gpio != NULL)
+	{
+		HAL_GPIO_WritePin(gpio, pin, GPIO_PIN_RESET);
+	}
+	#ifdef __ENABLE_SHELL
+	if ((high != 0u) && (gpio == NULL) && !READ_BIT(port->huart->Instance->CR3, USART_CR3_RTSE))
+	{
+		printf("usart rts flow control without RTSE!\r\n");
+	}
+	#endif
+}
+
+/**
+  * @brief  Set receive error report
+  * @param  port Port descriptor
+  * @param  cb Called from error interrupt after reception restarted, NULL none
+  * @retval None
+  */
+void BSP_USART_SetErrorCallback(BSP_USART_Port_t *port, BSP_USART_ErrCb_t cb)
+{
+	port->err_cb = cb;
+}
+
+/**
+  * @brief  Forward received data instead of buffering it
+  * @param  port Port descriptor, ring buffer reception
+  * @param  fwd Called with each linear block from RX interrupt, NULL back to ring buffer
+  * @param  ctx Passed to fwd
+  * @retval None
+  *			Events, semaphore, CRC and statistics work as before, ring buffer
+  *			stays empty. See BSP_IPC_PortFwd() in bsp_usart_ipc.h.
+  */
+void BSP_USART_SetRxForward(BSP_USART_Port_t *port, BSP_USART_RxFwd_t fwd, void *ctx)
+{
+	USART_ENTER_CRITICAL();
+	port->rx_fwd_ctx = ctx;
+	port->rx_fwd = fwd;
+	USART_EXIT_CRITICAL();
+}
+
+/**
+  * @brief  Prepare an asynchronous receive request
+  * @param  req Request, application owned
+  * @param  cb Completion callback
+  * @param  ctx Caller data, req->ctx
+  * @param  from_isr 1 complete in RX interrupt, 0 in the task running BSP_USART_AsyncRun()
+  * @retval None
+  *			Timeouts always complete in the worker task.
+  */
+void BSP_USART_AsyncSetup(BSP_USART_Async_t *req, BSP_USART_AsyncCb_t cb, void *ctx, uint8_t from_isr)
+{
+	req->cb = cb;
+	req->ctx = ctx;
+	req->from_isr = from_isr;
+}
+
+/**
+  * @brief  Start an asynchronous receive
+  * @param  port Port descriptor, ring buffer reception
+  * @param  req Request set up by BSP_USART_AsyncSetup()
+  * @param  mode Completion condition
+  * @param	pData Received data
+  * @param	Size Data size, or max size of frame and any mode
+  * @param	Timeout Timeout in ms, HAL_MAX_DELAY wait forever
+  * @retval HAL_OK, HAL_BUSY when a request is pending on port, HAL_ERROR
+  *			Returns at once, req->cb reports the result. Do not read the port
+  *			otherwise while a request is pending.
+  */
+HAL_StatusTypeDef BSP_USART_ReceiveAsync(BSP_USART_Port_t *port, BSP_USART_Async_t *req, BSP_USART_AsyncMode_t mode,
+										 uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+	HAL_StatusTypeDef	status = HAL_OK;
+	osThreadId_t		worker;
+	
+	if ((req == NULL) || (req->cb == NULL) || (pData == NULL) || (Size == 0u) ||
+		((mode == BSP_USART_ASYNC_LEN) && (Size >= port->rx_rb.size)))
+	{
+		return HAL_ERROR;
+	}
+	
+	req->buf = pData;
+	req->size = Size;
+	req->mode = (uint8_t)mode;
+	req->start = HAL_GetTick();
+	req->timeout = Timeout;
+	{
+		USART_ENTER_CRITICAL();
+		if (port->async != NULL)
+		{
+			status = HAL_BUSY;
+		}
+		else
+		{
+			/* Data left from a finished burst counts as a pause */
+			port->async_pause = (lwrb_get_full(&port->rx_rb) != 0u) ? 1u : 0u;
+			port->async = req;
+		}
+		USART_EXIT_CRITICAL();
+	}
+	
+	/* Worker picks up new deadline and data already buffered */
+	worker = usart_async_thread;
+	if ((status == HAL_OK) && (worker != NULL))
+	{
+		osThreadFlagsSet(worker, USART_ASYNC_THREAD_FLAG);
+	}
+	return status;
+}
+
+/**
+  * @brief  Withdraw a pending asynchronous receive
+  * @param  port Port descriptor
+  * @param  req Request
+  * @retval 1 withdrawn without callback, 0 it was no longer pending
+  */
+uint8_t BSP_USART_CancelAsync(BSP_USART_Port_t *port, BSP_USART_Async_t *req)
+{
+	return USART_AsyncClaim(port, req);
+}
+
+/**
+  * @brief  Complete asynchronous receives of all ports, one round
+  * @param	Timeout Max time in ms to wait for work, HAL_MAX_DELAY wait forever
+  * @retval Completed requests
+  *			Run from one task, for (;;) BSP_USART_AsyncRun(HAL_MAX_DELAY);
+  *			callbacks of many protocol handlers then share its stack.
+  */
+uint32_t BSP_USART_AsyncRun(uint32_t Timeout)
+{
+	BSP_USART_Port_t *const	*pp;
+	BSP_USART_Async_t		*req;
+	uint32_t				wait = Timeout;
+	uint32_t				now;
+	uint32_t				elapsed;
+	uint32_t				done = 0u;
+	
+	usart_async_thread = osThreadGetId();
+	
+	/* Sleep until an RX event, a submit or the nearest deadline */
+	now = HAL_GetTick();
+	for (pp = usart_port_tbl; (*pp != NULL) && (wait != 0u); pp++)
+	{
+		req = (*pp)->async;
+		if (req == NULL)
+		{
+			continue;
+		}
+		if (USART_AsyncReady(*pp, req) != 0u)
+		{
+			wait = 0u;
+		}
+		else if (req->timeout != HAL_MAX_DELAY)
+		{
+			elapsed = now - req->start;
+			if (elapsed >= req->timeout)
+			{
+				wait = 0u;
+			}
+			else if ((req->timeout - elapsed) < wait)
+			{
+				wait = req->timeout - elapsed;
+			}
+		}
+	}
+	if (wait != 0u)
+	{
+		osThreadFlagsWait(USART_ASYNC_THREAD_FLAG, osFlagsWaitAny,
+			(wait == HAL_MAX_DELAY) ? osWaitForever : BSP_USART_MsToTicks(wait));
+	}
+	
+	now = HAL_GetTick();
+	for (pp = usart_port_tbl; *pp != NULL; pp++)
+	{
+		req = (*pp)->async;
+		if ((req == NULL) || ((USART_AsyncReady(*pp, req) == 0u) &&
+			((req->timeout == HAL_MAX_DELAY) || ((now - req->start) < req->timeout))))
+		{
+			continue;
+		}
+		if (USART_AsyncClaim(*pp, req) != 0u)
+		{
+			USART_AsyncFinish(*pp, req);
+			done++;
+		}
+	}
+	return done;
+}
+
+/**
+  * @brief  Take a consistent snapshot of port statistics
+  * @param  port Port descriptor
+  * @param  stats Snapshot output
+  * @retval None
+  */
+void BSP_USART_GetStats(BSP_USART_Port_t *port, BSP_USART_Stats_t *stats)
+{
+	USART_ENTER_CRITICAL();
+	*stats = port->stats;
+	USART_EXIT_CRITICAL();
+}
+
+/**
+  * @brief  Clear port statistics
+  * @param  port Port descriptor
+  * @retval None
+  */
+void BSP_USART_ResetStats(BSP_USART_Port_t *port)
+{
+	USART_ENTER_CRITICAL();
+	memset(&port->stats, 0, sizeof(port->stats));
+	USART_EXIT_CRITICAL();
+}
+
+#ifdef USART_PROFILE
+/**
+  * @brief  Take a snapshot of callback profile of one event type
+  * @param  port Port descriptor
+  * @param  evt Event type
+  * @param  prof Snapshot output, mean is calculated here
+  * @retval None
+  */
+void BSP_USART_GetProfile(BSP_USART_Port_t *port, BSP_USART_Evt_t evt, BSP_USART_Prof_t *prof)
+{
+	USART_ENTER_CRITICAL();
+	*prof = port->prof[evt];
+	USART_EXIT_CRITICAL();
+	
+	prof->mean = (prof->count == 0u) ? 0u : (uint32_t)(prof->sum / prof->count);
+}
+
+/**
+  * @brief  Clear callback profile of all event types
+  * @param  port Port descriptor
+  * @retval None
+  */
+void BSP_USART_ResetProfile(BSP_USART_Port_t *port)
+{
+	USART_ENTER_CRITICAL();
+	memset(port->prof, 0, sizeof(port->prof));
+	USART_EXIT_CRITICAL();
+}
+#endif
+
+/**
+  * @brief  Clear ring buffer data
+  * @param  port Port descriptor
+  * @retval None
+  */
+void BSP_USART_Reset(BSP_USART_Port_t *port)
+{
+	uint8_t i;
+	
+	{
+		USART_ENTER_CRITICAL();
+		/* Drop all unread data, readers included */
+		lwrb_skip(&port->rx_rb, lwrb_get_full(&port->rx_rb));
+		for (i = 0u; i < port->reader_num; i++)
+		{
+			port->reader[i]->pos = port->rx_total;
+		}
+		port->dbm_r = port->dbm_w;
+		port->ts_r = port->ts_w;
+		USART_EXIT_CRITICAL();
+	}
+	USART_RtsRelease(port);
+}
+
+/**
+  * @brief  Queue data for DMA transmit
+  * @param  port Port descriptor
+  * @param	pData Data to send
+  * @param	Size Data size
+  * @param	Timeout Max time in ms to wait for queue space, 0 never block
+  * @retval HAL_OK when all data is queued, HAL_TIMEOUT when only part of it is
+  *			Returns as soon as data is in the queue, not when it is on the wire.
+  *			Ports without TX queue fall back to polling HAL_UART_Transmit.
+  */
+HAL_StatusTypeDef BSP_USART_Transmit(BSP_USART_Port_t *port, const uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+	HAL_StatusTypeDef	status = HAL_OK;
+	uint32_t			tick_start;
+	uint32_t			elapsed;
+	size_t				written;
+	
+	if ((pData == NULL) || (Size == 0U))
+	{
+		return  HAL_ERROR;
+	}
+	if (!lwrb_is_ready(&port->tx_rb))
+	{
+		status = HAL_UART_Transmit(port->huart, pData, Size, Timeout);
+		if (status == HAL_OK)
+		{
+			port->stats.tx_bytes += Size;
+		}
+		return status;
+	}
+	
+	osMutexAcquire(port->tx_mutex, osWaitForever);
+	
+	tick_start = HAL_GetTick();
+	for (;;)
+	{
+		/* Interrupt writers of BSP_USART_TryTransmit() share the queue */
+		{
+			USART_ENTER_CRITICAL();
+			written = lwrb_write(&port->tx_rb, pData, Size);
+			USART_EXIT_CRITICAL();
+		}
+		pData += written;
+		Size -= written;
+		USART_TxKick(port);
+		
+		if (Size == 0u)
+		{
+			break;
+		}
+		
+		/* Queue full, sleep until TX complete frees some space */
+		elapsed = HAL_GetTick() - tick_start;
+		if ((Timeout == 0u) || ((Timeout != HAL_MAX_DELAY) && (elapsed >= Timeout)))
+		{
+			status = HAL_TIMEOUT;
+			break;
+		}
+		osSemaphoreAcquire(port->tx_sem, (Timeout == HAL_MAX_DELAY) ? osWaitForever : BSP_USART_MsToTicks(Timeout - elapsed));
+	}
+	
+	osMutexRelease(port->tx_mutex);
+	return status;
+}
+
+/**
+  * @brief  Queue data for DMA transmit only if it fits as a whole
+  * @param  port Port descriptor with TX queue
+  * @param	pData Data to send
+  * @param	Size Data size
+  * @retval HAL_OK when queued, HAL_BUSY when queue is full, HAL_ERROR without TX queue
+  *			Never blocks, callable from any task or interrupt. Data of one
+  *			call is never interleaved with other writers.
+  */
+HAL_StatusTypeDef BSP_USART_TryTransmit(BSP_USART_Port_t *port, const uint8_t *pData, uint16_t Size)
+{
+	HAL_StatusTypeDef status = HAL_BUSY;
+	
+	if ((pData == NULL) || (Size == 0U) || !lwrb_is_ready(&port->tx_rb))
+	{
+		return HAL_ERROR;
+	}
+	
+	{
+		USART_ENTER_CRITICAL();
+		if (lwrb_get_free(&port->tx_rb) >= Size)
+		{
+			lwrb_write(&port->tx_rb, pData, Size);
+			status = HAL_OK;
+		}
+		USART_EXIT_CRITICAL();
+	}
+	
+	if (status == HAL_OK)
+	{
+		USART_TxKick(port);
+	}
+	return status;
+}
+
+/**
+  * @brief  Send whole TX queue by polling with interrupts disabled
+  * @param  port Port descriptor
+  * @retval None
+  *			For fault handlers and asserts, the RTOS need not run. Stops TX
+  *			DMA, sends what it did not and leaves TX DMA idle.
+  */
+void BSP_USART_TxFlush(BSP_USART_Port_t *port)
+{
+	uint8_t	*addr;
+	size_t	len;
+	USART_ENTER_CRITICAL();
+	
+	if (lwrb_is_ready(&port->tx_rb))
+	{
+		/* Drop part of in flight block already sent */
+		if (port->tx_dma_len != 0u)
+		{
+			HAL_UART_AbortTransmit(port->huart);
+			len = port->tx_dma_len - __HAL_DMA_GET_COUNTER(port->huart->hdmatx);
+			port->stats.tx_bytes += len;
+			lwrb_skip(&port->tx_rb, len);
+			port->tx_dma_len = 0u;
+		}
+		
+		/* Timeout is never reached when tick is stopped, each byte still ends on TXE */
+		while ((len = lwrb_get_linear_block_read_length(&port->tx_rb)) > 0u)
+		{
+			addr = lwrb_get_linear_block_read_address(&port->tx_rb);
+			if (HAL_UART_Transmit(port->huart, addr, len, HAL_MAX_DELAY) != HAL_OK)
+			{
+				break;
+			}
+			port->stats.tx_bytes += len;
+			lwrb_skip(&port->tx_rb, len);
+		}
+	}
+	
+	USART_EXIT_CRITICAL();
+}
+
+/* Per port wrappers ---------------------------------------------------------*/
+#ifdef USE_USART1
+USART_PORT_WRAPPERS(USART1, usart1)
+#endif
+
+#ifdef USE_USART2
+USART_PORT_WRAPPERS(USART2, usart2)
+#endif
+
+#ifdef USE_USART3
+USART_PORT_WRAPPERS(USART3, usart3)
+#endif
+
+#ifdef USE_UART4
+USART_PORT_WRAPPERS(UART4, uart4)
+#endif
+
+#ifdef USE_UART5
+USART_PORT_WRAPPERS(UART5, uart5)
+#endif
+
+#ifdef USE_USART6
+USART_PORT_WRAPPERS(USART6, usart6)
+#endif
+
+#ifdef USE_UART7
+USART_PORT_WRAPPERS(UART7, uart7)
+#endif
+
+#ifdef USE_UART8
+USART_PORT_WRAPPERS(UART8, uart8)
+#endif
+
+#ifdef USE_LPUART1
+USART_PORT_WRAPPERS(LPUART1, lpuart1)
+#endif
+
+
+
+
+///**
+//  * @brief  Repeat mode start.
+//  * @param  None
+//  * @retval None
+//  */
+//void UART_IT_Start()
+//{
+//	__HAL_UART_ENABLE_IT(&huart1, UART_IT_RXNE);
+//	__HAL_UART_ENABLE_IT(&huart3, UART_IT_RXNE);
+//	
+//	ATOMIC_CLEAR_BIT(huart1.Instance->CR3, USART_CR3_EIE);
+//	ATOMIC_CLEAR_BIT(huart3.Instance->CR3, USART_CR3_EIE);
+//}
+
+
+
@@ -1,100 +1,561 @@
-/**
-  ******************************************************************************
-  * @file           : bsp_usart.h
-  * @brief          : Header for bsp_usart.c file.
-  *                   This file contains the common defines of the application.
-  ******************************************************************************
-  * @attention
-  *
-  * Copyright (c) 2025 kripac@163.com
-  * All rights reserved.
-  *
-  * This software is licensed under terms that can be found in the LICENSE file
-  * in the root directory of this software component.
-  * If no LICENSE file comes with this software, it is provided AS-IS.
-  *
-  ******************************************************************************
-  */
-
-/* Define to prevent recursive inclusion -------------------------------------*/
-#ifndef __BSP_USART_H
-#define __BSP_USART_H
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-/* Includes ------------------------------------------------------------------*/
-#include "lwrb/lwrb.h"
-#include "main.h"
-
-/* Exported defines ----------------------------------------------------------*/
-#define USE_USART1
-//#define USE_USART2
-//#define USE_USART3
-
-/* Exported types ------------------------------------------------------------*/
-/* Exported constants --------------------------------------------------------*/
-/* Exported macro ------------------------------------------------------------*/
-/* Exported functions prototypes ---------------------------------------------*/
-
-/* USART1 --------------------------------------------------------------------*/
-#ifdef USE_USART1
-
-void USART1_Init(void);
-void USART1_Reset();		/* Clear buffer data */
-
-/* Normal mode block mode tranmit */
-HAL_StatusTypeDef USART1_Transmit(const uint8_t *pData, uint16_t Size, uint32_t Timeout);
-
-/* Ring buffer block mode receive */
-HAL_StatusTypeDef USART1_Receive(uint8_t *pData, uint16_t Size, uint32_t Timeout);
-
-/* Ring buffer data read */
-uint16_t USART1_ReadRB(uint8_t *pData, uint16_t MaxSize);
-
-#endif
-
-/* USART2 --------------------------------------------------------------------*/
-#ifdef USE_USART2
-
-void USART2_Init(void);
-void USART2_Reset();		/* Clear buffer data */
-
-/* Normal mode block mode tranmit */
-HAL_StatusTypeDef USART2_Transmit(const uint8_t *pData, uint16_t Size, uint32_t Timeout);
-
-/* Ring buffer block mode receive */
-HAL_StatusTypeDef USART2_Receive(uint8_t *pData, uint16_t Size, uint32_t Timeout);
-
-/* Ring buffer data read */
-uint16_t USART2_ReadRB(uint8_t *pData, uint16_t MaxSize);
-
-#endif
-
-/* USART3 --------------------------------------------------------------------*/
-#ifdef USE_USART3
-
-void USART3_Init(void);
-void USART3_Reset();		/* Clear buffer data */
-
-/* Normal mode block mode tranmit */
-HAL_StatusTypeDef USART3_Transmit(const uint8_t *pData, uint16_t Size, uint32_t Timeout);
-
-/* Ring buffer block mode receive */
-HAL_StatusTypeDef USART3_Receive(uint8_t *pData, uint16_t Size, uint32_t Timeout);
-
-/* Ring buffer data read */
-uint16_t USART3_ReadRB(uint8_t *pData, uint16_t MaxSize);
-
-#endif
-
-
-#ifdef __cplusplus
-}
-#endif
-
-#endif /* __BSP_USART_H */
-
-
-
+/**
+  ******************************************************************************
+  * @file           : bsp_usart.h
+  * @brief          : Header for bsp_usart.c file.
+  *                   This file contains the common defines of the application.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 kripac@163.com
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __BSP_USART_H
+#define __BSP_USART_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "lwrb/lwrb.h"
+#include "main.h"
+#include "cmsis_os.h"
+#include "bsp_usart_tick.h"
+
+/* Exported defines ----------------------------------------------------------*/
+#define USE_USART1
+//#define USE_USART2
+//#define USE_USART3
+//#define USE_UART4
+//#define USE_UART5
+//#define USE_USART6
+//#define USE_UART7
+//#define USE_UART8
+//#define USE_LPUART1
+
+/* ISR execution time profiling */
+//#define USART_PROFILE
+
+/*
+ * Free running timestamp used by profiling, DWT cycle counter by default.
+ * Host build may define both to a monotonic clock.
+ */
+#ifndef BSP_USART_TIMESTAMP
+#define BSP_USART_TIMESTAMP()		(DWT->CYCCNT)
+#define BSP_USART_TIMESTAMP_INIT()															\
+	do {																					\
+		CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;										\
+		DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;												\
+	} while (0)
+#endif
+
+/* Timestamp ticks per second */
+#ifndef BSP_USART_TIMESTAMP_FREQ
+#define BSP_USART_TIMESTAMP_FREQ	(SystemCoreClock)
+#endif
+
+/* Independent readers of one port stream */
+#ifndef BSP_USART_READER_MAX
+#define BSP_USART_READER_MAX		(4u)
+#endif
+
+/* RX event timestamps kept per port, power of 2 */
+#ifndef BSP_USART_TS_Q_LEN
+#define BSP_USART_TS_Q_LEN			(16u)
+#endif
+
+#define BSP_USART_PROF_BUCKETS		(16u)	/* Histogram bucket n: 2^n <= ticks < 2^(n+1) */
+
+/* Frame descriptors kept per port, power of 2 */
+#ifndef BSP_USART_FRAME_Q_LEN
+#define BSP_USART_FRAME_Q_LEN		(8u)
+#endif
+
+/* Double buffer DMA blocks kept per port, power of 2 */
+#ifndef BSP_USART_DBM_Q_LEN
+#define BSP_USART_DBM_Q_LEN			(8u)
+#endif
+
+/* DCache coherency of DMA buffers, also used by bsp::UsartPort */
+#define USART_CACHE_NONE		(0)				// No DCache, e.g. CM4 core
+#define USART_CACHE_FULL		(1)				// Invalidate whole RX DMA buffer on each event
+#define USART_CACHE_RANGE		(2)				// Invalidate only lines DMA wrote since previous event
+#define USART_CACHE_NOCACHE		(3)				// Buffers in USART_NOCACHE_SECTION, MPU sets it non-cacheable
+#define USART_CACHE_DTCM		(4)				// Buffers in USART_DTCM_SECTION, F7 only, H7 DMA1/2 can not reach DTCM
+
+#ifndef USART_CACHE_MODE
+#define USART_CACHE_MODE		USART_CACHE_RANGE
+#endif
+
+#ifndef USART_CACHE_LINE
+#define USART_CACHE_LINE		(32u)
+#endif
+
+/* Linker script output sections, MPU region of the non-cacheable one is set up by application */
+#ifndef USART_NOCACHE_SECTION
+#define USART_NOCACHE_SECTION	".dma_buffer"
+#endif
+#ifndef USART_DTCM_SECTION
+#define USART_DTCM_SECTION		".dtcmram"
+#endif
+
+/* Thread flag used to wake a task blocked in BSP_USART_Receive() or bsp::UsartPort::Receive() */
+#ifndef USART_RX_THREAD_FLAG
+#define USART_RX_THREAD_FLAG	(0x00800000u)
+#endif
+
+/* Thread flag used to wake a task blocked in BSP_USART_ReaderWait() */
+#ifndef USART_READER_THREAD_FLAG
+#define USART_READER_THREAD_FLAG	(0x00400000u)
+#endif
+
+/* Thread flag used to wake the task running BSP_USART_AsyncRun() */
+#ifndef USART_ASYNC_THREAD_FLAG
+#define USART_ASYNC_THREAD_FLAG		(0x00200000u)
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+  * @brief  Port statistics
+  */
+typedef struct
+{
+	uint32_t			rx_bytes;		/* Bytes received by DMA */
+	uint32_t			tx_bytes;		/* Bytes transmitted */
+	uint32_t			rx_drop;		/* Bytes dropped on ring buffer overflow */
+	uint32_t			err_cnt;		/* Error callback count */
+	uint32_t			err_ore;		/* Overrun errors */
+	uint32_t			err_fe;			/* Framing errors */
+	uint32_t			err_pe;			/* Parity errors */
+	uint32_t			err_ne;			/* Noise errors */
+	uint32_t			err_drop;		/* Bytes discarded by receive errors, an overrun counts one */
+	uint32_t			rts_hold;		/* Times RTS stopped the sender */
+	uint32_t			evt_idle;		/* IDLE events */
+	uint32_t			evt_ht;			/* DMA half transfer events */
+	uint32_t			evt_tc;			/* DMA transfer complete events */
+	uint32_t			evt_match;		/* Character match events */
+	uint32_t			evt_rto;		/* Receiver timeout events */
+	uint32_t			frame_drop;		/* Frames lost on queue overflow or overrun */
+	uint32_t			frame_crc_err;	/* Modbus RTU frames dropped on bad CRC */
+	uint32_t			dma_wrap;		/* DMA circular buffer wraps */
+	uint32_t			rb_peak;		/* Peak ring buffer fill in bytes */
+} BSP_USART_Stats_t;
+
+/**
+  * @brief  Port event, TC/HT/IDLE values match HAL_UART_RXEVENT_x
+  */
+typedef enum
+{
+	BSP_USART_EVT_TC		= 0,
+	BSP_USART_EVT_HT		= 1,
+	BSP_USART_EVT_IDLE		= 2,
+	BSP_USART_EVT_ERR		= 3,
+	BSP_USART_EVT_MATCH		= 4,		/* Character match */
+	BSP_USART_EVT_RTO		= 5,		/* Receiver timeout */
+	BSP_USART_EVT_NUM
+} BSP_USART_Evt_t;
+
+/**
+  * @brief  Callback execution time of one event type, in timestamp ticks
+  */
+typedef struct
+{
+	uint32_t			count;
+	uint32_t			min;
+	uint32_t			max;
+	uint32_t			mean;			/* Filled by BSP_USART_GetProfile() */
+	uint64_t			sum;
+	uint32_t			hist[BSP_USART_PROF_BUCKETS];
+} BSP_USART_Prof_t;
+
+/**
+  * @brief  Frame detection mode
+  */
+typedef enum
+{
+	BSP_USART_FRAME_NONE	= 0,		/* Byte stream only */
+	BSP_USART_FRAME_CHAR,				/* Frames end with a delimiter, hardware character match */
+	BSP_USART_FRAME_RTO,				/* Frames end with a line gap, hardware receiver timeout */
+	BSP_USART_FRAME_MODBUS,				/* Modbus RTU, receiver timeout and CRC16 check */
+} BSP_USART_FrameMode_t;
+
+/**
+  * @brief  Queued frame, offset counts bytes accepted into ring buffer
+  */
+typedef struct
+{
+	uint32_t			offset;
+	uint16_t			len;
+	uint32_t			crc;			/* Running CRC over the frame, see BSP_USART_SetRxCrc() */
+} BSP_USART_Frame_t;
+
+/**
+  * @brief  Readable region of RX ring buffer, see BSP_USART_Peek()
+  */
+typedef struct
+{
+	const uint8_t		*ptr;
+	uint16_t			len;
+} BSP_USART_Block_t;
+
+/**
+  * @brief  What a reader does when it is too slow for the writer
+  */
+typedef enum
+{
+	BSP_USART_RD_BLOCK		= 0,		/* Writer waits for it, new bytes are dropped, RTS stops sender */
+	BSP_USART_RD_DROP_OLDEST,			/* Oldest unread bytes of this reader are dropped */
+	BSP_USART_RD_DETACH,				/* Reader is detached, others go on */
+} BSP_USART_RdPolicy_t;
+
+/**
+  * @brief  Read cursor over a port stream, owned by application
+  */
+typedef struct
+{
+	uint32_t			pos;			/* Stream offset of next byte */
+	uint8_t				policy;			/* BSP_USART_RdPolicy_t */
+	volatile uint8_t	attached;
+	volatile uint8_t	ovr;			/* Data was dropped since last skip */
+	uint32_t			drop;			/* Bytes dropped for this reader */
+	volatile osThreadId_t waiter;		/* Task blocked in BSP_USART_ReaderWait() */
+} BSP_USART_Reader_t;
+
+/**
+  * @brief  Receive error report, HAL_UART_ERROR_xxx bits and stream offset
+  *			where data continues after the dropped bytes. Interrupt context.
+  */
+typedef void (*BSP_USART_ErrCb_t)(UART_HandleTypeDef *huart, uint32_t error, uint32_t offset);
+
+/**
+  * @brief  Takes received blocks instead of ring buffer, returns accepted
+  *			length, the rest is counted as dropped. Interrupt context.
+  */
+typedef uint16_t (*BSP_USART_RxFwd_t)(void *ctx, const uint8_t *data, uint16_t len);
+
+/**
+  * @brief  What completes an asynchronous receive
+  */
+typedef enum
+{
+	BSP_USART_ASYNC_LEN		= 0,		/* Exactly Size bytes */
+	BSP_USART_ASYNC_FRAME,				/* One frame, see BSP_USART_SetFrameChar() and others */
+	BSP_USART_ASYNC_ANY,				/* Data up to Size once the line pauses */
+} BSP_USART_AsyncMode_t;
+
+typedef struct BSP_USART_Async BSP_USART_Async_t;
+
+/**
+  * @brief  Asynchronous receive completion, data is already in the buffer.
+  *			HAL_OK with length, HAL_TIMEOUT with length 0.
+  */
+typedef void (*BSP_USART_AsyncCb_t)(BSP_USART_Async_t *req, HAL_StatusTypeDef status, uint16_t len);
+
+/**
+  * @brief  Asynchronous receive request, owned by caller until completion
+  */
+struct BSP_USART_Async
+{
+	BSP_USART_AsyncCb_t	cb;
+	void				*ctx;			/* Caller data */
+	uint8_t				*buf;
+	uint16_t			size;
+	uint8_t				mode;			/* BSP_USART_AsyncMode_t */
+	uint8_t				from_isr;		/* Complete in RX interrupt, else in worker task */
+	uint32_t			start;			/* HAL_GetTick() at submit */
+	uint32_t			timeout;		/* ms, HAL_MAX_DELAY none */
+};
+
+/**
+  * @brief  Arrival time of received data, one per RX event
+  */
+typedef struct
+{
+	uint32_t			offset;			/* Stream offset after last byte of event */
+	uint32_t			ts;				/* BSP_USART_TIMESTAMP() that byte arrived */
+} BSP_USART_Ts_t;
+
+/**
+  * @brief  Part of a double buffer handed to application
+  */
+typedef struct
+{
+	uint8_t				buf;			/* 0 or 1 */
+	uint16_t			off;
+	uint16_t			len;
+	uint32_t			gen;			/* Fill round of buffer, stale once DMA refills it */
+} BSP_USART_DbmBlk_t;
+
+/**
+  * @brief  Port descriptor, one instance per UART
+  */
+typedef struct
+{
+	UART_HandleTypeDef	*huart;			/* HAL handle */
+	uint8_t				*rx_dma_buf;	/* DMA circular buffer */
+	uint16_t			rx_dma_len;
+	uint8_t				*rx_rb_data;	/* Ring buffer data array */
+	uint16_t			rx_rb_len;		/* 0 for direct mode, DMA buffer is the ring buffer */
+	osSemaphoreId_t		*rx_sem;		/* Released on IDLE, created by RTOS init */
+
+	uint8_t				*tx_rb_data;	/* TX queue data array, 32 bytes aligned */
+	uint16_t			tx_rb_len;		/* 0 for polling transmit */
+	uint8_t				*rx_pool;		/* RX buffer budget, DMA and ring buffer sized at init when set */
+	uint16_t			rx_pool_len;
+	uint32_t			rx_latency_us;	/* Consumer latency the ring buffer is sized for, 0 default */
+
+	lwrb_t				rx_rb;			/* Ring buffer instance for RX data */
+	uint16_t			pos_last;		/* DMA position of previous event */
+	uint16_t			rx_notify_level;/* Release rx_sem on HT/TC when buffered, 0 IDLE only */
+	uint8_t				rx_wm_auto;		/* rx_notify_level follows burst size */
+	uint16_t			rx_wm_min;
+	uint32_t			ts_char;		/* Timestamp ticks per character */
+	uint32_t			ts_rto;			/* Timestamp ticks of receiver timeout */
+	volatile uint32_t	ts_w;			/* Timestamp queue indexes, free running, writer overwrites */
+	uint32_t			ts_r;
+	BSP_USART_Ts_t		ts_q[BSP_USART_TS_Q_LEN];
+	uint32_t			poll_bit;		/* Event flag of port for BSP_USART_Poll(), set by init */
+	uint16_t			poll_level;		/* Ready once buffered, 0 on IDLE with any data */
+	uint16_t			rts_high;		/* Stop sender at this fill level, 0 no flow control */
+	uint16_t			rts_low;		/* Resume sender at this fill level */
+	GPIO_TypeDef		*rts_gpio;		/* RTS pin driven by software, NULL USART RTS */
+	uint16_t			rts_pin;
+	volatile uint8_t	rts_held;
+	BSP_USART_Reader_t	*reader[BSP_USART_READER_MAX];	/* Replace ring buffer read API when used */
+	uint8_t				reader_num;
+	uint32_t			rx_burst_start;	/* Stream offset at previous IDLE */
+	uint32_t			rx_burst_avg;	/* Average burst length x8 */
+	volatile osThreadId_t rx_waiter;	/* Task blocked in BSP_USART_Receive() */
+	volatile uint16_t	rx_wait_len;	/* Bytes it waits for, 0 when none */
+	lwrb_t				tx_rb;			/* TX queue, drained by chained DMA transfers */
+	volatile uint16_t	tx_dma_len;		/* Bytes in flight, 0 when TX DMA idle */
+	osSemaphoreId_t		tx_sem;			/* Released on TX complete */
+	osMutexId_t			tx_mutex;		/* Serialize writers */
+	uint32_t			rx_total;		/* Bytes accepted into ring buffer, wraps */
+	volatile uint32_t	rx_ovr;			/* Direct mode, RX interrupt dropped unread data on overrun or error restart */
+	uint32_t			peek_ovr;		/* rx_ovr seen by BSP_USART_Peek() */
+	
+	uint8_t				frame_mode;		/* BSP_USART_FrameMode_t */
+	uint8_t				frame_char;		/* Delimiter for BSP_USART_FRAME_CHAR */
+	uint16_t			frame_gap;		/* Gap in 1/10 character times for BSP_USART_FRAME_RTO */
+	uint8_t				rx_crc_type;	/* BSP_CRC_Type_t, running CRC of accepted bytes */
+	uint32_t			rx_crc;			/* Running CRC state, restarts at each frame end */
+	volatile uint8_t	frame_w;		/* Frame queue indexes, free running */
+	volatile uint8_t	frame_r;
+	uint32_t			frame_start;	/* Stream offset of frame being received */
+	BSP_USART_Frame_t	frame_q[BSP_USART_FRAME_Q_LEN];
+	
+	uint8_t				*dbm_buf[2];	/* Double buffer mode when dbm_len is not 0 */
+	uint16_t			dbm_len;
+	uint8_t				dbm_base;		/* Buffer of DMA memory 0 target */
+	uint8_t				dbm_cur;		/* Buffer DMA fills */
+	uint16_t			dbm_off;		/* Start of data not handed over yet in dbm_cur */
+	volatile uint32_t	dbm_gen[2];
+	volatile uint8_t	dbm_w;			/* Block queue indexes, free running */
+	volatile uint8_t	dbm_r;
+	BSP_USART_DbmBlk_t	dbm_q[BSP_USART_DBM_Q_LEN];
+	
+	BSP_USART_ErrCb_t	err_cb;			/* Receive error report, NULL none */
+	BSP_USART_RxFwd_t	rx_fwd;			/* Received data sink, NULL ring buffer */
+	void				*rx_fwd_ctx;
+	BSP_USART_Async_t * volatile async;	/* Pending asynchronous receive */
+	volatile uint8_t	async_pause;	/* Line paused with data buffered */
+	BSP_USART_Stats_t	stats;
+#ifdef USART_PROFILE
+	BSP_USART_Prof_t	prof[BSP_USART_EVT_NUM];
+#endif
+} BSP_USART_Port_t;
+
+/* Exported constants --------------------------------------------------------*/
+/* Exported macro ------------------------------------------------------------*/
+
+/* Placement of DMA buffers, also for buffers handed to bsp::UsartPort */
+#if (USART_CACHE_MODE == USART_CACHE_NOCACHE)
+#define USART_DMA_MEM			__attribute__((section(USART_NOCACHE_SECTION), aligned(USART_CACHE_LINE)))
+#elif (USART_CACHE_MODE == USART_CACHE_DTCM)
+#define USART_DMA_MEM			__attribute__((section(USART_DTCM_SECTION), aligned(USART_CACHE_LINE)))
+#else
+#define USART_DMA_MEM			__attribute__((aligned(USART_CACHE_LINE)))
+#endif
+
+/* Per port API, USARTx_Init() ... USARTx_ReadRB(), C++ template ports provide it through BSP_USART_TPL_WRAPPERS() in bsp_usart.hpp */
+#define BSP_USART_DECLARE(PORT)																	\
+	void PORT##_Init(void);																		\
+	void PORT##_Reset(void);		/* Clear buffer data */										\
+	HAL_StatusTypeDef PORT##_Transmit(const uint8_t *pData, uint16_t Size, uint32_t Timeout);	\
+	HAL_StatusTypeDef PORT##_Receive(uint8_t *pData, uint16_t Size, uint32_t Timeout);			\
+	uint16_t PORT##_ReadRB(uint8_t *pData, uint16_t MaxSize)
+
+/* Exported functions prototypes ---------------------------------------------*/
+
+/* Generic port API ----------------------------------------------------------*/
+void BSP_USART_Init(BSP_USART_Port_t *port);
+void BSP_USART_Reset(BSP_USART_Port_t *port);
+
+/* DMA queued transmit, blocks only when the queue is full */
+HAL_StatusTypeDef BSP_USART_Transmit(BSP_USART_Port_t *port, const uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef BSP_USART_TryTransmit(BSP_USART_Port_t *port, const uint8_t *pData, uint16_t Size);
+void BSP_USART_TxFlush(BSP_USART_Port_t *port);
+
+/* Ring buffer block mode receive */
+HAL_StatusTypeDef BSP_USART_Receive(BSP_USART_Port_t *port, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+
+/* Ring buffer data read */
+uint16_t BSP_USART_ReadRB(BSP_USART_Port_t *port, uint8_t *pData, uint16_t MaxSize);
+
+/* Ring buffer zero copy read, peek readable blocks then skip consumed bytes */
+uint8_t BSP_USART_Peek(BSP_USART_Port_t *port, BSP_USART_Block_t blk[2]);
+
+/* Several readers of one stream, each peeks in place and skips what it used */
+HAL_StatusTypeDef BSP_USART_ReaderAttach(BSP_USART_Port_t *port, BSP_USART_Reader_t *rd, BSP_USART_RdPolicy_t policy);
+void BSP_USART_ReaderDetach(BSP_USART_Port_t *port, BSP_USART_Reader_t *rd);
+uint8_t BSP_USART_ReaderPeek(BSP_USART_Port_t *port, BSP_USART_Reader_t *rd, BSP_USART_Block_t blk[2]);
+uint16_t BSP_USART_ReaderSkip(BSP_USART_Port_t *port, BSP_USART_Reader_t *rd, uint16_t len);
+HAL_StatusTypeDef BSP_USART_ReaderWait(BSP_USART_Port_t *port, BSP_USART_Reader_t *rd, uint32_t Timeout);
+
+/* Ring buffer read with arrival time of first and last byte, BSP_USART_TIMESTAMP() ticks */
+uint16_t BSP_USART_ReadRBTs(BSP_USART_Port_t *port, uint8_t *pData, uint16_t MaxSize, uint32_t *t_first, uint32_t *t_last);
+uint16_t BSP_USART_Skip(BSP_USART_Port_t *port, uint16_t len);
+
+/* Character match framing, frames are read whole */
+void BSP_USART_SetFrameChar(BSP_USART_Port_t *port, uint8_t delim);
+uint16_t BSP_USART_ReadFrame(BSP_USART_Port_t *port, uint8_t *pData, uint16_t MaxSize);
+uint16_t BSP_USART_PeekFrame(BSP_USART_Port_t *port, BSP_USART_Block_t blk[2]);
+void BSP_USART_SkipFrame(BSP_USART_Port_t *port);
+
+/* Receiver timeout framing, gap in 1/10 character times, same read API as above */
+void BSP_USART_SetFrameTimeout(BSP_USART_Port_t *port, uint16_t gap_x10);
+void BSP_USART_SetModbusRTU(BSP_USART_Port_t *port);
+
+/* Double buffer DMA reception, blocks are used in place instead of ring buffer */
+void BSP_USART_SetDoubleBuffer(BSP_USART_Port_t *port, uint8_t *buf0, uint8_t *buf1, uint16_t len);
+uint16_t BSP_USART_DbmAcquire(BSP_USART_Port_t *port, const uint8_t **data);
+uint8_t BSP_USART_DbmRelease(BSP_USART_Port_t *port);
+
+/* Running CRC of received data, updated per DMA block, see bsp_usart_crc.h */
+void BSP_USART_SetRxCrc(BSP_USART_Port_t *port, uint8_t type);
+uint32_t BSP_USART_GetRxCrc(BSP_USART_Port_t *port, uint32_t *offset);
+void BSP_USART_ResetRxCrc(BSP_USART_Port_t *port);
+uint32_t BSP_USART_GetFrameCrc(BSP_USART_Port_t *port);
+
+/* RX watermark, port semaphore is also released on HT/TC once reached */
+void BSP_USART_SetRxWatermark(BSP_USART_Port_t *port, uint16_t level);
+void BSP_USART_SetRxWatermarkPct(BSP_USART_Port_t *port, uint8_t percent);
+void BSP_USART_SetRxWatermarkAuto(BSP_USART_Port_t *port, uint16_t min_level);
+
+/* Consumer latency for ports sizing buffers from a RX pool */
+void BSP_USART_SetRxLatency(BSP_USART_Port_t *port, uint32_t us);
+
+/* Wait on several ports from one task, mask of BSP_USART_PollBit() */
+osStatus_t BSP_USART_PollInit(void);
+uint32_t BSP_USART_PollBit(const BSP_USART_Port_t *port);
+void BSP_USART_SetPollLevel(BSP_USART_Port_t *port, uint16_t level);
+uint32_t BSP_USART_Poll(uint32_t mask, uint32_t Timeout);
+
+/* RTS flow control from ring buffer level, USART RTS pin or GPIO */
+void BSP_USART_SetRtsFlow(BSP_USART_Port_t *port, uint16_t high, uint16_t low, GPIO_TypeDef *gpio, uint16_t pin);
+
+/* Receive error report, reception itself recovers without it */
+void BSP_USART_SetErrorCallback(BSP_USART_Port_t *port, BSP_USART_ErrCb_t cb);
+
+/* Hand received blocks to another consumer, e.g. the other core */
+void BSP_USART_SetRxForward(BSP_USART_Port_t *port, BSP_USART_RxFwd_t fwd, void *ctx);
+
+/* Asynchronous receive, one request per port, completed from RX interrupt or by the task running BSP_USART_AsyncRun() */
+void BSP_USART_AsyncSetup(BSP_USART_Async_t *req, BSP_USART_AsyncCb_t cb, void *ctx, uint8_t from_isr);
+HAL_StatusTypeDef BSP_USART_ReceiveAsync(BSP_USART_Port_t *port, BSP_USART_Async_t *req, BSP_USART_AsyncMode_t mode,
+										 uint8_t *pData, uint16_t Size, uint32_t Timeout);
+uint8_t BSP_USART_CancelAsync(BSP_USART_Port_t *port, BSP_USART_Async_t *req);
+uint32_t BSP_USART_AsyncRun(uint32_t Timeout);
+
+/* Statistics snapshot and reset */
+void BSP_USART_GetStats(BSP_USART_Port_t *port, BSP_USART_Stats_t *stats);
+void BSP_USART_ResetStats(BSP_USART_Port_t *port);
+
+#ifdef USART_PROFILE
+/* Callback profiling snapshot and reset */
+void BSP_USART_GetProfile(BSP_USART_Port_t *port, BSP_USART_Evt_t evt, BSP_USART_Prof_t *prof);
+void BSP_USART_ResetProfile(BSP_USART_Port_t *port);
+#endif
+
+/* Shared HAL callbacks, dispatch on huart */
+void BSP_USART_RxEventCb(UART_HandleTypeDef *huart, uint16_t size);
+void BSP_USART_ErrorCb(UART_HandleTypeDef *huart);
+void BSP_USART_TxCpltCb(UART_HandleTypeDef *huart);
+
+/* USARTx_IRQHandler() pre-handler for events HAL does not service */
+void BSP_USART_IRQHandler(UART_HandleTypeDef *huart);
+BSP_USART_Port_t *BSP_USART_GetPort(UART_HandleTypeDef *huart);
+
+/* USART1 --------------------------------------------------------------------*/
+#ifdef USE_USART1
+extern BSP_USART_Port_t usart1_port;
+BSP_USART_DECLARE(USART1);
+#endif
+
+/* USART2 --------------------------------------------------------------------*/
+#ifdef USE_USART2
+extern BSP_USART_Port_t usart2_port;
+BSP_USART_DECLARE(USART2);
+#endif
+
+/* USART3 --------------------------------------------------------------------*/
+#ifdef USE_USART3
+extern BSP_USART_Port_t usart3_port;
+BSP_USART_DECLARE(USART3);
+#endif
+
+/* UART4 ---------------------------------------------------------------------*/
+#ifdef USE_UART4
+extern BSP_USART_Port_t uart4_port;
+BSP_USART_DECLARE(UART4);
+#endif
+
+/* UART5 ---------------------------------------------------------------------*/
+#ifdef USE_UART5
+extern BSP_USART_Port_t uart5_port;
+BSP_USART_DECLARE(UART5);
+#endif
+
+/* USART6 --------------------------------------------------------------------*/
+#ifdef USE_USART6
+extern BSP_USART_Port_t usart6_port;
+BSP_USART_DECLARE(USART6);
+#endif
+
+/* UART7 ---------------------------------------------------------------------*/
+#ifdef USE_UART7
+extern BSP_USART_Port_t uart7_port;
+BSP_USART_DECLARE(UART7);
+#endif
+
+/* UART8 ---------------------------------------------------------------------*/
+#ifdef USE_UART8
+extern BSP_USART_Port_t uart8_port;
+BSP_USART_DECLARE(UART8);
+#endif
+
+/* LPUART1 -------------------------------------------------------------------*/
+#ifdef USE_LPUART1
+extern BSP_USART_Port_t lpuart1_port;
+BSP_USART_DECLARE(LPUART1);
+#endif
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BSP_USART_H */
+
+
+
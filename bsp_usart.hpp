@@ -0,0 +1,401 @@
+/**
+  ******************************************************************************
+  * @file           : bsp_usart.hpp
+  * @brief          : Compile time specialized USART port for C++ projects.
+  *                   UART handle, semaphore and buffer lengths are template
+  *                   parameters, the ring buffer wraps with a mask and the
+  *                   whole RX path inlines into one callback per port.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 kripac@163.com
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __BSP_USART_HPP
+#define __BSP_USART_HPP
+
+/* Includes ------------------------------------------------------------------*/
+#include "bsp_usart.h"
+#include <string.h>
+
+/* Exported macro ------------------------------------------------------------*/
+
+/*
+ * C API of a template port, USARTx_Init() ... USARTx_ReadRB() as declared by
+ * BSP_USART_DECLARE(). Use in one .cpp file, do not also define USE_USARTx.
+ */
+#define BSP_USART_TPL_WRAPPERS(PORT, obj)										\
+	extern "C" {																\
+	void PORT##_Init(void)														\
+	{																			\
+		(obj).Init();															\
+	}																			\
+	void PORT##_Reset(void)														\
+	{																			\
+		(obj).Reset();															\
+	}																			\
+	HAL_StatusTypeDef PORT##_Transmit(const uint8_t *pData, uint16_t Size, uint32_t Timeout) \
+	{																			\
+		return (obj).Transmit(pData, Size, Timeout);							\
+	}																			\
+	HAL_StatusTypeDef PORT##_Receive(uint8_t *pData, uint16_t Size, uint32_t Timeout) \
+	{																			\
+		return (obj).Receive(pData, Size, Timeout);								\
+	}																			\
+	uint16_t PORT##_ReadRB(uint8_t *pData, uint16_t MaxSize)					\
+	{																			\
+		return (obj).ReadRB(pData, MaxSize);									\
+	}																			\
+	}
+
+/* Exported types ------------------------------------------------------------*/
+namespace bsp
+{
+
+/**
+  * @brief  USART port, one instantiation per UART
+  * @param  Huart HAL handle, e.g. huart2
+  * @param  RxSem Semaphore released on IDLE, created by RTOS init
+  * @param  DmaLen RX DMA circular buffer, whole cache lines
+  * @param  RbLen Ring buffer, power of 2, all RbLen bytes are usable
+  * @param  DmaBuf RX DMA buffer of DmaLen bytes defined with USART_DMA_MEM,
+  *			required with USART_CACHE_NOCACHE and USART_CACHE_DTCM as GCC
+  *			drops section attributes of template members
+  *
+  *			static bsp::UsartPort<huart2, Usart2RxSemHandle, 64, 512> usart2;
+  *			BSP_USART_TPL_WRAPPERS(USART2, usart2)
+  *
+  *			static uint8_t usart3_dma[64] USART_DMA_MEM;
+  *			static bsp::UsartPort<huart3, Usart3RxSemHandle, 64, 512, usart3_dma> usart3;
+  *
+  *			Cache mode, line size and RX thread flag follow the C driver
+  *			config in bsp_usart.h. Compared with a C port it only has DMA
+  *			reception into the ring buffer, ReadRB(), blocking Receive(),
+  *			the IDLE semaphore, polling Transmit() and the byte, error and
+  *			event counters of BSP_USART_Stats_t. Not available: TX queue and
+  *			TX DMA, character match, receiver timeout and Modbus framing,
+  *			running CRC, double buffer mode, RX pool, RTS flow control,
+  *			watermarks, BSP_USART_Poll(), readers, RX forwarding, async
+  *			requests, timestamps and profiling. Ports needing them stay on
+  *			the C driver.
+  */
+template <UART_HandleTypeDef &Huart, osSemaphoreId_t &RxSem, uint16_t DmaLen, uint16_t RbLen, uint8_t *DmaBuf = nullptr>
+class UsartPort
+{
+	static_assert((RbLen != 0u) && ((RbLen & (RbLen - 1u)) == 0u), "ring buffer length must be a power of 2");
+	static_assert((DmaLen != 0u) && ((DmaLen % USART_CACHE_LINE) == 0u), "DMA buffer must be whole cache lines");
+	static_assert(DmaLen <= RbLen, "ring buffer smaller than DMA buffer drops data");
+	static_assert(((USART_CACHE_MODE != USART_CACHE_NOCACHE) && (USART_CACHE_MODE != USART_CACHE_DTCM)) || (DmaBuf != nullptr),
+				  "cache mode places DMA buffers, pass one defined with USART_DMA_MEM");
+
+	static constexpr uint32_t	Mask = RbLen - 1u;
+
+public:
+	/**
+	  * @brief  Start DMA reception
+	  * @retval None
+	  *			Uart should config to DMA Rx circular mode and enable interrupt
+	  */
+	void Init(void)
+	{
+		/* Re-init restarts reception at DMA buffer start, stop the running one first */
+		HAL_UART_AbortReceive(&Huart);
+		r_ = w_;
+		pos_last_ = 0u;
+		HAL_UART_RegisterRxEventCallback(&Huart, RxEventCb);
+		HAL_UART_RegisterCallback(&Huart, HAL_UART_ERROR_CB_ID, ErrorCb);
+
+		/* DMA stops on a receive error instead of storing the bad byte */
+		if (!READ_BIT(Huart.Instance->CR3, USART_CR3_DDRE))
+		{
+			__HAL_UART_DISABLE(&Huart);
+			ATOMIC_SET_BIT(Huart.Instance->CR3, USART_CR3_DDRE);
+			__HAL_UART_ENABLE(&Huart);
+		}
+		HAL_UARTEx_ReceiveToIdle_DMA(&Huart, Dma(), DmaLen);
+	}
+
+	/**
+	  * @brief  Drop buffered data
+	  * @retval None
+	  */
+	void Reset(void)
+	{
+		r_ = w_;
+	}
+
+	/**
+	  * @brief  Buffered bytes
+	  * @retval Readable length
+	  */
+	uint32_t Available(void) const
+	{
+		return w_ - r_;
+	}
+
+	/**
+	  * @brief  Receive data from ring buffer
+	  * @param  pData Received data
+	  * @param	MaxSize Max data size
+	  * @retval Actual received data length
+	  */
+	uint16_t ReadRB(uint8_t *pData, uint16_t MaxSize)
+	{
+		uint32_t r = r_;
+		uint32_t n = w_ - r;
+		uint32_t first;
+
+		if (pData == nullptr)
+		{
+			return 0u;
+		}
+		n = (n < MaxSize) ? n : MaxSize;
+		__DMB();
+		first = RbLen - (r & Mask);
+		first = (first < n) ? first : n;
+		memcpy(pData, &rb_[r & Mask], first);
+		memcpy(pData + first, &rb_[0], n - first);
+		__DMB();
+		r_ = r + n;
+		return (uint16_t)n;
+	}
+
+	/**
+	  * @brief  Block mode receive N byte until timeout
+	  * @param	pData Received data
+	  * @param	Size Received data size
+	  * @param	Timeout Timeout in ms
+	  * @retval HAL status
+	  *			Only one task may block on a port at a time.
+	  */
+	HAL_StatusTypeDef Receive(uint8_t *pData, uint16_t Size, uint32_t Timeout)
+	{
+		uint32_t tick_start = HAL_GetTick();
+		uint32_t elapsed;
+
+		if ((pData == nullptr) || (Size == 0u) || (Size > RbLen))
+		{
+			return HAL_ERROR;
+		}
+
+		osThreadFlagsClear(USART_RX_THREAD_FLAG);
+		waiter_ = osThreadGetId();
+		wait_len_ = Size;
+		while (Available() < Size)
+		{
+			elapsed = HAL_GetTick() - tick_start;
+			if ((Timeout == 0u) || ((Timeout != HAL_MAX_DELAY) && (elapsed >= Timeout)))
+			{
+				wait_len_ = 0u;
+				return HAL_TIMEOUT;
+			}
+			osThreadFlagsWait(USART_RX_THREAD_FLAG, osFlagsWaitAny,
+				(Timeout == HAL_MAX_DELAY) ? osWaitForever : BSP_USART_MsToTicks(Timeout - elapsed));
+		}
+		wait_len_ = 0u;
+		ReadRB(pData, Size);
+		return HAL_OK;
+	}
+
+	/**
+	  * @brief  Polling transmit
+	  * @param	pData Data
+	  * @param	Size Data size
+	  * @param	Timeout Timeout in ms
+	  * @retval HAL status
+	  */
+	HAL_StatusTypeDef Transmit(const uint8_t *pData, uint16_t Size, uint32_t Timeout)
+	{
+		HAL_StatusTypeDef status = HAL_UART_Transmit(&Huart, pData, Size, Timeout);
+
+		if (status == HAL_OK)
+		{
+			stats_.tx_bytes += Size;
+		}
+		return status;
+	}
+
+	/**
+	  * @brief  Copy of port statistics, fields of missing features stay 0
+	  * @param	stats Statistics
+	  * @retval None
+	  */
+	void GetStats(BSP_USART_Stats_t *stats) const
+	{
+		uint32_t primask = __get_PRIMASK();
+
+		__disable_irq();
+		*stats = stats_;
+		__set_PRIMASK(primask);
+	}
+
+	/**
+	  * @brief  Clear port statistics
+	  * @retval None
+	  */
+	void ResetStats(void)
+	{
+		uint32_t primask = __get_PRIMASK();
+
+		__disable_irq();
+		memset(&stats_, 0, sizeof(stats_));
+		__set_PRIMASK(primask);
+	}
+
+	/* Received and dropped byte counters, receive errors */
+	uint32_t RxBytes(void) const	{ return stats_.rx_bytes; }
+	uint32_t RxDrop(void) const		{ return stats_.rx_drop; }
+	uint32_t ErrCount(void) const	{ return stats_.err_cnt; }
+
+private:
+	/* DMA buffer, own member unless the cache mode needs a placed one */
+	static uint8_t *Dma(void)
+	{
+		if constexpr (DmaBuf != nullptr)
+		{
+			return DmaBuf;
+		}
+		else
+		{
+			return dma_buf_;
+		}
+	}
+
+	/* Copy one linear DMA block into ring buffer, drop what does not fit */
+	static void Push(const uint8_t *p, uint32_t n)
+	{
+		uint32_t w = w_;
+		uint32_t space = RbLen - (w - r_);
+		uint32_t first;
+
+		stats_.rx_bytes += n;
+		if (n > space)
+		{
+			stats_.rx_drop += n - space;
+			n = space;
+		}
+		first = RbLen - (w & Mask);
+		first = (first < n) ? first : n;
+		memcpy(&rb_[w & Mask], p, first);
+		memcpy(&rb_[0], p + first, n - first);
+		__DMB();
+		w_ = w + n;
+		if ((w_ - r_) > stats_.rb_peak)
+		{
+			stats_.rb_peak = w_ - r_;
+		}
+	}
+
+	/* Invalidate DCache lines of new data as USART_CACHE_MODE says, buffer is whole lines */
+	static void Invalidate(uint32_t from, uint32_t to)
+	{
+		#if (USART_CACHE_MODE == USART_CACHE_RANGE)
+		uint32_t start = from & ~(USART_CACHE_LINE - 1u);
+		uint32_t end = (to + USART_CACHE_LINE - 1u) & ~(USART_CACHE_LINE - 1u);
+		SCB_InvalidateDCache_by_Addr((uint32_t *)&Dma()[start], end - start);
+		#else
+		(void)from;
+		(void)to;
+		#endif
+	}
+
+	/* Move data DMA wrote since previous event into ring buffer */
+	static void Update(void)
+	{
+		uint8_t  *buf = Dma();
+		uint32_t pos_last = pos_last_;
+		uint32_t pos;
+
+		#if (USART_CACHE_MODE == USART_CACHE_FULL)
+		SCB_InvalidateDCache_by_Addr((uint32_t *)buf, DmaLen);
+		#endif
+
+		pos = DmaLen - __HAL_DMA_GET_COUNTER(Huart.hdmarx);
+		if (pos > pos_last)
+		{
+			Invalidate(pos_last, pos);
+			Push(&buf[pos_last], pos - pos_last);
+		}
+		else if (pos < pos_last)
+		{
+			stats_.dma_wrap++;
+			Invalidate(pos_last, DmaLen);
+			Invalidate(0u, pos);
+			Push(&buf[pos_last], DmaLen - pos_last);
+			Push(&buf[0], pos);
+		}
+		else
+		{
+			return;
+		}
+		pos_last_ = (pos == DmaLen) ? 0u : pos;
+
+		/* Wake blocked receiver once it has enough data */
+		if ((wait_len_ != 0u) && ((w_ - r_) >= wait_len_))
+		{
+			wait_len_ = 0u;
+			osThreadFlagsSet(waiter_, USART_RX_THREAD_FLAG);
+		}
+	}
+
+	static void RxEventCb(UART_HandleTypeDef *huart, uint16_t size)
+	{
+		(void)huart;
+		(void)size;
+		Update();
+		switch (Huart.RxEventType)
+		{
+			case HAL_UART_RXEVENT_HT:	stats_.evt_ht++; break;
+			case HAL_UART_RXEVENT_TC:	stats_.evt_tc++; break;
+			default:
+				stats_.evt_idle++;
+				osSemaphoreRelease(RxSem);
+				break;
+		}
+	}
+
+	static void ErrorCb(UART_HandleTypeDef *huart)
+	{
+		uint32_t primask = __get_PRIMASK();
+		uint32_t error = huart->ErrorCode;
+
+		/* Keep data received so far, restarted DMA begins at buffer start, bad byte is left in RDR */
+		__disable_irq();
+		Update();
+		pos_last_ = 0u;
+		stats_.err_cnt++;
+		stats_.err_ore += ((error & HAL_UART_ERROR_ORE) != 0u) ? 1u : 0u;
+		stats_.err_fe += ((error & HAL_UART_ERROR_FE) != 0u) ? 1u : 0u;
+		stats_.err_pe += ((error & HAL_UART_ERROR_PE) != 0u) ? 1u : 0u;
+		stats_.err_ne += ((error & HAL_UART_ERROR_NE) != 0u) ? 1u : 0u;
+		if ((error & (HAL_UART_ERROR_ORE | HAL_UART_ERROR_FE | HAL_UART_ERROR_PE | HAL_UART_ERROR_NE)) != 0u)
+		{
+			stats_.err_drop++;
+		}
+		__HAL_UART_SEND_REQ(huart, UART_RXDATA_FLUSH_REQUEST);
+		__HAL_UART_CLEAR_FLAG(huart, UART_CLEAR_OREF | UART_CLEAR_FEF | UART_CLEAR_PEF | UART_CLEAR_NEF | UART_CLEAR_IDLEF);
+		HAL_UARTEx_ReceiveToIdle_DMA(huart, Dma(), DmaLen);
+		__set_PRIMASK(primask);
+	}
+
+	alignas(USART_CACHE_LINE) static inline uint8_t	dma_buf_[DmaLen];
+	static inline uint8_t				rb_[RbLen];
+	static inline volatile uint32_t		w_;			/* Free running indexes, masked on access */
+	static inline volatile uint32_t		r_;
+	static inline uint32_t				pos_last_;
+	static inline volatile osThreadId_t	waiter_;
+	static inline volatile uint32_t		wait_len_;
+	static inline BSP_USART_Stats_t		stats_;
+};
+
+} /* namespace bsp */
+
+#endif /* __BSP_USART_HPP */
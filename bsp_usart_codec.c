@@ -0,0 +1,435 @@
+/**
+  ******************************************************************************
+  * @file    bsp_usart_codec.c
+  * @brief   This file provides code for byte stuffed frame decoding
+			 SLIP, async HDLC and COBS frames are decoded incrementally from
+			 the port ring buffer in place, without copying bytes out first.
+			 Runs of ordinary bytes are located a word at a time and copied
+			 with memcpy, only delimiter and escape bytes take the slow path.
+
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 kripac@163.com
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  * 
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "bsp_usart_codec.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define SLIP_END				(0xC0u)
+#define SLIP_ESC				(0xDBu)
+#define SLIP_ESC_END			(0xDCu)
+#define SLIP_ESC_ESC			(0xDDu)
+
+#define HDLC_FLAG				(0x7Eu)
+#define HDLC_ESC				(0x7Du)
+#define HDLC_XOR				(0x20u)
+
+#define COBS_DELIM				(0x00u)
+
+/* Private macro -------------------------------------------------------------*/
+
+/* Non zero when any byte of 32 bit word v is zero */
+#define CODEC_HASZERO(v)		(((v) - 0x01010101u) & ~(v) & 0x80808080u)
+
+#define CODEC_ENTER_CRITICAL()	uint32_t primask_bit = __get_PRIMASK(); __disable_irq()
+#define CODEC_EXIT_CRITICAL()	__set_PRIMASK(primask_bit)
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Find first byte equal to a or b
+  * @param  p Data
+  * @param	n Data length
+  * @param	a, b Bytes to look for
+  * @retval Pointer to the byte, NULL when not found
+  */
+static const uint8_t *CODEC_Find2(const uint8_t *p, size_t n, uint8_t a, uint8_t b)
+{
+	const uint8_t	*e = p + n;
+	uint32_t		ma = 0x01010101u * a;
+	uint32_t		mb = 0x01010101u * b;
+	uint32_t		w;
+	
+	/* Head until word aligned */
+	while ((p < e) && (((uintptr_t)p & 3u) != 0u))
+	{
+		if ((*p == a) || (*p == b))
+		{
+			return p;
+		}
+		p++;
+	}
+	
+	/* Words without special byte are skipped at once */
+	while ((e - p) >= 4)
+	{
+		memcpy(&w, p, 4u);
+		if ((CODEC_HASZERO(w ^ ma) != 0u) || (CODEC_HASZERO(w ^ mb) != 0u))
+		{
+			break;
+		}
+		p += 4;
+	}
+	
+	while (p < e)
+	{
+		if ((*p == a) || (*p == b))
+		{
+			return p;
+		}
+		p++;
+	}
+	return NULL;
+}
+
+/**
+  * @brief  Append decoded bytes to current frame
+  * @param  dec Decoder
+  * @param	p Data
+  * @param	n Data length
+  * @retval None
+  */
+static void CODEC_Put(BSP_Codec_t *dec, const uint8_t *p, size_t n)
+{
+	if ((dec->discard != 0u) || (n == 0u))
+	{
+		return;
+	}
+	if ((dec->len + n) > dec->size)
+	{	/* Overlong frame, drop it up to next delimiter */
+		dec->discard = 1u;
+		dec->errors++;
+		return;
+	}
+	memcpy(&dec->buf[dec->len], p, n);
+	dec->len += n;
+}
+
+/**
+  * @brief  Handle a frame delimiter
+  * @param  dec Decoder
+  * @retval 1 when a non empty, valid frame is complete
+  */
+static uint8_t CODEC_End(BSP_Codec_t *dec)
+{
+	uint8_t ok = (dec->discard == 0u) && (dec->esc == 0u) && (dec->cobs_left == 0u) && (dec->len > 0u);
+	
+	if ((dec->esc != 0u) || (dec->cobs_left != 0u))
+	{
+		dec->errors++;
+	}
+	dec->esc = 0u;
+	dec->discard = 0u;
+	dec->cobs_left = 0u;
+	dec->cobs_zero = 0u;
+	if (!ok)
+	{
+		dec->len = 0u;
+	}
+	return ok;
+}
+
+/**
+  * @brief  Decode SLIP or HDLC stuffed bytes
+  * @param  dec Decoder
+  * @param	p Data
+  * @param	n Data length
+  * @param	used Bytes consumed
+  * @retval 1 when a frame is complete
+  */
+static uint8_t CODEC_FeedStuffed(BSP_Codec_t *dec, const uint8_t *p, size_t n, size_t *used)
+{
+	const uint8_t	end = (dec->type == BSP_CODEC_SLIP) ? SLIP_END : HDLC_FLAG;
+	const uint8_t	esc = (dec->type == BSP_CODEC_SLIP) ? SLIP_ESC : HDLC_ESC;
+	const uint8_t	*s = p;
+	const uint8_t	*e = p + n;
+	const uint8_t	*hit;
+	uint8_t			c;
+	
+	while (s < e)
+	{
+		if (dec->esc != 0u)
+		{
+			c = *s;
+			if (c == end)
+			{	/* Frame aborted inside escape, delimiter handled below */
+				dec->discard = 1u;
+			}
+			else
+			{
+				s++;
+				dec->esc = 0u;
+				if (dec->type == BSP_CODEC_HDLC)
+				{
+					c ^= HDLC_XOR;
+				}
+				else if (c == SLIP_ESC_END)
+				{
+					c = SLIP_END;
+				}
+				else if (c == SLIP_ESC_ESC)
+				{
+					c = SLIP_ESC;
+				}
+				else
+				{
+					dec->errors++;
+				}
+				CODEC_Put(dec, &c, 1u);
+				continue;
+			}
+		}
+		
+		/* Copy run of ordinary bytes */
+		hit = CODEC_Find2(s, e - s, end, esc);
+		CODEC_Put(dec, s, ((hit != NULL) ? hit : e) - s);
+		if (hit == NULL)
+		{
+			break;
+		}
+		s = hit + 1;
+		
+		if (*hit == esc)
+		{
+			dec->esc = 1u;
+		}
+		else if (CODEC_End(dec))
+		{
+			*used = s - p;
+			return 1u;
+		}
+	}
+	
+	*used = n;
+	return 0u;
+}
+
+/**
+  * @brief  Decode COBS bytes
+  * @param  dec Decoder
+  * @param	p Data
+  * @param	n Data length
+  * @param	used Bytes consumed
+  * @retval 1 when a frame is complete
+  */
+static uint8_t CODEC_FeedCobs(BSP_Codec_t *dec, const uint8_t *p, size_t n, size_t *used)
+{
+	static const uint8_t	zero = 0u;
+	const uint8_t			*s = p;
+	const uint8_t			*e = p + n;
+	const uint8_t			*hit;
+	size_t					run;
+	uint8_t					code;
+	
+	while (s < e)
+	{
+		if (dec->cobs_left == 0u)
+		{	/* Code byte */
+			code = *s++;
+			if (code == COBS_DELIM)
+			{	/* Zero owed by last block is the end of frame, not data */
+				if (CODEC_End(dec))
+				{
+					*used = s - p;
+					return 1u;
+				}
+				continue;
+			}
+			if (dec->cobs_zero != 0u)
+			{
+				CODEC_Put(dec, &zero, 1u);
+			}
+			dec->cobs_left = code - 1u;
+			dec->cobs_zero = (code != 0xFFu);
+			continue;
+		}
+		
+		/* Block data is a plain run, a zero inside means truncated frame */
+		run = (size_t)(e - s) < dec->cobs_left ? (size_t)(e - s) : dec->cobs_left;
+		hit = memchr(s, COBS_DELIM, run);
+		if (hit != NULL)
+		{
+			dec->discard = 1u;
+			dec->errors++;
+			dec->cobs_left = 0u;
+			s = hit;
+			continue;
+		}
+		CODEC_Put(dec, s, run);
+		s += run;
+		dec->cobs_left -= run;
+	}
+	
+	*used = n;
+	return 0u;
+}
+
+/**
+  * @brief  Take a free buffer from pool
+  * @param  pool Buffer pool
+  * @retval Buffer, NULL when all are taken
+  */
+static uint8_t *CODEC_PoolGet(BSP_Codec_Pool_t *pool)
+{
+	uint8_t *buf = NULL;
+	uint8_t i;
+	CODEC_ENTER_CRITICAL();
+	
+	for (i = 0u; i < pool->num; i++)
+	{
+		if ((pool->used & (1uL << i)) == 0u)
+		{
+			pool->used |= (1uL << i);
+			buf = &pool->mem[(size_t)i * pool->size];
+			break;
+		}
+	}
+	
+	CODEC_EXIT_CRITICAL();
+	return buf;
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Init decoder with caller supplied output buffer
+  * @param  dec Decoder
+  * @param  type Byte stuffing scheme
+  * @param  buf Output buffer, largest frame size
+  * @param  size Output buffer size
+  * @retval None
+  */
+void BSP_Codec_Init(BSP_Codec_t *dec, BSP_Codec_Type_t type, uint8_t *buf, uint16_t size)
+{
+	memset(dec, 0, sizeof(*dec));
+	dec->type = type;
+	dec->buf = buf;
+	dec->size = size;
+}
+
+/**
+  * @brief  Init decoder with pooled output buffers
+  * @param  dec Decoder
+  * @param  type Byte stuffing scheme
+  * @param  pool Buffer pool, see BSP_Codec_PoolInit()
+  * @retval None
+  */
+void BSP_Codec_InitPool(BSP_Codec_t *dec, BSP_Codec_Type_t type, BSP_Codec_Pool_t *pool)
+{
+	memset(dec, 0, sizeof(*dec));
+	dec->type = type;
+	dec->pool = pool;
+	dec->size = pool->size;
+}
+
+/**
+  * @brief  Init frame buffer pool
+  * @param  pool Buffer pool
+  * @param  mem num * size bytes
+  * @param  size Size of one buffer, largest frame size
+  * @param  num Number of buffers, 1 ~ 32
+  * @retval None
+  */
+void BSP_Codec_PoolInit(BSP_Codec_Pool_t *pool, uint8_t *mem, uint16_t size, uint8_t num)
+{
+	pool->mem = mem;
+	pool->size = size;
+	pool->num = num > 32u ? 32u : num;
+	pool->used = 0u;
+}
+
+/**
+  * @brief  Give a frame returned by BSP_Codec_Decode() back to pool
+  * @param  pool Buffer pool
+  * @param  frame Frame buffer
+  * @retval None
+  */
+void BSP_Codec_PoolPut(BSP_Codec_Pool_t *pool, uint8_t *frame)
+{
+	uint32_t i = (uint32_t)(frame - pool->mem) / pool->size;
+	CODEC_ENTER_CRITICAL();
+	pool->used &= ~(1uL << i);
+	CODEC_EXIT_CRITICAL();
+}
+
+/**
+  * @brief  Decode data of a port until one frame completes
+  * @param  dec Decoder
+  * @param  port Port descriptor
+  * @param  frame Set to decoded frame
+  * @retval Frame length, 0 when all buffered data is consumed without a frame
+  *			Leaves data in ring buffer while no pool buffer is free. A frame
+  *			overrun in direct mode is dropped and counted in errors.
+  */
+uint16_t BSP_Codec_Decode(BSP_Codec_t *dec, BSP_USART_Port_t *port, uint8_t **frame)
+{
+	BSP_USART_Block_t	blk[2];
+	uint8_t				nblk;
+	uint8_t				i;
+	uint8_t				done = 0u;
+	size_t				consumed = 0u;
+	size_t				used = 0u;
+	uint16_t			len = 0u;
+	
+	if (dec->buf == NULL)
+	{
+		dec->buf = CODEC_PoolGet(dec->pool);
+		if (dec->buf == NULL)
+		{
+			return 0u;
+		}
+	}
+	
+	nblk = BSP_USART_Peek(port, blk);
+	for (i = 0u; (i < nblk) && (done == 0u); i++)
+	{
+		done = (dec->type == BSP_CODEC_COBS) ? CODEC_FeedCobs(dec, blk[i].ptr, blk[i].len, &used)
+											 : CODEC_FeedStuffed(dec, blk[i].ptr, blk[i].len, &used);
+		consumed += used;
+	}
+	if ((consumed != 0u) && (BSP_USART_Skip(port, (uint16_t)consumed) != consumed))
+	{
+		/* DMA overran peeked data in direct mode, frame may be torn */
+		BSP_Codec_Reset(dec);
+		dec->discard = 1u;
+		dec->errors++;
+		return 0u;
+	}
+	
+	if (done != 0u)
+	{
+		dec->frames++;
+		len = dec->len;
+		*frame = dec->buf;
+		dec->len = 0u;
+		if (dec->pool != NULL)
+		{	/* Frame is handed over, next one gets a new buffer */
+			dec->buf = NULL;
+		}
+	}
+	return len;
+}
+
+/**
+  * @brief  Drop partially decoded frame
+  * @param  dec Decoder
+  * @retval None
+  */
+void BSP_Codec_Reset(BSP_Codec_t *dec)
+{
+	dec->len = 0u;
+	dec->esc = 0u;
+	dec->discard = 0u;
+	dec->cobs_left = 0u;
+	dec->cobs_zero = 0u;
+}
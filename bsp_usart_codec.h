@@ -0,0 +1,94 @@
+/**
+  ******************************************************************************
+  * @file           : bsp_usart_codec.h
+  * @brief          : Header for bsp_usart_codec.c file.
+  *                   Incremental SLIP / HDLC / COBS frame decoder reading
+  *                   straight from a bsp_usart port ring buffer.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 kripac@163.com
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __BSP_USART_CODEC_H
+#define __BSP_USART_CODEC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "bsp_usart.h"
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+  * @brief  Byte stuffing scheme
+  */
+typedef enum
+{
+	BSP_CODEC_SLIP			= 0,		/* RFC 1055, END 0xC0, ESC 0xDB */
+	BSP_CODEC_HDLC,						/* Async HDLC, flag 0x7E, escape 0x7D, FCS left in frame */
+	BSP_CODEC_COBS,						/* Consistent overhead byte stuffing, 0x00 delimiter */
+} BSP_Codec_Type_t;
+
+/**
+  * @brief  Fixed size frame buffer pool, up to 32 buffers
+  */
+typedef struct
+{
+	uint8_t				*mem;			/* num * size bytes */
+	uint16_t			size;			/* Size of one buffer */
+	uint8_t				num;
+	volatile uint32_t	used;			/* Bit n set when buffer n is taken */
+} BSP_Codec_Pool_t;
+
+/**
+  * @brief  Decoder state, kept between calls
+  */
+typedef struct
+{
+	BSP_Codec_Type_t	type;
+	BSP_Codec_Pool_t	*pool;			/* Frame buffers taken from pool when not NULL */
+	uint8_t				*buf;			/* Current output buffer */
+	uint16_t			size;
+	uint16_t			len;			/* Decoded bytes of current frame */
+	
+	uint8_t				esc;			/* SLIP/HDLC escape byte pending */
+	uint8_t				discard;		/* Drop bytes until next delimiter */
+	uint8_t				cobs_left;		/* COBS bytes left in current block */
+	uint8_t				cobs_zero;		/* COBS zero owed before next block */
+	
+	uint32_t			frames;			/* Frames decoded */
+	uint32_t			errors;			/* Bad escape, truncated block, overlong or overrun frame */
+} BSP_Codec_t;
+
+/* Exported functions prototypes ---------------------------------------------*/
+
+/* Caller supplied output buffer, frame is valid until next decode call */
+void BSP_Codec_Init(BSP_Codec_t *dec, BSP_Codec_Type_t type, uint8_t *buf, uint16_t size);
+
+/* Pooled output buffers, caller owns each returned frame until BSP_Codec_PoolPut() */
+void BSP_Codec_InitPool(BSP_Codec_t *dec, BSP_Codec_Type_t type, BSP_Codec_Pool_t *pool);
+void BSP_Codec_PoolInit(BSP_Codec_Pool_t *pool, uint8_t *mem, uint16_t size, uint8_t num);
+void BSP_Codec_PoolPut(BSP_Codec_Pool_t *pool, uint8_t *frame);
+
+/* Consume port data until one frame completes, 0 when more data is needed */
+uint16_t BSP_Codec_Decode(BSP_Codec_t *dec, BSP_USART_Port_t *port, uint8_t **frame);
+
+/* Drop partially decoded frame */
+void BSP_Codec_Reset(BSP_Codec_t *dec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BSP_USART_CODEC_H */
@@ -0,0 +1,128 @@
+/**
+  ******************************************************************************
+  * @file           : bsp_usart_coro.hpp
+  * @brief          : C++20 coroutine front end of the asynchronous receive
+  *                   API. A protocol handler is a coroutine which co_awaits
+  *                   port reads, all handlers are resumed by the task running
+  *                   BSP_USART_AsyncRun() and share its stack.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 kripac@163.com
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __BSP_USART_CORO_HPP
+#define __BSP_USART_CORO_HPP
+
+/* Includes ------------------------------------------------------------------*/
+#include "bsp_usart.h"
+#include <coroutine>
+#include <exception>
+
+/* Exported types ------------------------------------------------------------*/
+namespace bsp
+{
+
+/**
+  * @brief  Result of an awaited read
+  */
+struct UsartResult
+{
+	HAL_StatusTypeDef	status;			/* HAL_OK, HAL_TIMEOUT, HAL_BUSY or HAL_ERROR when not started */
+	uint16_t			len;
+};
+
+/**
+  * @brief  Awaitable port read, one BSP_USART_ReceiveAsync() request
+  *
+  *			auto r = co_await bsp::UsartRead(&usart2_port, BSP_USART_ASYNC_FRAME, buf, sizeof(buf), 100);
+  */
+class UsartRead
+{
+public:
+	UsartRead(BSP_USART_Port_t *port, BSP_USART_AsyncMode_t mode, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+		: port_(port), mode_(mode), data_(pData), size_(Size), timeout_(Timeout)
+	{
+	}
+
+	bool await_ready(void) const noexcept
+	{
+		return false;
+	}
+
+	/* Request lives in the coroutine frame, it resumes in the worker task */
+	bool await_suspend(std::coroutine_handle<> h) noexcept
+	{
+		HAL_StatusTypeDef status;
+
+		handle_ = h;
+		BSP_USART_AsyncSetup(&req_, Done, this, 0u);
+		status = BSP_USART_ReceiveAsync(port_, &req_, mode_, data_, size_, timeout_);
+		if (status != HAL_OK)
+		{
+			result_ = { status, 0u };
+			return false;
+		}
+		return true;
+	}
+
+	UsartResult await_resume(void) const noexcept
+	{
+		return result_;
+	}
+
+private:
+	static void Done(BSP_USART_Async_t *req, HAL_StatusTypeDef status, uint16_t len)
+	{
+		UsartRead *self = static_cast<UsartRead *>(req->ctx);
+
+		self->result_ = { status, len };
+		self->handle_.resume();
+	}
+
+	BSP_USART_Port_t		*port_;
+	BSP_USART_AsyncMode_t	mode_;
+	uint8_t					*data_;
+	uint16_t				size_;
+	uint32_t				timeout_;
+	BSP_USART_Async_t		req_ = {};
+	std::coroutine_handle<>	handle_;
+	UsartResult				result_ = { HAL_ERROR, 0u };
+};
+
+/**
+  * @brief  Detached coroutine of a protocol handler, starts at once and
+  *			frees its frame when it returns
+  *
+  *			bsp::UsartTask modbus(void)
+  *			{
+  *				for (;;)
+  *				{
+  *					auto r = co_await bsp::UsartRead(&usart2_port, BSP_USART_ASYNC_FRAME, buf, sizeof(buf), HAL_MAX_DELAY);
+  *					...
+  *				}
+  *			}
+  */
+struct UsartTask
+{
+	struct promise_type
+	{
+		UsartTask get_return_object(void) noexcept				{ return {}; }
+		std::suspend_never initial_suspend(void) const noexcept	{ return {}; }
+		std::suspend_never final_suspend(void) const noexcept	{ return {}; }
+		void return_void(void) const noexcept					{ }
+		void unhandled_exception(void) const noexcept			{ std::terminate(); }
+	};
+};
+
+} /* namespace bsp */
+
+#endif /* __BSP_USART_CORO_HPP */
@@ -0,0 +1,83 @@
+/**
+  ******************************************************************************
+  * @file           : bsp_usart_crc.h
+  * @brief          : Header for bsp_usart_crc.c file.
+  *                   Incremental CRC16/Modbus and CRC32 used for running
+  *                   checksums of received data.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 kripac@163.com
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __BSP_USART_CRC_H
+#define __BSP_USART_CRC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include <stddef.h>
+
+/* Exported defines ----------------------------------------------------------*/
+
+/* Software kernel bytes per step, 4 or 8. Flash tables take SLICES / 2 KB for CRC16, SLICES KB for CRC32 */
+#ifndef BSP_CRC_SLICES
+#define BSP_CRC_SLICES				(4u)
+#endif
+
+/*
+ * Use CRC peripheral with programmable polynomial, e.g. STM32F7/H7/G4/L4.
+ * Each update saves and restores POL, INIT and CR, so HAL_CRC_Calculate()
+ * of other users keeps working, a HAL_CRC_Accumulate() sequence must not
+ * span a receive. The host simulator has no CRC peripheral, this path is
+ * not covered by its tests, check BSP_CRC_Calc() against the known values
+ * (0x4B37 and 0xCBF43926 for "123456789") on target before relying on it.
+ */
+//#define BSP_CRC_USE_HW
+
+/* Shorter blocks are done in software, peripheral setup costs more */
+#ifndef BSP_CRC_HW_MIN
+#define BSP_CRC_HW_MIN				(16u)
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+  * @brief  CRC algorithm, both are reflected
+  */
+typedef enum
+{
+	BSP_CRC_NONE			= 0,
+	BSP_CRC16_MODBUS,					/* Poly 0x8005, init 0xFFFF, no final xor */
+	BSP_CRC32,							/* IEEE 802.3, poly 0x04C11DB7, init and final xor 0xFFFFFFFF */
+} BSP_CRC_Type_t;
+
+/* Exported functions prototypes ---------------------------------------------*/
+
+/* Enable CRC peripheral clock with BSP_CRC_USE_HW, nothing to do otherwise, safe to call again */
+void BSP_CRC_Init(void);
+
+/* Running CRC: state = Start(), state = Update(state, ...), crc = Final(state) */
+uint32_t BSP_CRC_Start(BSP_CRC_Type_t type);
+uint32_t BSP_CRC_Update(BSP_CRC_Type_t type, uint32_t crc, const uint8_t *data, size_t len);
+uint32_t BSP_CRC_Final(BSP_CRC_Type_t type, uint32_t crc);
+
+/* One shot */
+uint32_t BSP_CRC_Calc(BSP_CRC_Type_t type, const uint8_t *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BSP_USART_CRC_H */
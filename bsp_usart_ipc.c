@@ -0,0 +1,300 @@
+/**
+  ******************************************************************************
+  * @file    bsp_usart_ipc.c
+  * @brief   This file provides code for cross core RX forwarding
+			 A channel is a ring of blocks in memory both cores see at the
+			 same address. The core owning the UART copies each received
+			 block once, straight from the DMA buffer, and publishes it by
+			 moving head. The other core reads the block where it lies and
+			 moves tail when done. Each index has a single writer, so no
+			 lock is needed, barriers order data against indexes. Blocks
+			 never wrap, a wrap marker sends the reader back to start.
+
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 kripac@163.com
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "bsp_usart_ipc.h"
+#include "bsp_usart_tick.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+
+/* Block header, payload length or wrap marker */
+#define IPC_HDR_LEN				(4u)
+#define IPC_WRAP				(0xFFFFFFFFu)
+
+#define IPC_MASK				(BSP_IPC_CHAN_LEN - 1u)
+
+#if (BSP_IPC_CHAN_LEN & IPC_MASK) != 0u
+#error "BSP_IPC_CHAN_LEN must be a power of 2"
+#endif
+
+/* Private macro -------------------------------------------------------------*/
+
+/* Space a block of len bytes takes */
+#define IPC_REC_LEN(len)		(IPC_HDR_LEN + (((uint32_t)(len) + 3u) & ~3u))
+
+#define IPC_CHAN_INDEX(ch)		((uint32_t)((ch) - BSP_IPC_CHAN(0)))
+
+/* Private variables ---------------------------------------------------------*/
+#ifndef BSP_IPC_NOTIFY_SEV
+static osSemaphoreId_t		ipc_sem[BSP_IPC_CHAN_NUM];	/* Consumer core */
+#endif
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Tell consumer core a block is published
+  * @param  ch Channel
+  * @retval None
+  */
+static void IPC_Notify(BSP_IPC_Chan_t *ch)
+{
+	#ifdef BSP_IPC_NOTIFY_SEV
+	(void)ch;
+	__DSB();
+	__SEV();
+	#else
+	uint32_t id = BSP_IPC_HSEM_ID(IPC_CHAN_INDEX(ch));
+	
+	/* Release raises the free interrupt on the core which activated notification */
+	if (HAL_HSEM_FastTake(id) == HAL_OK)
+	{
+		HAL_HSEM_Release(id, 0u);
+	}
+	#endif
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Empty a channel
+  * @param  ch Channel, BSP_IPC_CHAN(n)
+  * @retval None
+  *			Producer core at boot, before releasing the other core.
+  */
+void BSP_IPC_Init(BSP_IPC_Chan_t *ch)
+{
+	ch->head = 0u;
+	ch->tail = 0u;
+	ch->drop = 0u;
+	__DMB();
+}
+
+/**
+  * @brief  Publish one block
+  * @param  ch Channel
+  * @param	data Data
+  * @param	len Data length, 1 ~ BSP_IPC_BLOCK_MAX
+  * @retval len, 0 when the channel has no room and the block is dropped
+  *			Single writer per channel, task or interrupt.
+  */
+uint16_t BSP_IPC_Write(BSP_IPC_Chan_t *ch, const uint8_t *data, uint16_t len)
+{
+	uint32_t	head = ch->head;
+	uint32_t	rec = IPC_REC_LEN(len);
+	uint32_t	free;
+	uint32_t	off;
+	uint32_t	end;
+	
+	if ((len == 0u) || (len > BSP_IPC_BLOCK_MAX))
+	{
+		ch->drop++;
+		return 0u;
+	}
+	
+	free = BSP_IPC_CHAN_LEN - (head - ch->tail);
+	off = head & IPC_MASK;
+	end = BSP_IPC_CHAN_LEN - off;
+	
+	/* Block does not fit before end, skip the rest of the ring */
+	if (((rec > end) && ((end + rec) > free)) || (rec > free))
+	{
+		ch->drop++;
+		return 0u;
+	}
+	if (rec > end)
+	{
+		*(volatile uint32_t *)&ch->data[off] = IPC_WRAP;
+		head += end;
+		off = 0u;
+	}
+	
+	memcpy(&ch->data[off + IPC_HDR_LEN], data, len);
+	*(volatile uint32_t *)&ch->data[off] = len;
+	
+	/* Data and header before head */
+	__DMB();
+	ch->head = head + rec;
+	IPC_Notify(ch);
+	return len;
+}
+
+/**
+  * @brief  Forward received port data to a channel
+  * @param  ctx Channel
+  * @param	data Received block
+  * @param	len Block length
+  * @retval Accepted length
+  *			BSP_USART_SetRxForward(&usart3_port, BSP_IPC_PortFwd, BSP_IPC_CHAN(0));
+  */
+uint16_t BSP_IPC_PortFwd(void *ctx, const uint8_t *data, uint16_t len)
+{
+	return BSP_IPC_Write((BSP_IPC_Chan_t *)ctx, data, len);
+}
+
+/**
+  * @brief  Get notified of new blocks
+  * @param  ch Channel
+  * @retval HAL status
+  *			Consumer core, HSEM interrupt of this core enabled in NVIC.
+  */
+HAL_StatusTypeDef BSP_IPC_Listen(BSP_IPC_Chan_t *ch)
+{
+	#ifdef BSP_IPC_NOTIFY_SEV
+	(void)ch;
+	#else
+	uint32_t n = IPC_CHAN_INDEX(ch);
+	
+	if (ipc_sem[n] == NULL)
+	{
+		ipc_sem[n] = osSemaphoreNew(1u, 0u, NULL);
+		if (ipc_sem[n] == NULL)
+		{
+			return HAL_ERROR;
+		}
+	}
+	HAL_HSEM_ActivateNotification(__HAL_HSEM_SEMID_TO_MASK(BSP_IPC_HSEM_ID(n)));
+	#endif
+	return HAL_OK;
+}
+
+/**
+  * @brief  Get next block in place
+  * @param  ch Channel
+  * @param	data Set to block data
+  * @retval Block length, 0 when channel is empty
+  *			Data stays valid until BSP_IPC_Release().
+  */
+uint16_t BSP_IPC_Peek(BSP_IPC_Chan_t *ch, const uint8_t **data)
+{
+	uint32_t	tail = ch->tail;
+	uint32_t	off;
+	uint32_t	hdr;
+	
+	if (ch->head == tail)
+	{
+		return 0u;
+	}
+	
+	/* Head before data and header */
+	__DMB();
+	off = tail & IPC_MASK;
+	hdr = *(volatile uint32_t *)&ch->data[off];
+	if (hdr == IPC_WRAP)
+	{
+		/* Producer writes the block after the marker in the same publish */
+		tail += BSP_IPC_CHAN_LEN - off;
+		ch->tail = tail;
+		off = 0u;
+		hdr = *(volatile uint32_t *)&ch->data[0];
+	}
+	
+	*data = &ch->data[off + IPC_HDR_LEN];
+	return (uint16_t)hdr;
+}
+
+/**
+  * @brief  Hand block of last BSP_IPC_Peek() back to producer
+  * @param  ch Channel
+  * @retval None
+  */
+void BSP_IPC_Release(BSP_IPC_Chan_t *ch)
+{
+	uint32_t tail = ch->tail;
+	uint32_t hdr;
+	
+	if (ch->head == tail)
+	{
+		return;
+	}
+	hdr = *(volatile uint32_t *)&ch->data[tail & IPC_MASK];
+	if (hdr == IPC_WRAP)
+	{
+		tail += BSP_IPC_CHAN_LEN - (tail & IPC_MASK);
+		hdr = *(volatile uint32_t *)&ch->data[0];
+	}
+	
+	/* Done reading before producer may overwrite */
+	__DMB();
+	ch->tail = tail + IPC_REC_LEN(hdr);
+}
+
+/**
+  * @brief  Wait until channel has a block
+  * @param  ch Channel, BSP_IPC_Listen() called
+  * @param	Timeout Timeout in ms, HAL_MAX_DELAY wait forever
+  * @retval HAL_OK, HAL_TIMEOUT
+  */
+HAL_StatusTypeDef BSP_IPC_Wait(BSP_IPC_Chan_t *ch, uint32_t Timeout)
+{
+	uint32_t tick_start = HAL_GetTick();
+	uint32_t elapsed;
+	
+	for (;;)
+	{
+		if (ch->head != ch->tail)
+		{
+			return HAL_OK;
+		}
+		elapsed = HAL_GetTick() - tick_start;
+		if ((Timeout == 0u) || ((Timeout != HAL_MAX_DELAY) && (elapsed >= Timeout)))
+		{
+			return HAL_TIMEOUT;
+		}
+		#ifdef BSP_IPC_NOTIFY_SEV
+		/* SysTick also wakes it, timeout is checked each tick */
+		__WFE();
+		#else
+		osSemaphoreAcquire(ipc_sem[IPC_CHAN_INDEX(ch)],
+						   (Timeout == HAL_MAX_DELAY) ? osWaitForever : BSP_USART_MsToTicks(Timeout - elapsed));
+		#endif
+	}
+}
+
+/**
+  * @brief  Wake channel waiters of freed semaphores
+  * @param  SemMask Mask from HAL_HSEM_FreeCallback()
+  * @retval None
+  *			Notification is one shot, it is activated again here.
+  */
+void BSP_IPC_HSEM_Callback(uint32_t SemMask)
+{
+	#ifdef BSP_IPC_NOTIFY_SEV
+	(void)SemMask;
+	#else
+	uint32_t	mask;
+	uint32_t	n;
+	
+	for (n = 0u; n < BSP_IPC_CHAN_NUM; n++)
+	{
+		mask = __HAL_HSEM_SEMID_TO_MASK(BSP_IPC_HSEM_ID(n));
+		if (((SemMask & mask) != 0u) && (ipc_sem[n] != NULL))
+		{
+			HAL_HSEM_ActivateNotification(mask);
+			osSemaphoreRelease(ipc_sem[n]);
+		}
+	}
+	#endif
+}
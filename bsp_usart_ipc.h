@@ -0,0 +1,122 @@
+/**
+  ******************************************************************************
+  * @file           : bsp_usart_ipc.h
+  * @brief          : Header for bsp_usart_ipc.c file.
+  *                   Single producer, single consumer channels in memory shared
+  *                   by both cores of STM32H7 dual core parts. The UART core
+  *                   publishes received blocks, the other core reads them in
+  *                   place.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 kripac@163.com
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __BSP_USART_IPC_H
+#define __BSP_USART_IPC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "cmsis_os.h"
+
+/* Exported defines ----------------------------------------------------------*/
+
+/*
+ * Start of shared channels, same address on both cores. Default is SRAM4 in
+ * D3 domain, CM7 MPU must map it non-cacheable (or shareable), CM4 has no
+ * data cache. Keep the linker scripts of both cores off this area.
+ */
+#ifndef BSP_IPC_SHARED_BASE
+#define BSP_IPC_SHARED_BASE			(0x38000000u)
+#endif
+
+/* Channels, usually one per forwarded port */
+#ifndef BSP_IPC_CHAN_NUM
+#define BSP_IPC_CHAN_NUM			(2u)
+#endif
+
+/* Data area of a channel, power of 2, each block takes 4 bytes of header and is padded to 4 */
+#ifndef BSP_IPC_CHAN_LEN
+#define BSP_IPC_CHAN_LEN			(2048u)
+#endif
+
+/* Hardware semaphore of channel n, HSEM 0 is left to CubeMX boot sync */
+#ifndef BSP_IPC_HSEM_ID
+#define BSP_IPC_HSEM_ID(n)			(24u + (n))
+#endif
+
+/* Wake consumer core with SEV instead of HSEM interrupt, consumer waits in WFE without RTOS */
+//#define BSP_IPC_NOTIFY_SEV
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+  * @brief  One direction channel, producer and consumer indexes on own lines
+  */
+typedef struct
+{
+	volatile uint32_t	head;			/* Producer, free running byte index */
+	volatile uint32_t	drop;			/* Producer, blocks not fitting */
+	uint8_t				pad0[24];
+	volatile uint32_t	tail;			/* Consumer, free running byte index */
+	uint8_t				pad1[28];
+	uint8_t				data[BSP_IPC_CHAN_LEN];
+} BSP_IPC_Chan_t;
+
+/**
+  * @brief  Layout of shared region, identical on both cores
+  */
+typedef struct
+{
+	BSP_IPC_Chan_t		chan[BSP_IPC_CHAN_NUM];
+} BSP_IPC_Shared_t;
+
+/* Exported macro ------------------------------------------------------------*/
+
+/* Longest block, always fits an empty channel wherever head stands */
+#define BSP_IPC_BLOCK_MAX			(BSP_IPC_CHAN_LEN / 2u - 4u)
+
+/* Channel n of shared region */
+#define BSP_IPC_CHAN(n)				(&((BSP_IPC_Shared_t *)(BSP_IPC_SHARED_BASE))->chan[(n)])
+
+/* Exported functions prototypes ---------------------------------------------*/
+
+/* Producer core, before consumer core starts using the channel */
+void BSP_IPC_Init(BSP_IPC_Chan_t *ch);
+
+/* Producer, whole block or nothing, one writer per channel */
+uint16_t BSP_IPC_Write(BSP_IPC_Chan_t *ch, const uint8_t *data, uint16_t len);
+
+/* BSP_USART_SetRxForward() sink, ctx is the channel */
+uint16_t BSP_IPC_PortFwd(void *ctx, const uint8_t *data, uint16_t len);
+
+/* Consumer core, enable notification of channel */
+HAL_StatusTypeDef BSP_IPC_Listen(BSP_IPC_Chan_t *ch);
+
+/* Consumer, next block in place and its release, one reader per channel */
+uint16_t BSP_IPC_Peek(BSP_IPC_Chan_t *ch, const uint8_t **data);
+void BSP_IPC_Release(BSP_IPC_Chan_t *ch);
+
+/* Consumer, wait for a block */
+HAL_StatusTypeDef BSP_IPC_Wait(BSP_IPC_Chan_t *ch, uint32_t Timeout);
+
+/* Consumer core, call from HAL_HSEM_FreeCallback() */
+void BSP_IPC_HSEM_Callback(uint32_t SemMask);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BSP_USART_IPC_H */
@@ -0,0 +1,219 @@
+/**
+  ******************************************************************************
+  * @file    bsp_usart_log.c
+  * @brief   This file provides code for deferred logging
+			 Output is appended to the TX queue of one port and sent by TX
+			 DMA in background, callers never wait for the wire. Text is
+			 formatted into a stack line first, binary records only copy a
+			 format string ID and arguments. When the queue is full whole
+			 lines are dropped and counted.
+
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 kripac@163.com
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  * 
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "bsp_usart_log.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+
+/* Sync, argument count, ID and tick ahead of arguments */
+#define LOG_REC_HDR_LEN			(8u)
+
+/* Private macro -------------------------------------------------------------*/
+#define LOG_ENTER_CRITICAL()	uint32_t primask_bit = __get_PRIMASK(); __disable_irq()
+#define LOG_EXIT_CRITICAL()		__set_PRIMASK(primask_bit)
+
+/* Private variables ---------------------------------------------------------*/
+static BSP_USART_Port_t		*log_port = NULL;
+static volatile uint32_t	log_drops = 0u;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Queue bytes of one line or record, count it when lost
+  * @param  data Data
+  * @param	len Data length
+  * @retval HAL status
+  */
+static HAL_StatusTypeDef LOG_Put(const uint8_t *data, uint16_t len)
+{
+	HAL_StatusTypeDef status = HAL_ERROR;
+	
+	if (log_port != NULL)
+	{
+		status = BSP_USART_TryTransmit(log_port, data, len);
+	}
+	if (status != HAL_OK)
+	{
+		/* Counted from tasks and interrupts, an atomic add would need LDREX/STREX and does not link on M0 */
+		LOG_ENTER_CRITICAL();
+		log_drops++;
+		LOG_EXIT_CRITICAL();
+	}
+	return status;
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Select log port
+  * @param  port Port descriptor with TX queue, initialized by BSP_USART_Init()
+  * @retval None
+  */
+void BSP_Log_Init(BSP_USART_Port_t *port)
+{
+	log_port = port;
+	log_drops = 0u;
+}
+
+/**
+  * @brief  Format a line into the log queue
+  * @param  fmt printf() format
+  * @retval Queued length, 0 when dropped
+  *			Callable from tasks only, vsnprintf() is not interrupt safe. Use
+  *			BSP_Log_Record() or BSP_Log_Write() from interrupts. Stack use
+  *			includes BSP_LOG_LINE_MAX bytes.
+  */
+int BSP_Log_Printf(const char *fmt, ...)
+{
+	char	line[BSP_LOG_LINE_MAX];
+	va_list	ap;
+	int		len;
+	
+	va_start(ap, fmt);
+	len = vsnprintf(line, sizeof(line), fmt, ap);
+	va_end(ap);
+	
+	if (len <= 0)
+	{
+		return 0;
+	}
+	if (len >= (int)sizeof(line))
+	{
+		len = sizeof(line) - 1;
+	}
+	return (LOG_Put((const uint8_t *)line, (uint16_t)len) == HAL_OK) ? len : 0;
+}
+
+/**
+  * @brief  Queue raw bytes
+  * @param  data Data
+  * @param	len Data length
+  * @retval HAL_OK when queued
+  */
+HAL_StatusTypeDef BSP_Log_Write(const uint8_t *data, uint16_t len)
+{
+	return LOG_Put(data, len);
+}
+
+/**
+  * @brief  Queue a binary record
+  * @param  id Format string ID
+  * @param	args Arguments
+  * @param	argc Argument count, up to BSP_LOG_MAX_ARGS
+  * @retval HAL_OK when queued
+  *
+  *			[ 0xA5 ][ argc ][ id, LE16 ][ HAL_GetTick(), LE32 ][ args, LE32 x argc ]
+  */
+HAL_StatusTypeDef BSP_Log_Record(uint16_t id, const uint32_t *args, uint8_t argc)
+{
+	uint8_t		rec[LOG_REC_HDR_LEN + BSP_LOG_MAX_ARGS * 4u];
+	uint32_t	tick = HAL_GetTick();
+	
+	if (argc > BSP_LOG_MAX_ARGS)
+	{
+		argc = BSP_LOG_MAX_ARGS;
+	}
+	
+	/* Cortex-M is little endian, words are copied as they are */
+	rec[0] = BSP_LOG_SYNC;
+	rec[1] = argc;
+	memcpy(&rec[2], &id, 2u);
+	memcpy(&rec[4], &tick, 4u);
+	memcpy(&rec[LOG_REC_HDR_LEN], args, argc * 4u);
+	return LOG_Put(rec, LOG_REC_HDR_LEN + argc * 4u);
+}
+
+/**
+  * @brief  Lines and records lost because queue was full or port not set
+  * @retval Drop count
+  */
+uint32_t BSP_Log_GetDrops(void)
+{
+	return log_drops;
+}
+
+/**
+  * @brief  Send queued log output now
+  * @retval None
+  *			Polls with interrupts disabled, for HardFault and assert handlers.
+  */
+void BSP_Log_Flush(void)
+{
+	if (log_port != NULL)
+	{
+		BSP_USART_TxFlush(log_port);
+	}
+}
+
+/* Redefine fputc() to use log port for printf() function */
+/* ---------------------------------------------------------------------------*/
+#ifdef BSP_LOG_RETARGET
+#if defined(__ARMCC_VERSION) || defined(__CC_ARM)
+#if defined(__ARMCC_VERSION) && (__ARMCC_VERSION >= 6000000)
+#define AC6_ENABLE
+#endif
+
+#ifdef AC6_ENABLE
+__ASM(".global __use_no_semihosting");
+#else
+#pragma import(__use_no_semihosting)
+struct __FILE
+{
+    int handle;
+};
+#endif
+
+FILE __stdout;
+
+/* Define _sys_exit() to avoid using half-host mode */
+void _sys_exit(int x)
+{
+    x = x;
+}
+/* Redefine fputc, queued per character, lines of tasks may interleave */
+int fputc(int ch, FILE *f)
+{
+	uint8_t c = (uint8_t)ch;
+	
+	LOG_Put(&c, 1u);
+    return ch;
+}
+/* __use_no_semihosting was requested, but _ttywrch was */
+void _ttywrch(int ch)
+{
+    ch = ch;
+}
+#else
+/* newlib, whole printf() buffer in one piece */
+int _write(int file, char *ptr, int len)
+{
+	(void)file;
+	LOG_Put((const uint8_t *)ptr, (uint16_t)len);
+	return len;
+}
+#endif
+#endif
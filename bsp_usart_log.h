@@ -0,0 +1,81 @@
+/**
+  ******************************************************************************
+  * @file           : bsp_usart_log.h
+  * @brief          : Header for bsp_usart_log.c file.
+  *                   Deferred logging through the TX queue of a port, text
+  *                   lines or binary records, drained by TX DMA.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 kripac@163.com
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __BSP_USART_LOG_H
+#define __BSP_USART_LOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "bsp_usart.h"
+
+/* Exported defines ----------------------------------------------------------*/
+
+/* Longest formatted line, longer ones are cut. Taken from caller stack */
+#ifndef BSP_LOG_LINE_MAX
+#define BSP_LOG_LINE_MAX			(128u)
+#endif
+
+/* Most 32 bit arguments of one binary record */
+#ifndef BSP_LOG_MAX_ARGS
+#define BSP_LOG_MAX_ARGS			(8u)
+#endif
+
+/* First byte of a binary record */
+#define BSP_LOG_SYNC				(0xA5u)
+
+/* Redirect printf() to the log port, replaces polling fputc() of each byte */
+//#define BSP_LOG_RETARGET
+
+/* Exported macro ------------------------------------------------------------*/
+
+/*
+ * Binary record of format string ID and 1 to BSP_LOG_MAX_ARGS 32 bit
+ * arguments, host tool keeps the ID to format string table. C only.
+ *   BSP_LOG(LOG_ID_ADC, ch, value);
+ */
+#define BSP_LOG(id, ...)														\
+	BSP_Log_Record((id), (const uint32_t[]){ __VA_ARGS__ },						\
+				   (uint8_t)(sizeof((const uint32_t[]){ __VA_ARGS__ }) / sizeof(uint32_t)))
+
+/* Exported functions prototypes ---------------------------------------------*/
+
+/* Select port, it needs a TX queue */
+void BSP_Log_Init(BSP_USART_Port_t *port);
+
+/* Queue output, never block, whole line or record is dropped when queue is full.
+   Printf from tasks only, Write and Record also from interrupts */
+int BSP_Log_Printf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+HAL_StatusTypeDef BSP_Log_Write(const uint8_t *data, uint16_t len);
+HAL_StatusTypeDef BSP_Log_Record(uint16_t id, const uint32_t *args, uint8_t argc);
+
+/* Lines and records lost since init */
+uint32_t BSP_Log_GetDrops(void);
+
+/* Send queued output synchronously, safe from fault handlers */
+void BSP_Log_Flush(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BSP_USART_LOG_H */
@@ -0,0 +1,52 @@
+/**
+  ******************************************************************************
+  * @file           : bsp_usart_tick.h
+  * @brief          : Timeout conversion shared by bsp_usart and bsp_usart_ipc.
+  *                   Header only, the IPC consumer core builds without the
+  *                   UART driver.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 kripac@163.com
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __BSP_USART_TICK_H
+#define __BSP_USART_TICK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "cmsis_os.h"
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Convert ms timeout to RTOS ticks, rounded up
+  * @param  Timeout Timeout in ms, HAL_MAX_DELAY wait forever
+  * @retval Ticks
+  */
+static inline uint32_t BSP_USART_MsToTicks(uint32_t Timeout)
+{
+	if (Timeout == HAL_MAX_DELAY)
+	{
+		return osWaitForever;
+	}
+	return (uint32_t)(((uint64_t)Timeout * osKernelGetTickFreq() + 999u) / 1000u);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BSP_USART_TICK_H */
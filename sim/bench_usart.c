@@ -0,0 +1,330 @@
+/**
+  ******************************************************************************
+  * @file    bench_usart.c
+  * @brief   Host benchmark of bsp_usart reception.
+  *          A line thread replays an arrival pattern through the DMA model,
+  *          a consumer thread waits on the port semaphore and drains the
+  *          ring buffer. Reports throughput, drops, wake latency and age of
+  *          data when read, from the driver RX timestamps, for the
+  *          UART1_RX_DMA_BUF_LEN / UART1_RX_RB_LEN the binary was built with.
+  *
+  *          Usage: bench_usart [-b baud] [-n burst] [-g gap_us] [-c consumer_us]
+  *                             [-w watermark] [-r rts_high] [-t duration_ms]
+  *
+  *          -r enables USART RTS flow control, the line stops while RTS is
+  *          deasserted and resumes at half of the high watermark.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 kripac@163.com
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "bsp_usart.h"
+#include "sim_hal.h"
+#include "usart.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define BENCH_PATTERN_MOD	(251u)		/* Prime, never aligns with buffer sizes */
+#define BENCH_LAT_SLOTS		(4096u)		/* Latency samples kept for percentiles */
+#define BENCH_CHUNK_NS		(20000u)	/* Line thread injection granularity */
+
+/* Private types -------------------------------------------------------------*/
+typedef struct
+{
+	uint32_t			baud;
+	uint32_t			burst;			/* Bytes per burst */
+	uint32_t			gap_us;			/* Idle gap after a burst, 0 continuous stream */
+	uint32_t			consumer_us;	/* Consumer processing time per wakeup */
+	uint32_t			watermark;		/* RX watermark in bytes, 0 IDLE only */
+	uint32_t			rts_high;		/* RTS flow control high watermark, 0 off */
+	uint32_t			duration_ms;
+} bench_cfg_t;
+
+typedef struct
+{
+	uint64_t			sent;
+	uint64_t			received;
+	uint32_t			seq_err;
+	uint32_t			wakeups;
+	uint32_t			lat_n;
+	uint32_t			lat[BENCH_LAT_SLOTS];	/* Wake latency in ns */
+	uint64_t			lat_sum;
+	uint32_t			lat_max;
+	uint32_t			age_n;
+	uint32_t			age[BENCH_LAT_SLOTS];	/* Last byte arrival to read in ns */
+	uint64_t			age_sum;
+	uint32_t			age_max;
+} bench_result_t;
+
+/* Private variables ---------------------------------------------------------*/
+osSemaphoreId_t			Usart1RxSemHandle;
+
+static bench_cfg_t		cfg = { 115200u, 50u, 1000u, 0u, 0u, 0u, 1000u };
+static bench_result_t	res;
+static volatile int		line_done;
+
+/* Private functions ---------------------------------------------------------*/
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+	
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void sleep_until(uint64_t t)
+{
+	struct timespec ts = { (time_t)(t / 1000000000ull), (long)(t % 1000000000ull) };
+	
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+	{
+	}
+}
+
+/* Line side, inject bursts at wire speed followed by idle gaps */
+static void *line_thread(void *arg)
+{
+	uint8_t		chunk[256];
+	uint64_t	byte_ns = 10000000000ull / cfg.baud;	/* 8N1, 10 bits per byte */
+	uint64_t	t_end = now_ns() + (uint64_t)cfg.duration_ms * 1000000ull;
+	uint64_t	t_burst;
+	uint64_t	due;
+	uint32_t	done;
+	uint32_t	n;
+	uint32_t	i;
+	uint8_t		seq = 0u;
+	
+	(void)arg;
+	while (now_ns() < t_end)
+	{
+		t_burst = now_ns();
+		done = 0u;
+		while (done < cfg.burst)
+		{
+			sleep_until(now_ns() + BENCH_CHUNK_NS);
+			due = (now_ns() - t_burst) / byte_ns;
+			n = (due > cfg.burst ? cfg.burst : (uint32_t)due) - done;
+			n = n > sizeof(chunk) ? sizeof(chunk) : n;
+			for (i = 0u; i < n; i++)
+			{
+				chunk[i] = seq;
+				seq = (seq + 1u) % BENCH_PATTERN_MOD;
+			}
+			if (cfg.rts_high == 0u)
+			{
+				sim_uart_rx(&huart1, chunk, n);
+				done += n;
+				continue;
+			}
+			
+			/* Sender checks CTS before each byte, wire time stops while held */
+			for (i = 0u; i < n; i++)
+			{
+				if (!sim_uart_rts(&huart1))
+				{
+					/* Stopped line goes idle, that wakes the consumer */
+					sleep_until(now_ns() + byte_ns);
+					sim_uart_idle(&huart1);
+					while (!sim_uart_rts(&huart1))
+					{
+						sleep_until(now_ns() + BENCH_CHUNK_NS);
+						t_burst += BENCH_CHUNK_NS;
+					}
+				}
+				sim_uart_rx(&huart1, &chunk[i], 1u);
+			}
+			done += n;
+		}
+		res.sent += done;
+		
+		if (cfg.gap_us > 0u)
+		{
+			/* IDLE fires one character after the last stop bit */
+			sleep_until(now_ns() + byte_ns);
+			sim_uart_idle(&huart1);
+			sleep_until(t_burst + done * byte_ns + (uint64_t)cfg.gap_us * 1000ull);
+		}
+	}
+	
+	line_done = 1;
+	return NULL;
+}
+
+/* Application side, wait on port semaphore and drain the ring buffer */
+static void *consumer_thread(void *arg)
+{
+	uint8_t		buf[256];
+	uint8_t		expect = 0u;
+	uint16_t	n;
+	uint16_t	i;
+	uint32_t	lat;
+	uint32_t	t_last;
+	
+	(void)arg;
+	while (!line_done || (lwrb_get_full(&usart1_port.rx_rb) > 0u))
+	{
+		if (osSemaphoreAcquire(Usart1RxSemHandle, 20u) == osOK)
+		{
+			lat = sim_timestamp() - sim_sem_release_time(Usart1RxSemHandle);
+			res.wakeups++;
+			res.lat_sum += lat;
+			res.lat_max = lat > res.lat_max ? lat : res.lat_max;
+			res.lat[res.lat_n++ % BENCH_LAT_SLOTS] = lat;
+		}
+		else if (!line_done)
+		{
+			continue;
+		}
+		
+		while ((n = BSP_USART_ReadRBTs(&usart1_port, buf, sizeof(buf), NULL, &t_last)) > 0u)
+		{
+			lat = sim_timestamp() - t_last;
+			res.age_sum += lat;
+			res.age_max = lat > res.age_max ? lat : res.age_max;
+			res.age[res.age_n++ % BENCH_LAT_SLOTS] = lat;
+			res.received += n;
+			for (i = 0u; i < n; i++)
+			{
+				if (buf[i] != expect)
+				{
+					res.seq_err++;
+				}
+				expect = (buf[i] + 1u) % BENCH_PATTERN_MOD;
+			}
+		}
+		
+		if (cfg.consumer_us > 0u)
+		{
+			sleep_until(now_ns() + (uint64_t)cfg.consumer_us * 1000ull);
+		}
+	}
+	return NULL;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
+	
+	return (x > y) - (x < y);
+}
+
+static void report(uint64_t elapsed_ns)
+{
+	BSP_USART_Stats_t	st;
+	uint32_t			n = res.lat_n < BENCH_LAT_SLOTS ? res.lat_n : BENCH_LAT_SLOTS;
+	uint32_t			age_n = res.age_n < BENCH_LAT_SLOTS ? res.age_n : BENCH_LAT_SLOTS;
+	uint32_t			p99 = 0u;
+	uint32_t			age_p99 = 0u;
+	
+	BSP_USART_GetStats(&usart1_port, &st);
+	if (n > 0u)
+	{
+		qsort(res.lat, n, sizeof(res.lat[0]), cmp_u32);
+		p99 = res.lat[(n * 99u) / 100u];
+	}
+	if (age_n > 0u)
+	{
+		qsort(res.age, age_n, sizeof(res.age[0]), cmp_u32);
+		age_p99 = res.age[(age_n * 99u) / 100u];
+	}
+	
+	printf("cfg      baud %u burst %u gap %u us consumer %u us watermark %u dma %u rb %u\n",
+		cfg.baud, cfg.burst, cfg.gap_us, cfg.consumer_us, cfg.watermark,
+		usart1_port.rx_dma_len, usart1_port.rx_rb_len);
+	printf("bytes    sent %llu received %llu dropped %u seq_err %u\n",
+		(unsigned long long)res.sent, (unsigned long long)res.received, st.rx_drop, res.seq_err);
+	printf("rate     %.1f kB/s, drop %.3f %%\n",
+		(double)res.received * 1e6 / (double)elapsed_ns,
+		res.sent ? 100.0 * (double)(res.sent - res.received) / (double)res.sent : 0.0);
+	printf("wakeup   %u, latency avg %.1f us p99 %.1f us max %.1f us\n",
+		res.wakeups, res.wakeups ? (double)res.lat_sum / res.wakeups / 1e3 : 0.0,
+		p99 / 1e3, res.lat_max / 1e3);
+	printf("age      %u reads, last byte to read avg %.1f us p99 %.1f us max %.1f us\n",
+		res.age_n, res.age_n ? (double)res.age_sum / res.age_n / 1e3 : 0.0,
+		age_p99 / 1e3, res.age_max / 1e3);
+	printf("events   idle %u ht %u tc %u wrap %u peak %u rts hold %u\n",
+		st.evt_idle, st.evt_ht, st.evt_tc, st.dma_wrap, st.rb_peak, st.rts_hold);
+	
+	#ifdef USART_PROFILE
+	{
+		static const char *const name[BSP_USART_EVT_NUM] = { "tc", "ht", "idle", "err" };
+		BSP_USART_Prof_t prof;
+		uint32_t e;
+		
+		for (e = 0u; e < BSP_USART_EVT_NUM; e++)
+		{
+			BSP_USART_GetProfile(&usart1_port, (BSP_USART_Evt_t)e, &prof);
+			if (prof.count > 0u)
+			{
+				printf("isr %-4s n %u min %u mean %u max %u ns\n", name[e], prof.count, prof.min, prof.mean, prof.max);
+			}
+		}
+	}
+	#endif
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t	line;
+	pthread_t	consumer;
+	uint64_t	t0;
+	int			opt;
+	
+	while ((opt = getopt(argc, argv, "b:n:g:c:w:r:t:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'b': cfg.baud = strtoul(optarg, NULL, 0); break;
+			case 'n': cfg.burst = strtoul(optarg, NULL, 0); break;
+			case 'g': cfg.gap_us = strtoul(optarg, NULL, 0); break;
+			case 'c': cfg.consumer_us = strtoul(optarg, NULL, 0); break;
+			case 'w': cfg.watermark = strtoul(optarg, NULL, 0); break;
+			case 'r': cfg.rts_high = strtoul(optarg, NULL, 0); break;
+			case 't': cfg.duration_ms = strtoul(optarg, NULL, 0); break;
+			default:
+				fprintf(stderr, "usage: %s [-b baud] [-n burst] [-g gap_us] [-c consumer_us] [-w watermark] [-r rts_high] [-t duration_ms]\n", argv[0]);
+				return 1;
+		}
+	}
+	if ((cfg.baud == 0u) || (cfg.burst == 0u))
+	{
+		fprintf(stderr, "baud and burst must not be 0\n");
+		return 1;
+	}
+	
+	Usart1RxSemHandle = osSemaphoreNew(1u, 0u, NULL);
+	huart1.Init.BaudRate = cfg.baud;
+	if (cfg.rts_high != 0u)
+	{
+		/* Hardware flow control as CubeMX sets it up */
+		SET_BIT(huart1.Instance->CR3, USART_CR3_RTSE);
+		BSP_USART_SetRtsFlow(&usart1_port, cfg.rts_high, cfg.rts_high / 2u, NULL, 0u);
+	}
+	USART1_Init();
+	BSP_USART_SetRxWatermark(&usart1_port, cfg.watermark);
+	
+	t0 = now_ns();
+	pthread_create(&consumer, NULL, consumer_thread, NULL);
+	pthread_create(&line, NULL, line_thread, NULL);
+	pthread_join(line, NULL);
+	pthread_join(consumer, NULL);
+	
+	report(now_ns() - t0);
+	return 0;
+}
@@ -0,0 +1,87 @@
+/**
+  ******************************************************************************
+  * @file    cmsis_os.h
+  * @brief   Host simulator subset of CMSIS-RTOS2, backed by pthreads in
+  *          sim_os.c. Ticks are milliseconds.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 kripac@163.com
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef CMSIS_OS_H_
+#define CMSIS_OS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+	osOK					=  0,
+	osError					= -1,
+	osErrorTimeout			= -2,
+	osErrorResource			= -3,
+	osErrorParameter		= -4,
+	osErrorNoMemory			= -5
+} osStatus_t;
+
+typedef struct sim_sem		*osSemaphoreId_t;
+typedef struct sim_sem		*osMutexId_t;
+typedef struct sim_thread	*osThreadId_t;
+typedef struct sim_flags	*osEventFlagsId_t;
+
+/* Exported constants --------------------------------------------------------*/
+#define osWaitForever			0xFFFFFFFFU
+#define osFlagsWaitAny			0x00000000U
+#define osFlagsWaitAll			0x00000001U
+#define osFlagsNoClear			0x00000002U
+#define osFlagsError			0x80000000U
+#define osFlagsErrorTimeout		0xFFFFFFFEU
+
+/* Exported functions prototypes ---------------------------------------------*/
+uint32_t osKernelGetTickCount(void);
+uint32_t osKernelGetTickFreq(void);
+int32_t osKernelLock(void);
+int32_t osKernelUnlock(void);
+osStatus_t osDelay(uint32_t ticks);
+
+osSemaphoreId_t osSemaphoreNew(uint32_t max_count, uint32_t initial_count, const void *attr);
+osStatus_t osSemaphoreAcquire(osSemaphoreId_t semaphore_id, uint32_t timeout);
+osStatus_t osSemaphoreRelease(osSemaphoreId_t semaphore_id);
+
+osMutexId_t osMutexNew(const void *attr);
+osStatus_t osMutexAcquire(osMutexId_t mutex_id, uint32_t timeout);
+osStatus_t osMutexRelease(osMutexId_t mutex_id);
+
+osThreadId_t osThreadGetId(void);
+uint32_t osThreadFlagsSet(osThreadId_t thread_id, uint32_t flags);
+uint32_t osThreadFlagsClear(uint32_t flags);
+uint32_t osThreadFlagsWait(uint32_t flags, uint32_t options, uint32_t timeout);
+
+osEventFlagsId_t osEventFlagsNew(const void *attr);
+uint32_t osEventFlagsSet(osEventFlagsId_t ef_id, uint32_t flags);
+uint32_t osEventFlagsClear(osEventFlagsId_t ef_id, uint32_t flags);
+uint32_t osEventFlagsGet(osEventFlagsId_t ef_id);
+uint32_t osEventFlagsWait(osEventFlagsId_t ef_id, uint32_t flags, uint32_t options, uint32_t timeout);
+
+/* Simulator only, timestamp of last release in ns, see bench_usart.c */
+uint32_t sim_sem_release_time(osSemaphoreId_t semaphore_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CMSIS_OS_H_ */
@@ -0,0 +1,281 @@
+/**
+  ******************************************************************************
+  * @file           : main.h
+  * @brief          : Host simulator stand-in for the CubeMX main.h.
+  *                   Provides the HAL types, macros and functions bsp_usart.c
+  *                   uses, backed by sim_hal.c.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 kripac@163.com
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __MAIN_H
+#define __MAIN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+	HAL_OK			= 0x00U,
+	HAL_ERROR		= 0x01U,
+	HAL_BUSY		= 0x02U,
+	HAL_TIMEOUT		= 0x03U
+} HAL_StatusTypeDef;
+
+typedef enum
+{
+	GPIO_PIN_RESET	= 0U,
+	GPIO_PIN_SET
+} GPIO_PinState;
+
+typedef struct
+{
+	volatile uint32_t	ODR;
+} GPIO_TypeDef;
+
+typedef struct
+{
+	volatile uint32_t	CR1;
+	volatile uint32_t	CR2;
+	volatile uint32_t	CR3;
+	volatile uint32_t	BRR;
+	volatile uint32_t	GTPR;
+	volatile uint32_t	RTOR;
+	volatile uint32_t	RQR;
+	volatile uint32_t	ISR;
+	volatile uint32_t	ICR;
+	volatile uint32_t	RDR;
+	volatile uint32_t	TDR;
+	volatile uint32_t	PRESC;
+} USART_TypeDef;
+
+typedef struct
+{
+	volatile uint32_t	CR;
+	volatile uint32_t	NDTR;
+	volatile uint32_t	PAR;
+	volatile uint32_t	M0AR;
+	volatile uint32_t	M1AR;
+	volatile uint32_t	FCR;
+} DMA_Stream_TypeDef;
+
+typedef struct
+{
+	uint32_t			Direction;
+	uint32_t			Mode;
+} DMA_InitTypeDef;
+
+typedef struct __DMA_HandleTypeDef
+{
+	DMA_Stream_TypeDef	*Instance;
+	DMA_InitTypeDef		Init;
+	void				*Parent;
+	void				(*XferCpltCallback)(struct __DMA_HandleTypeDef *hdma);
+	void				(*XferHalfCpltCallback)(struct __DMA_HandleTypeDef *hdma);
+	void				(*XferM1CpltCallback)(struct __DMA_HandleTypeDef *hdma);
+	void				(*XferErrorCallback)(struct __DMA_HandleTypeDef *hdma);
+} DMA_HandleTypeDef;
+
+typedef struct
+{
+	uint32_t			BaudRate;
+	uint32_t			WordLength;
+	uint32_t			StopBits;
+	uint32_t			Parity;
+	uint32_t			Mode;
+	uint32_t			HwFlowCtl;
+} UART_InitTypeDef;
+
+typedef struct __UART_HandleTypeDef
+{
+	USART_TypeDef		*Instance;
+	UART_InitTypeDef	Init;
+	uint8_t				*pRxBuffPtr;
+	uint16_t			RxXferSize;
+	volatile uint32_t	ReceptionType;
+	volatile uint32_t	RxEventType;
+	DMA_HandleTypeDef	*hdmatx;
+	DMA_HandleTypeDef	*hdmarx;
+	volatile uint32_t	gState;
+	volatile uint32_t	RxState;
+	volatile uint32_t	ErrorCode;
+	void				(*TxCpltCallback)(struct __UART_HandleTypeDef *huart);
+	void				(*ErrorCallback)(struct __UART_HandleTypeDef *huart);
+	void				(*RxEventCallback)(struct __UART_HandleTypeDef *huart, uint16_t Pos);
+} UART_HandleTypeDef;
+
+typedef enum
+{
+	HAL_UART_TX_HALFCOMPLETE_CB_ID	= 0x00U,
+	HAL_UART_TX_COMPLETE_CB_ID		= 0x01U,
+	HAL_UART_RX_HALFCOMPLETE_CB_ID	= 0x02U,
+	HAL_UART_RX_COMPLETE_CB_ID		= 0x03U,
+	HAL_UART_ERROR_CB_ID			= 0x04U
+} HAL_UART_CallbackIDTypeDef;
+
+typedef void (*pUART_CallbackTypeDef)(UART_HandleTypeDef *huart);
+typedef void (*pUART_RxEventCallbackTypeDef)(UART_HandleTypeDef *huart, uint16_t Pos);
+
+/* Exported constants --------------------------------------------------------*/
+#define HAL_MAX_DELAY				0xFFFFFFFFU
+
+#define HAL_UART_RXEVENT_TC			(0x00000000U)
+#define HAL_UART_RXEVENT_HT			(0x00000001U)
+#define HAL_UART_RXEVENT_IDLE		(0x00000002U)
+
+#define HAL_UART_RECEPTION_STANDARD	(0x00000000U)
+#define HAL_UART_RECEPTION_TOIDLE	(0x00000001U)
+
+#define HAL_UART_STATE_READY		(0x00000020U)
+#define HAL_UART_STATE_BUSY_TX		(0x00000021U)
+#define HAL_UART_STATE_BUSY_RX		(0x00000022U)
+
+#define HAL_UART_ERROR_NONE			(0x00000000U)
+#define HAL_UART_ERROR_PE			(0x00000001U)
+#define HAL_UART_ERROR_NE			(0x00000002U)
+#define HAL_UART_ERROR_FE			(0x00000004U)
+#define HAL_UART_ERROR_ORE			(0x00000008U)
+#define HAL_UART_ERROR_DMA			(0x00000010U)
+#define HAL_UART_ERROR_RTO			(0x00000020U)
+
+#define DMA_NORMAL					(0x00000000U)
+#define DMA_CIRCULAR				(0x00000100U)
+#define DMA_SxCR_EN					(1U << 0)
+#define DMA_SxCR_DBM				(1U << 18)
+#define DMA_SxCR_CT					(1U << 19)
+
+#define UART_WORDLENGTH_7B			(1U << 28)
+#define UART_WORDLENGTH_8B			(0x00000000U)
+#define UART_WORDLENGTH_9B			(1U << 12)
+#define UART_STOPBITS_0_5			(1U << 12)
+#define UART_STOPBITS_1				(0x00000000U)
+#define UART_STOPBITS_1_5			(3U << 12)
+#define UART_STOPBITS_2				(1U << 13)
+
+#define UART_CLEAR_PEF				(1U << 0)
+#define UART_CLEAR_FEF				(1U << 1)
+#define UART_CLEAR_NEF				(1U << 2)
+#define UART_CLEAR_OREF				(1U << 3)
+#define UART_CLEAR_IDLEF			(1U << 4)
+#define UART_CLEAR_TCF				(1U << 6)
+#define UART_CLEAR_RTOF				(1U << 11)
+#define UART_CLEAR_CMF				(1U << 17)
+
+#define UART_RXDATA_FLUSH_REQUEST	(1U << 3)
+
+#define USART_CR1_UE				(1U << 0)
+#define USART_CR1_RE				(1U << 2)
+#define USART_CR1_IDLEIE			(1U << 4)
+#define USART_CR1_PEIE				(1U << 8)
+#define USART_CR1_CMIE				(1U << 14)
+#define USART_CR1_RTOIE				(1U << 26)
+#define USART_CR2_RTOEN				(1U << 23)
+#define USART_CR2_ADD_Pos			(24U)
+#define USART_CR2_ADD				(0xFFU << USART_CR2_ADD_Pos)
+#define USART_CR3_EIE				(1U << 0)
+#define USART_CR3_DMAR				(1U << 6)
+#define USART_CR3_DMAT				(1U << 7)
+#define USART_CR3_RTSE				(1U << 8)
+#define USART_CR3_DDRE				(1U << 13)
+#define USART_RTOR_RTO				(0x00FFFFFFU)
+#define USART_ISR_PE				(1U << 0)
+#define USART_ISR_FE				(1U << 1)
+#define USART_ISR_NE				(1U << 2)
+#define USART_ISR_ORE				(1U << 3)
+#define USART_ISR_IDLE				(1U << 4)
+#define USART_ISR_RTOF				(1U << 11)
+#define USART_ISR_CMF				(1U << 17)
+
+#define UART_FLAG_IDLE				USART_ISR_IDLE
+#define UART_FLAG_RTOF				USART_ISR_RTOF
+#define UART_FLAG_CMF				USART_ISR_CMF
+
+/* Exported macro ------------------------------------------------------------*/
+#define UNUSED(X)					(void)X
+
+#define SET_BIT(REG, BIT)			((REG) |= (BIT))
+#define CLEAR_BIT(REG, BIT)			((REG) &= ~(BIT))
+#define READ_BIT(REG, BIT)			((REG) & (BIT))
+#define MODIFY_REG(REG, CLEARMASK, SETMASK)	((REG) = (((REG) & (~(CLEARMASK))) | (SETMASK)))
+#define ATOMIC_SET_BIT(REG, BIT)	do { __disable_irq(); SET_BIT(REG, BIT); __enable_irq(); } while (0)
+#define ATOMIC_CLEAR_BIT(REG, BIT)	do { __disable_irq(); CLEAR_BIT(REG, BIT); __enable_irq(); } while (0)
+
+#define __HAL_UART_CLEAR_FLAG(__HANDLE__, __FLAG__)	((__HANDLE__)->Instance->ICR = (__FLAG__))
+#define __HAL_UART_GET_FLAG(__HANDLE__, __FLAG__)	(((__HANDLE__)->Instance->ISR & (__FLAG__)) == (__FLAG__))
+#define __HAL_UART_ENABLE(__HANDLE__)				SET_BIT((__HANDLE__)->Instance->CR1, USART_CR1_UE)
+#define __HAL_UART_DISABLE(__HANDLE__)				CLEAR_BIT((__HANDLE__)->Instance->CR1, USART_CR1_UE)
+#define __HAL_DMA_GET_COUNTER(__HANDLE__)			((__HANDLE__)->Instance->NDTR)
+#define __HAL_UART_SEND_REQ(__HANDLE__, __REQ__)	((__HANDLE__)->Instance->RQR |= (uint16_t)(__REQ__))
+
+/* Host timestamp, ns of CLOCK_MONOTONIC truncated to 32 bits */
+#define BSP_USART_TIMESTAMP()		sim_timestamp()
+#define BSP_USART_TIMESTAMP_INIT()	do { } while (0)
+#define BSP_USART_TIMESTAMP_FREQ	(1000000000u)
+
+/* Shared region of both "cores", threads of one process here */
+#define SIM_IPC_SHARED_LEN			(65536u)
+extern uint8_t sim_ipc_shared[SIM_IPC_SHARED_LEN];
+#define BSP_IPC_SHARED_BASE			((uintptr_t)sim_ipc_shared)
+
+/* HSEM -----------------------------------------------------------------------*/
+#define __HAL_HSEM_SEMID_TO_MASK(__SEMID__)	(1UL << (__SEMID__))
+
+/* Core ------------------------------------------------------------------------*/
+/*
+ * Interrupts are modelled by one recursive lock. Injected events run with it
+ * held, __disable_irq() takes it in task context.
+ */
+void __disable_irq(void);
+void __enable_irq(void);
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t priMask);
+void __DMB(void);
+void __DSB(void);
+void __SEV(void);
+void __WFE(void);
+
+static inline void SCB_InvalidateDCache_by_Addr(volatile void *addr, int32_t dsize) { (void)addr; (void)dsize; }
+static inline void SCB_CleanDCache_by_Addr(volatile void *addr, int32_t dsize) { (void)addr; (void)dsize; }
+
+/* Exported functions prototypes ---------------------------------------------*/
+uint32_t HAL_GetTick(void);
+uint32_t sim_timestamp(void);
+
+HAL_StatusTypeDef HAL_UART_RegisterCallback(UART_HandleTypeDef *huart, HAL_UART_CallbackIDTypeDef CallbackID, pUART_CallbackTypeDef pCallback);
+HAL_StatusTypeDef HAL_UART_RegisterRxEventCallback(UART_HandleTypeDef *huart, pUART_RxEventCallbackTypeDef pCallback);
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_UART_AbortReceive(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_AbortTransmit(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_DMAEx_MultiBufferStart_IT(DMA_HandleTypeDef *hdma, uint32_t SrcAddress, uint32_t DstAddress, uint32_t SecondMemAddress, uint32_t DataLength);
+void HAL_UART_ReceiverTimeout_Config(UART_HandleTypeDef *huart, uint32_t TimeoutValue);
+HAL_StatusTypeDef HAL_UART_EnableReceiverTimeout(UART_HandleTypeDef *huart);
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+HAL_StatusTypeDef HAL_HSEM_FastTake(uint32_t SemID);
+void HAL_HSEM_Release(uint32_t SemID, uint32_t ProcessID);
+void HAL_HSEM_ActivateNotification(uint32_t SemMask);
+void HAL_HSEM_FreeCallback(uint32_t SemMask);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MAIN_H */
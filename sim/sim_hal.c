@@ -0,0 +1,520 @@
+/**
+  ******************************************************************************
+  * @file    sim_hal.c
+  * @brief   Host simulator, fake UART handles and circular RX DMA model.
+  *          Event ordering and sizes follow the STM32 HAL ReceiveToIdle_DMA
+  *          implementation.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 kripac@163.com
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "sim_hal.h"
+#include "usart.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define SIM_UART_NUM	(9u)
+
+/* Private types -------------------------------------------------------------*/
+typedef struct
+{
+	const uint8_t		*tx_ptr;		/* Pending TX DMA transfer */
+	uint16_t			tx_len;
+	sim_tx_hook_t		tx_hook;
+	sim_irq_hook_t		irq_hook;		/* USARTx_IRQHandler() pre-handler */
+	uint16_t			dbm_len;		/* Double buffer DMA transfer length */
+	uint8_t				rdr;			/* Byte waiting for a DMA request */
+	uint8_t				rdr_full;
+} sim_uart_t;
+
+/* Private macro -------------------------------------------------------------*/
+#define SIM_UART_HANDLE(n)														\
+	{																			\
+		.Instance	= &usart_regs[n],											\
+		.Init		= { .BaudRate = 115200u },									\
+		.hdmarx		= &hdma_rx[n],												\
+		.hdmatx		= &hdma_tx[n],												\
+		.gState		= HAL_UART_STATE_READY,										\
+		.RxState	= HAL_UART_STATE_READY,										\
+	}
+
+#define SIM_DMA_HANDLE(n, mode, parent)	{ .Instance = &dma_regs[n], .Init = { .Mode = (mode) }, .Parent = &(parent) }
+
+/* Private variables ---------------------------------------------------------*/
+static USART_TypeDef		usart_regs[SIM_UART_NUM];
+static DMA_Stream_TypeDef	dma_regs[SIM_UART_NUM * 2u];
+static DMA_HandleTypeDef	hdma_rx[SIM_UART_NUM] =
+{
+	SIM_DMA_HANDLE(0, DMA_CIRCULAR, huart1), SIM_DMA_HANDLE(1, DMA_CIRCULAR, huart2), SIM_DMA_HANDLE(2, DMA_CIRCULAR, huart3),
+	SIM_DMA_HANDLE(3, DMA_CIRCULAR, huart4), SIM_DMA_HANDLE(4, DMA_CIRCULAR, huart5), SIM_DMA_HANDLE(5, DMA_CIRCULAR, huart6),
+	SIM_DMA_HANDLE(6, DMA_CIRCULAR, huart7), SIM_DMA_HANDLE(7, DMA_CIRCULAR, huart8), SIM_DMA_HANDLE(8, DMA_CIRCULAR, hlpuart1),
+};
+static DMA_HandleTypeDef	hdma_tx[SIM_UART_NUM] =
+{
+	SIM_DMA_HANDLE(9, DMA_NORMAL, huart1),  SIM_DMA_HANDLE(10, DMA_NORMAL, huart2), SIM_DMA_HANDLE(11, DMA_NORMAL, huart3),
+	SIM_DMA_HANDLE(12, DMA_NORMAL, huart4), SIM_DMA_HANDLE(13, DMA_NORMAL, huart5), SIM_DMA_HANDLE(14, DMA_NORMAL, huart6),
+	SIM_DMA_HANDLE(15, DMA_NORMAL, huart7), SIM_DMA_HANDLE(16, DMA_NORMAL, huart8), SIM_DMA_HANDLE(17, DMA_NORMAL, hlpuart1),
+};
+static sim_uart_t			sim_uart[SIM_UART_NUM];
+static uint32_t				sim_hsem_taken;
+static uint32_t				sim_hsem_notify;
+
+/* Exported variables --------------------------------------------------------*/
+uint8_t						sim_ipc_shared[SIM_IPC_SHARED_LEN] __attribute__((aligned(64)));
+
+UART_HandleTypeDef huart1 = SIM_UART_HANDLE(0);
+UART_HandleTypeDef huart2 = SIM_UART_HANDLE(1);
+UART_HandleTypeDef huart3 = SIM_UART_HANDLE(2);
+UART_HandleTypeDef huart4 = SIM_UART_HANDLE(3);
+UART_HandleTypeDef huart5 = SIM_UART_HANDLE(4);
+UART_HandleTypeDef huart6 = SIM_UART_HANDLE(5);
+UART_HandleTypeDef huart7 = SIM_UART_HANDLE(6);
+UART_HandleTypeDef huart8 = SIM_UART_HANDLE(7);
+UART_HandleTypeDef hlpuart1 = SIM_UART_HANDLE(8);
+
+/* Private functions ---------------------------------------------------------*/
+static sim_uart_t *sim_get(UART_HandleTypeDef *huart)
+{
+	return &sim_uart[huart->Instance - usart_regs];
+}
+
+/*
+ * DMA address registers are 32 bits. Host buffers are static like on target,
+ * so they share the upper address bits with this file's data.
+ */
+static uint8_t *sim_dma_addr(uint32_t addr)
+{
+	return (uint8_t *)(((uintptr_t)usart_regs & ~(uintptr_t)0xFFFFFFFFu) | addr);
+}
+
+/* Double buffer DMA stream enabled on USART RX */
+static int sim_dbm_active(UART_HandleTypeDef *huart)
+{
+	uint32_t cr = huart->hdmarx->Instance->CR;
+	
+	return ((cr & (DMA_SxCR_EN | DMA_SxCR_DBM)) == (DMA_SxCR_EN | DMA_SxCR_DBM)) &&
+		   READ_BIT(huart->Instance->CR3, USART_CR3_DMAR);
+}
+
+/* One byte into double buffer stream, switch target and complete on last one */
+static void sim_dbm_rx(UART_HandleTypeDef *huart, uint8_t byte)
+{
+	DMA_HandleTypeDef	*hdma = huart->hdmarx;
+	DMA_Stream_TypeDef	*dma = hdma->Instance;
+	uint32_t			ct = dma->CR & DMA_SxCR_CT;
+	uint8_t				*mem = sim_dma_addr(ct ? dma->M1AR : dma->M0AR);
+	
+	mem[sim_get(huart)->dbm_len - dma->NDTR] = byte;
+	if (--dma->NDTR == 0u)
+	{
+		dma->NDTR = sim_get(huart)->dbm_len;
+		dma->CR ^= DMA_SxCR_CT;
+		if ((ct ? hdma->XferM1CpltCallback : hdma->XferCpltCallback) != NULL)
+		{
+			(ct ? hdma->XferM1CpltCallback : hdma->XferCpltCallback)(hdma);
+		}
+	}
+}
+
+/* Raise a reception event the way HAL_UART_IRQHandler/UART_DMARxxxCplt do */
+static void sim_rx_event(UART_HandleTypeDef *huart, uint32_t type, uint16_t size)
+{
+	huart->RxEventType = type;
+	if (huart->RxEventCallback != NULL)
+	{
+		huart->RxEventCallback(huart, size);
+	}
+}
+
+/* Raise a USART interrupt flag and run the IRQ pre-handler if enabled */
+static void sim_usart_irq(UART_HandleTypeDef *huart, uint32_t flag, uint32_t enable)
+{
+	sim_uart_t *sim = sim_get(huart);
+	
+	SET_BIT(huart->Instance->ISR, flag);
+	if (READ_BIT(huart->Instance->CR1, enable) && (sim->irq_hook != NULL))
+	{
+		sim->irq_hook(huart);
+	}
+	/* Writes to ICR clear flags */
+	CLEAR_BIT(huart->Instance->ISR, huart->Instance->ICR);
+	huart->Instance->ICR = 0u;
+}
+
+/* HAL --------------------------------------------------------------------------*/
+HAL_StatusTypeDef HAL_UART_RegisterCallback(UART_HandleTypeDef *huart, HAL_UART_CallbackIDTypeDef CallbackID, pUART_CallbackTypeDef pCallback)
+{
+	switch (CallbackID)
+	{
+		case HAL_UART_TX_COMPLETE_CB_ID:
+			huart->TxCpltCallback = pCallback;
+			return HAL_OK;
+		
+		case HAL_UART_ERROR_CB_ID:
+			huart->ErrorCallback = pCallback;
+			return HAL_OK;
+		
+		default:
+			return HAL_ERROR;
+	}
+}
+
+HAL_StatusTypeDef HAL_UART_RegisterRxEventCallback(UART_HandleTypeDef *huart, pUART_RxEventCallbackTypeDef pCallback)
+{
+	huart->RxEventCallback = pCallback;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size)
+{
+	if (huart->RxState != HAL_UART_STATE_READY)
+	{
+		return HAL_BUSY;
+	}
+	if ((pData == NULL) || (Size == 0u))
+	{
+		return HAL_ERROR;
+	}
+	
+	__disable_irq();
+	huart->pRxBuffPtr = pData;
+	huart->RxXferSize = Size;
+	huart->ReceptionType = HAL_UART_RECEPTION_TOIDLE;
+	huart->RxState = HAL_UART_STATE_BUSY_RX;
+	huart->ErrorCode = HAL_UART_ERROR_NONE;
+	huart->hdmarx->Instance->NDTR = Size;
+	huart->hdmarx->Instance->M0AR = (uint32_t)(uintptr_t)pData;
+	SET_BIT(huart->Instance->CR1, USART_CR1_PEIE | USART_CR1_IDLEIE | USART_CR1_RE | USART_CR1_UE);
+	SET_BIT(huart->Instance->CR3, USART_CR3_EIE | USART_CR3_DMAR);
+	__enable_irq();
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMAEx_MultiBufferStart_IT(DMA_HandleTypeDef *hdma, uint32_t SrcAddress, uint32_t DstAddress, uint32_t SecondMemAddress, uint32_t DataLength)
+{
+	UART_HandleTypeDef *huart = (UART_HandleTypeDef *)hdma->Parent;
+	
+	if ((hdma->XferCpltCallback == NULL) || (hdma->XferM1CpltCallback == NULL) || (hdma->XferErrorCallback == NULL))
+	{
+		return HAL_ERROR;
+	}
+	__disable_irq();
+	sim_get(huart)->dbm_len = DataLength;
+	hdma->Instance->PAR = SrcAddress;
+	hdma->Instance->M0AR = DstAddress;
+	hdma->Instance->M1AR = SecondMemAddress;
+	hdma->Instance->NDTR = DataLength;
+	CLEAR_BIT(hdma->Instance->CR, DMA_SxCR_CT);
+	SET_BIT(hdma->Instance->CR, DMA_SxCR_DBM | DMA_SxCR_EN);
+	__enable_irq();
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_AbortReceive(UART_HandleTypeDef *huart)
+{
+	__disable_irq();
+	CLEAR_BIT(huart->Instance->CR1, USART_CR1_PEIE | USART_CR1_IDLEIE);
+	CLEAR_BIT(huart->Instance->CR3, USART_CR3_EIE | USART_CR3_DMAR);
+	huart->RxState = HAL_UART_STATE_READY;
+	huart->ReceptionType = HAL_UART_RECEPTION_STANDARD;
+	__enable_irq();
+	return HAL_OK;
+}
+
+void HAL_UART_ReceiverTimeout_Config(UART_HandleTypeDef *huart, uint32_t TimeoutValue)
+{
+	MODIFY_REG(huart->Instance->RTOR, USART_RTOR_RTO, TimeoutValue);
+}
+
+HAL_StatusTypeDef HAL_UART_EnableReceiverTimeout(UART_HandleTypeDef *huart)
+{
+	if (huart->gState != HAL_UART_STATE_READY)
+	{
+		return HAL_BUSY;
+	}
+	SET_BIT(huart->Instance->CR2, USART_CR2_RTOEN);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+	sim_uart_t *sim = sim_get(huart);
+	
+	(void)Timeout;
+	if (huart->gState != HAL_UART_STATE_READY)
+	{
+		return HAL_BUSY;
+	}
+	if (sim->tx_hook != NULL)
+	{
+		sim->tx_hook(huart, pData, Size);
+	}
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size)
+{
+	sim_uart_t *sim = sim_get(huart);
+	
+	if (huart->gState != HAL_UART_STATE_READY)
+	{
+		return HAL_BUSY;
+	}
+	huart->gState = HAL_UART_STATE_BUSY_TX;
+	sim->tx_ptr = pData;
+	sim->tx_len = Size;
+	huart->hdmatx->Instance->NDTR = Size;
+	return HAL_OK;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+	if (PinState == GPIO_PIN_SET)
+	{
+		GPIOx->ODR |= GPIO_Pin;
+	}
+	else
+	{
+		GPIOx->ODR &= ~(uint32_t)GPIO_Pin;
+	}
+}
+
+/* Hardware semaphores, a free notification runs the callback in the releasing thread */
+HAL_StatusTypeDef HAL_HSEM_FastTake(uint32_t SemID)
+{
+	uint32_t mask = __HAL_HSEM_SEMID_TO_MASK(SemID);
+	
+	return ((__atomic_fetch_or(&sim_hsem_taken, mask, __ATOMIC_ACQUIRE) & mask) != 0u) ? HAL_ERROR : HAL_OK;
+}
+
+void HAL_HSEM_Release(uint32_t SemID, uint32_t ProcessID)
+{
+	uint32_t mask = __HAL_HSEM_SEMID_TO_MASK(SemID);
+	
+	(void)ProcessID;
+	__atomic_fetch_and(&sim_hsem_taken, ~mask, __ATOMIC_RELEASE);
+	
+	/* Interrupt handler disables notification of freed semaphores */
+	if ((__atomic_fetch_and(&sim_hsem_notify, ~mask, __ATOMIC_ACQ_REL) & mask) != 0u)
+	{
+		HAL_HSEM_FreeCallback(mask);
+	}
+}
+
+void HAL_HSEM_ActivateNotification(uint32_t SemMask)
+{
+	__atomic_fetch_or(&sim_hsem_notify, SemMask, __ATOMIC_ACQ_REL);
+}
+
+__attribute__((weak)) void HAL_HSEM_FreeCallback(uint32_t SemMask)
+{
+	(void)SemMask;
+}
+
+HAL_StatusTypeDef HAL_UART_AbortTransmit(UART_HandleTypeDef *huart)
+{
+	/* Nothing left the fake DMA yet, NDTR keeps the whole transfer */
+	__disable_irq();
+	sim_get(huart)->tx_len = 0u;
+	huart->gState = HAL_UART_STATE_READY;
+	__enable_irq();
+	return HAL_OK;
+}
+
+/* Injection -----------------------------------------------------------------*/
+/* One byte from RDR into circular ReceiveToIdle DMA buffer */
+static void sim_dma_rx(UART_HandleTypeDef *huart, uint8_t byte)
+{
+	DMA_Stream_TypeDef *dma = huart->hdmarx->Instance;
+	
+	huart->pRxBuffPtr[huart->RxXferSize - dma->NDTR] = byte;
+	dma->NDTR--;
+	if (byte == (huart->Instance->CR2 >> USART_CR2_ADD_Pos))
+	{
+		sim_usart_irq(huart, USART_ISR_CMF, USART_CR1_CMIE);
+	}
+	if (dma->NDTR == huart->RxXferSize / 2u)
+	{
+		sim_rx_event(huart, HAL_UART_RXEVENT_HT, huart->RxXferSize / 2u);
+	}
+	else if (dma->NDTR == 0u)
+	{
+		/* Circular mode reloads the counter before TC is serviced */
+		dma->NDTR = huart->RxXferSize;
+		sim_rx_event(huart, HAL_UART_RXEVENT_TC, huart->RxXferSize);
+	}
+}
+
+/* DMA request of a byte left in RDR while DMAR was off */
+static void sim_rdr_service(UART_HandleTypeDef *huart)
+{
+	sim_uart_t *sim = sim_get(huart);
+	
+	if (sim->rdr_full && (huart->RxState == HAL_UART_STATE_BUSY_RX) && READ_BIT(huart->Instance->CR3, USART_CR3_DMAR))
+	{
+		sim->rdr_full = 0u;
+		sim_dma_rx(huart, sim->rdr);
+	}
+}
+
+void sim_uart_rx(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t len)
+{
+	sim_uart_t *sim = sim_get(huart);
+	
+	__disable_irq();
+	sim_rdr_service(huart);
+	while (len-- > 0u)
+	{
+		if (sim_dbm_active(huart))
+		{
+			sim_dbm_rx(huart, *data++);
+			continue;
+		}
+		if ((huart->RxState == HAL_UART_STATE_BUSY_RX) && !READ_BIT(huart->Instance->CR3, USART_CR3_DMAR) && !sim->rdr_full)
+		{	/* DMA paused, byte waits in RDR */
+			sim->rdr = *data++;
+			sim->rdr_full = 1u;
+			continue;
+		}
+		if ((huart->RxState != HAL_UART_STATE_BUSY_RX) || !READ_BIT(huart->Instance->CR3, USART_CR3_DMAR))
+		{	/* Receiver not serviced, byte is lost */
+			SET_BIT(huart->Instance->ISR, USART_ISR_ORE);
+			data++;
+			continue;
+		}
+		sim_dma_rx(huart, *data++);
+	}
+	__enable_irq();
+}
+
+int sim_uart_rts(UART_HandleTypeDef *huart)
+{
+	sim_uart_t	*sim = sim_get(huart);
+	int			ready = 1;
+	
+	__disable_irq();
+	if (READ_BIT(huart->Instance->CR3, USART_CR3_RTSE))
+	{
+		sim_rdr_service(huart);
+		ready = !sim->rdr_full;
+	}
+	__enable_irq();
+	return ready;
+}
+
+void sim_uart_idle(UART_HandleTypeDef *huart)
+{
+	uint16_t remaining;
+	
+	__disable_irq();
+	if ((huart->RxState == HAL_UART_STATE_BUSY_RX) && READ_BIT(huart->Instance->CR1, USART_CR1_IDLEIE))
+	{
+		/* HAL only reports IDLE when the DMA buffer is partially filled */
+		remaining = huart->hdmarx->Instance->NDTR;
+		if ((remaining > 0u) && (remaining < huart->RxXferSize))
+		{
+			sim_rx_event(huart, HAL_UART_RXEVENT_IDLE, huart->RxXferSize - remaining);
+		}
+	}
+	else if (sim_dbm_active(huart))
+	{	/* Not a HAL reception, only the IRQ pre-handler sees IDLE */
+		sim_usart_irq(huart, USART_ISR_IDLE, USART_CR1_IDLEIE);
+	}
+	__enable_irq();
+}
+
+void sim_uart_rto(UART_HandleTypeDef *huart)
+{
+	__disable_irq();
+	if (READ_BIT(huart->Instance->CR2, USART_CR2_RTOEN))
+	{
+		sim_usart_irq(huart, USART_ISR_RTOF, USART_CR1_RTOIE);
+	}
+	__enable_irq();
+}
+
+void sim_uart_error(UART_HandleTypeDef *huart, uint32_t error)
+{
+	uint32_t enabled = 0u;
+	
+	__disable_irq();
+	if (READ_BIT(huart->Instance->CR1, USART_CR1_PEIE))
+	{
+		enabled |= HAL_UART_ERROR_PE;
+	}
+	if (READ_BIT(huart->Instance->CR3, USART_CR3_EIE))
+	{
+		enabled |= HAL_UART_ERROR_FE | HAL_UART_ERROR_NE | HAL_UART_ERROR_ORE;
+	}
+	
+	error &= enabled;
+	if ((error != 0u) && (huart->RxState == HAL_UART_STATE_BUSY_RX))
+	{
+		/* DMA reception makes every error blocking, HAL aborts it first */
+		huart->ErrorCode |= error;
+		CLEAR_BIT(huart->Instance->CR1, USART_CR1_PEIE | USART_CR1_IDLEIE);
+		CLEAR_BIT(huart->Instance->CR3, USART_CR3_EIE | USART_CR3_DMAR);
+		huart->RxState = HAL_UART_STATE_READY;
+		huart->ReceptionType = HAL_UART_RECEPTION_STANDARD;
+		if (huart->ErrorCallback != NULL)
+		{
+			huart->ErrorCallback(huart);
+		}
+	}
+	else if ((error != 0u) && sim_dbm_active(huart))
+	{
+		/* Not a HAL reception, HAL_UART_IRQHandler still aborts DMA on DMAR */
+		huart->ErrorCode |= error;
+		CLEAR_BIT(huart->Instance->CR3, USART_CR3_EIE | USART_CR3_DMAR);
+		CLEAR_BIT(huart->hdmarx->Instance->CR, DMA_SxCR_EN);
+		if (huart->ErrorCallback != NULL)
+		{
+			huart->ErrorCallback(huart);
+		}
+	}
+	__enable_irq();
+}
+
+uint16_t sim_uart_tx_process(UART_HandleTypeDef *huart)
+{
+	sim_uart_t	*sim = sim_get(huart);
+	uint16_t	len = 0u;
+	
+	__disable_irq();
+	if (huart->gState == HAL_UART_STATE_BUSY_TX)
+	{
+		len = sim->tx_len;
+		if (sim->tx_hook != NULL)
+		{
+			sim->tx_hook(huart, sim->tx_ptr, len);
+		}
+		sim->tx_len = 0u;
+		huart->hdmatx->Instance->NDTR = 0u;
+		huart->gState = HAL_UART_STATE_READY;
+		if (huart->TxCpltCallback != NULL)
+		{
+			huart->TxCpltCallback(huart);
+		}
+	}
+	__enable_irq();
+	return len;
+}
+
+void sim_uart_set_irq_hook(UART_HandleTypeDef *huart, sim_irq_hook_t hook)
+{
+	sim_get(huart)->irq_hook = hook;
+}
+
+void sim_uart_set_tx_hook(UART_HandleTypeDef *huart, sim_tx_hook_t hook)
+{
+	sim_get(huart)->tx_hook = hook;
+}
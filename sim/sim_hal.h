@@ -0,0 +1,68 @@
+/**
+  ******************************************************************************
+  * @file    sim_hal.h
+  * @brief   Host simulator, line and DMA event injection for the fake UARTs
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 kripac@163.com
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SIM_HAL_H
+#define __SIM_HAL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported types ------------------------------------------------------------*/
+typedef void (*sim_irq_hook_t)(UART_HandleTypeDef *huart);
+typedef void (*sim_tx_hook_t)(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t len);
+
+/* Exported functions prototypes ---------------------------------------------*/
+
+/*
+ * All injection functions run the HAL callbacks in "interrupt" context,
+ * that is with the interrupt lock of sim_os.c held.
+ */
+
+/* Bytes arrive on the line, DMA writes them and raises HT/TC events */
+void sim_uart_rx(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t len);
+
+/* USART RTS level with hardware flow control (RTSE), 1 asserted, sender may go on */
+int sim_uart_rts(UART_HandleTypeDef *huart);
+
+/* Line went idle for one character time */
+void sim_uart_idle(UART_HandleTypeDef *huart);
+
+/* Line stayed idle for RTOR bit times, caller decides when */
+void sim_uart_rto(UART_HandleTypeDef *huart);
+
+/* Receive error, HAL_UART_ERROR_x bits. Aborts DMA reception like the HAL */
+void sim_uart_error(UART_HandleTypeDef *huart, uint32_t error);
+
+/* Finish the pending TX DMA transfer, returns bytes sent */
+uint16_t sim_uart_tx_process(UART_HandleTypeDef *huart);
+
+/* Handler run first on USART interrupts HAL does not service, e.g. CMF */
+void sim_uart_set_irq_hook(UART_HandleTypeDef *huart, sim_irq_hook_t hook);
+
+/* Observe transmitted bytes, both polling and DMA */
+void sim_uart_set_tx_hook(UART_HandleTypeDef *huart, sim_tx_hook_t hook);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SIM_HAL_H */
@@ -0,0 +1,410 @@
+/**
+  ******************************************************************************
+  * @file    sim_os.c
+  * @brief   Host simulator, CMSIS-RTOS2 subset and interrupt model on pthreads
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 kripac@163.com
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <time.h>
+#include "main.h"
+#include "cmsis_os.h"
+
+/* Private types -------------------------------------------------------------*/
+struct sim_sem
+{
+	pthread_mutex_t		lock;
+	pthread_cond_t		cond;
+	uint32_t			count;
+	uint32_t			max;
+	uint32_t			release_ts;		/* sim_timestamp() of last release */
+};
+
+struct sim_flags
+{
+	pthread_mutex_t		lock;
+	pthread_cond_t		cond;
+	uint32_t			flags;
+};
+
+struct sim_thread
+{
+	struct sim_flags	flags;
+};
+
+/* Private variables ---------------------------------------------------------*/
+static pthread_mutex_t		irq_lock;
+static pthread_once_t		irq_once = PTHREAD_ONCE_INIT;
+static __thread uint32_t	irq_depth;
+static __thread struct sim_thread *self;
+static pthread_mutex_t		kernel_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Private functions ---------------------------------------------------------*/
+static void irq_lock_init(void)
+{
+	pthread_mutexattr_t attr;
+	
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&irq_lock, &attr);
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+	
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Absolute deadline for pthread_cond_timedwait, ticks are ms */
+static struct timespec deadline(uint32_t ticks)
+{
+	struct timespec ts;
+	
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	ts.tv_sec += ticks / 1000u;
+	ts.tv_nsec += (long)(ticks % 1000u) * 1000000L;
+	if (ts.tv_nsec >= 1000000000L)
+	{
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000L;
+	}
+	return ts;
+}
+
+static void cond_init(pthread_cond_t *cond)
+{
+	pthread_condattr_t attr;
+	
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(cond, &attr);
+}
+
+static void flags_init(struct sim_flags *f)
+{
+	pthread_mutex_init(&f->lock, NULL);
+	cond_init(&f->cond);
+	f->flags = 0u;
+}
+
+static uint32_t flags_wait(struct sim_flags *f, uint32_t flags, uint32_t options, uint32_t timeout)
+{
+	struct timespec	ts = deadline(timeout);
+	uint32_t		hit;
+	int				rc = 0;
+	
+	pthread_mutex_lock(&f->lock);
+	for (;;)
+	{
+		hit = f->flags & flags;
+		if ((options & osFlagsWaitAll) ? (hit == flags) : (hit != 0u))
+		{
+			if ((options & osFlagsNoClear) == 0u)
+			{
+				f->flags &= ~hit;
+			}
+			break;
+		}
+		if ((timeout == 0u) || (rc == ETIMEDOUT))
+		{
+			hit = osFlagsErrorTimeout;
+			break;
+		}
+		rc = (timeout == osWaitForever) ? pthread_cond_wait(&f->cond, &f->lock)
+										: pthread_cond_timedwait(&f->cond, &f->lock, &ts);
+	}
+	pthread_mutex_unlock(&f->lock);
+	return hit;
+}
+
+static uint32_t flags_set(struct sim_flags *f, uint32_t flags)
+{
+	uint32_t ret;
+	
+	pthread_mutex_lock(&f->lock);
+	f->flags |= flags;
+	ret = f->flags;
+	pthread_cond_broadcast(&f->cond);
+	pthread_mutex_unlock(&f->lock);
+	return ret;
+}
+
+static uint32_t flags_clear(struct sim_flags *f, uint32_t flags)
+{
+	uint32_t ret;
+	
+	pthread_mutex_lock(&f->lock);
+	ret = f->flags;
+	f->flags &= ~flags;
+	pthread_mutex_unlock(&f->lock);
+	return ret;
+}
+
+/* Interrupt model -----------------------------------------------------------*/
+void __disable_irq(void)
+{
+	pthread_once(&irq_once, irq_lock_init);
+	pthread_mutex_lock(&irq_lock);
+	irq_depth++;
+}
+
+void __enable_irq(void)
+{
+	if (irq_depth > 0u)
+	{
+		irq_depth--;
+		pthread_mutex_unlock(&irq_lock);
+	}
+}
+
+uint32_t __get_PRIMASK(void)
+{
+	return (irq_depth > 0u) ? 1u : 0u;
+}
+
+void __set_PRIMASK(uint32_t priMask)
+{
+	/* Restore of a saved PRIMASK, undo the matching __disable_irq() */
+	if (priMask == 0u)
+	{
+		while (irq_depth > 0u)
+		{
+			__enable_irq();
+		}
+	}
+	else if (irq_depth > 1u)
+	{
+		__enable_irq();
+	}
+}
+
+void __DMB(void)
+{
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+void __DSB(void)
+{
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+void __SEV(void)
+{
+}
+
+void __WFE(void)
+{
+	/* Other core runs in another thread, give it the CPU */
+	sched_yield();
+}
+
+uint32_t sim_timestamp(void)
+{
+	return (uint32_t)now_ns();
+}
+
+uint32_t HAL_GetTick(void)
+{
+	return (uint32_t)(now_ns() / 1000000ull);
+}
+
+/* Kernel --------------------------------------------------------------------*/
+uint32_t osKernelGetTickCount(void)
+{
+	return HAL_GetTick();
+}
+
+uint32_t osKernelGetTickFreq(void)
+{
+	return 1000u;
+}
+
+int32_t osKernelLock(void)
+{
+	pthread_mutex_lock(&kernel_lock);
+	return 0;
+}
+
+int32_t osKernelUnlock(void)
+{
+	pthread_mutex_unlock(&kernel_lock);
+	return 0;
+}
+
+osStatus_t osDelay(uint32_t ticks)
+{
+	struct timespec ts = deadline(ticks);
+	
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+	{
+	}
+	return osOK;
+}
+
+/* Semaphore and mutex -------------------------------------------------------*/
+osSemaphoreId_t osSemaphoreNew(uint32_t max_count, uint32_t initial_count, const void *attr)
+{
+	struct sim_sem *sem = calloc(1, sizeof(*sem));
+	
+	(void)attr;
+	pthread_mutex_init(&sem->lock, NULL);
+	cond_init(&sem->cond);
+	sem->count = initial_count;
+	sem->max = max_count;
+	return sem;
+}
+
+osStatus_t osSemaphoreAcquire(osSemaphoreId_t sem, uint32_t timeout)
+{
+	struct timespec	ts = deadline(timeout);
+	osStatus_t		status = osOK;
+	int				rc = 0;
+	
+	if (sem == NULL)
+	{
+		return osErrorParameter;
+	}
+	pthread_mutex_lock(&sem->lock);
+	while (sem->count == 0u)
+	{
+		if ((timeout == 0u) || (rc == ETIMEDOUT))
+		{
+			status = (timeout == 0u) ? osErrorResource : osErrorTimeout;
+			break;
+		}
+		rc = (timeout == osWaitForever) ? pthread_cond_wait(&sem->cond, &sem->lock)
+										: pthread_cond_timedwait(&sem->cond, &sem->lock, &ts);
+	}
+	if (status == osOK)
+	{
+		sem->count--;
+	}
+	pthread_mutex_unlock(&sem->lock);
+	return status;
+}
+
+osStatus_t osSemaphoreRelease(osSemaphoreId_t sem)
+{
+	osStatus_t status = osOK;
+	
+	if (sem == NULL)
+	{
+		return osErrorParameter;
+	}
+	pthread_mutex_lock(&sem->lock);
+	if (sem->count < sem->max)
+	{
+		sem->count++;
+		sem->release_ts = sim_timestamp();
+		pthread_cond_signal(&sem->cond);
+	}
+	else
+	{
+		status = osErrorResource;
+	}
+	pthread_mutex_unlock(&sem->lock);
+	return status;
+}
+
+uint32_t sim_sem_release_time(osSemaphoreId_t sem)
+{
+	uint32_t ts;
+	
+	pthread_mutex_lock(&sem->lock);
+	ts = sem->release_ts;
+	pthread_mutex_unlock(&sem->lock);
+	return ts;
+}
+
+osMutexId_t osMutexNew(const void *attr)
+{
+	return osSemaphoreNew(1u, 1u, attr);
+}
+
+osStatus_t osMutexAcquire(osMutexId_t mutex_id, uint32_t timeout)
+{
+	return osSemaphoreAcquire(mutex_id, timeout);
+}
+
+osStatus_t osMutexRelease(osMutexId_t mutex_id)
+{
+	return osSemaphoreRelease(mutex_id);
+}
+
+/* Thread flags --------------------------------------------------------------*/
+osThreadId_t osThreadGetId(void)
+{
+	if (self == NULL)
+	{
+		self = calloc(1, sizeof(*self));
+		flags_init(&self->flags);
+	}
+	return self;
+}
+
+uint32_t osThreadFlagsSet(osThreadId_t thread_id, uint32_t flags)
+{
+	return (thread_id == NULL) ? osFlagsError : flags_set(&thread_id->flags, flags);
+}
+
+uint32_t osThreadFlagsClear(uint32_t flags)
+{
+	return flags_clear(&osThreadGetId()->flags, flags);
+}
+
+uint32_t osThreadFlagsWait(uint32_t flags, uint32_t options, uint32_t timeout)
+{
+	return flags_wait(&osThreadGetId()->flags, flags, options, timeout);
+}
+
+/* Event flags ---------------------------------------------------------------*/
+osEventFlagsId_t osEventFlagsNew(const void *attr)
+{
+	struct sim_flags *f = calloc(1, sizeof(*f));
+	
+	(void)attr;
+	flags_init(f);
+	return f;
+}
+
+uint32_t osEventFlagsSet(osEventFlagsId_t ef_id, uint32_t flags)
+{
+	return flags_set(ef_id, flags);
+}
+
+uint32_t osEventFlagsClear(osEventFlagsId_t ef_id, uint32_t flags)
+{
+	return flags_clear(ef_id, flags);
+}
+
+uint32_t osEventFlagsGet(osEventFlagsId_t ef_id)
+{
+	uint32_t ret;
+	
+	pthread_mutex_lock(&ef_id->lock);
+	ret = ef_id->flags;
+	pthread_mutex_unlock(&ef_id->lock);
+	return ret;
+}
+
+uint32_t osEventFlagsWait(osEventFlagsId_t ef_id, uint32_t flags, uint32_t options, uint32_t timeout)
+{
+	return flags_wait(ef_id, flags, options, timeout);
+}
@@ -0,0 +1,87 @@
+/**
+  ******************************************************************************
+  * @file    sim_test.h
+  * @brief   Host simulator, checks shared by the functional tests.
+  *          Each test_xxx program exercises one feature of bsp_usart through
+  *          the fake UART1 and exits non zero when a check failed.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 kripac@163.com
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SIM_TEST_H
+#define __SIM_TEST_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include "cmsis_os.h"
+#include "sim_hal.h"
+
+/* Exported variables --------------------------------------------------------*/
+static int sim_test_fail;
+
+/* Exported macro ------------------------------------------------------------*/
+
+/* Report a failed condition and go on */
+#define TEST_CHECK(cond)														\
+	do																			\
+	{																			\
+		if (!(cond))															\
+		{																		\
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);	\
+			sim_test_fail++;													\
+		}																		\
+	} while (0)
+
+/* Equality with both values printed on failure */
+#define TEST_EQ(a, b)															\
+	do																			\
+	{																			\
+		long long va_ = (long long)(a);											\
+		long long vb_ = (long long)(b);											\
+		if (va_ != vb_)															\
+		{																		\
+			printf("%s:%d: %s == %lld, expected %s == %lld\n", __FILE__, __LINE__, #a, va_, #b, vb_); \
+			sim_test_fail++;													\
+		}																		\
+	} while (0)
+
+/* Feature not available in this build, counts as passed */
+#define TEST_SKIP(name)															\
+	(printf("SKIP %s\n", (name)), 0)
+
+/* Exit status of main() */
+#define TEST_DONE(name)															\
+	(printf("%s %s\n", (sim_test_fail == 0) ? "PASS" : "FAIL", (name)), (sim_test_fail == 0) ? 0 : 1)
+
+/* Exported functions --------------------------------------------------------*/
+
+/* Bytes arrive and the line goes idle, whole burst reaches the driver */
+static inline void sim_test_burst(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t len)
+{
+	sim_uart_rx(huart, data, len);
+	sim_uart_idle(huart);
+}
+
+/* 1 when semaphore was released since previous call */
+static inline int sim_test_released(osSemaphoreId_t sem)
+{
+	int released = 0;
+	
+	while (osSemaphoreAcquire(sem, 0u) == osOK)
+	{
+		released = 1;
+	}
+	return released;
+}
+
+#endif /* __SIM_TEST_H */
@@ -0,0 +1,245 @@
+/**
+  ******************************************************************************
+  * @file    stress_ipc.c
+  * @brief   Host stress test of bsp_usart_ipc channels.
+  *          A producer thread stands for the UART core and publishes blocks
+  *          of random length, a consumer thread stands for the other core,
+  *          waits on the channel and checks every byte in place. Reports
+  *          blocks, throughput, drops and corrupted blocks.
+  *
+  *          Usage: stress_ipc [-n max_block] [-c consumer_ns] [-d] [-t duration_ms]
+  *
+  *          Without -d the producer retries a full channel, so nothing may
+  *          be lost. With -d full channel drops the block, as from the RX
+  *          interrupt, and the consumer resynchronizes on sequence numbers.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 kripac@163.com
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "bsp_usart_ipc.h"
+#include "sim_hal.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define STRESS_SEQ_LEN		(4u)		/* Block sequence number ahead of payload */
+
+_Static_assert(sizeof(BSP_IPC_Shared_t) <= SIM_IPC_SHARED_LEN, "shared region too small");
+
+/* Private types -------------------------------------------------------------*/
+typedef struct
+{
+	uint32_t			max_block;
+	uint32_t			consumer_ns;	/* Extra work per block */
+	int					drop;
+	uint32_t			duration_ms;
+} stress_cfg_t;
+
+/* Private variables ---------------------------------------------------------*/
+osSemaphoreId_t			Usart1RxSemHandle;		/* Port of linked driver, unused here */
+static stress_cfg_t		cfg = { 256u, 0u, 0, 2000u };
+static BSP_IPC_Chan_t	*chan;
+static volatile int		producer_done;
+static uint64_t			sent_blocks;
+static uint64_t			sent_bytes;
+static uint64_t			got_blocks;
+static uint64_t			got_bytes;
+static uint64_t			bad_blocks;
+static uint64_t			lost_blocks;
+static uint64_t			retries;			/* Full channel, counted in chan->drop too */
+
+/* Private functions ---------------------------------------------------------*/
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+	
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Payload byte i of block seq, changes with both */
+static uint8_t pattern(uint32_t seq, uint32_t i)
+{
+	return (uint8_t)(seq * 31u + i * 7u + (i >> 8));
+}
+
+void HAL_HSEM_FreeCallback(uint32_t SemMask)
+{
+	BSP_IPC_HSEM_Callback(SemMask);
+}
+
+static void *producer_thread(void *arg)
+{
+	uint8_t		block[BSP_IPC_BLOCK_MAX];
+	uint64_t	end = now_ns() + (uint64_t)cfg.duration_ms * 1000000ull;
+	uint32_t	seq = 0u;
+	uint32_t	len;
+	uint32_t	i;
+	unsigned	rnd = 1u;
+	
+	(void)arg;
+	while (now_ns() < end)
+	{
+		len = STRESS_SEQ_LEN + (uint32_t)rand_r(&rnd) % (cfg.max_block - STRESS_SEQ_LEN + 1u);
+		memcpy(block, &seq, STRESS_SEQ_LEN);
+		for (i = STRESS_SEQ_LEN; i < len; i++)
+		{
+			block[i] = pattern(seq, i);
+		}
+		
+		while (BSP_IPC_Write(chan, block, (uint16_t)len) == 0u)
+		{
+			if (cfg.drop)
+			{
+				break;
+			}
+			retries++;
+			sched_yield();
+		}
+		sent_blocks++;
+		sent_bytes += len;
+		seq++;
+	}
+	producer_done = 1;
+	
+	/* Wake consumer for the last check */
+	HAL_HSEM_FastTake(BSP_IPC_HSEM_ID(0u));
+	HAL_HSEM_Release(BSP_IPC_HSEM_ID(0u), 0u);
+	return NULL;
+}
+
+static void *consumer_thread(void *arg)
+{
+	const uint8_t	*data;
+	uint32_t		expect = 0u;
+	uint32_t		seq;
+	uint32_t		len;
+	uint32_t		i;
+	uint64_t		t;
+	
+	(void)arg;
+	for (;;)
+	{
+		len = BSP_IPC_Peek(chan, &data);
+		if (len == 0u)
+		{
+			if (producer_done && (chan->head == chan->tail))
+			{
+				break;
+			}
+			BSP_IPC_Wait(chan, 10u);
+			continue;
+		}
+		
+		memcpy(&seq, data, STRESS_SEQ_LEN);
+		if (seq != expect)
+		{
+			/* Dropped blocks are fine with -d, going back never is */
+			if (!cfg.drop || ((int32_t)(seq - expect) < 0))
+			{
+				bad_blocks++;
+			}
+			else
+			{
+				lost_blocks += seq - expect;
+			}
+		}
+		for (i = STRESS_SEQ_LEN; i < len; i++)
+		{
+			if (data[i] != pattern(seq, i))
+			{
+				bad_blocks++;
+				break;
+			}
+		}
+		expect = seq + 1u;
+		got_blocks++;
+		got_bytes += len;
+		BSP_IPC_Release(chan);
+		
+		if (cfg.consumer_ns != 0u)
+		{
+			t = now_ns() + cfg.consumer_ns;
+			while (now_ns() < t)
+			{
+			}
+		}
+	}
+	return NULL;
+}
+
+/* Exported functions --------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+	pthread_t	producer;
+	pthread_t	consumer;
+	uint64_t	t0;
+	double		sec;
+	int			opt;
+	
+	while ((opt = getopt(argc, argv, "n:c:dt:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'n': cfg.max_block = strtoul(optarg, NULL, 0); break;
+			case 'c': cfg.consumer_ns = strtoul(optarg, NULL, 0); break;
+			case 'd': cfg.drop = 1; break;
+			case 't': cfg.duration_ms = strtoul(optarg, NULL, 0); break;
+			default:
+				fprintf(stderr, "usage: %s [-n max_block] [-c consumer_ns] [-d] [-t duration_ms]\n", argv[0]);
+				return 1;
+		}
+	}
+	if ((cfg.max_block < STRESS_SEQ_LEN) || (cfg.max_block > BSP_IPC_BLOCK_MAX))
+	{
+		fprintf(stderr, "max_block must be %u ~ %u\n", STRESS_SEQ_LEN, BSP_IPC_BLOCK_MAX);
+		return 1;
+	}
+	
+	chan = BSP_IPC_CHAN(0u);
+	BSP_IPC_Init(chan);
+	if (BSP_IPC_Listen(chan) != HAL_OK)
+	{
+		fprintf(stderr, "listen failed\n");
+		return 1;
+	}
+	
+	t0 = now_ns();
+	pthread_create(&consumer, NULL, consumer_thread, NULL);
+	pthread_create(&producer, NULL, producer_thread, NULL);
+	pthread_join(producer, NULL);
+	pthread_join(consumer, NULL);
+	sec = (double)(now_ns() - t0) / 1e9;
+	
+	printf("channel %u bytes, blocks up to %u, %s\n", BSP_IPC_CHAN_LEN, cfg.max_block, cfg.drop ? "drop when full" : "retry when full");
+	printf("sent     %llu blocks %llu bytes\n", (unsigned long long)sent_blocks, (unsigned long long)sent_bytes);
+	printf("received %llu blocks %llu bytes, %.1f MB/s, %.2f Mblock/s\n", (unsigned long long)got_blocks,
+		   (unsigned long long)got_bytes, (double)got_bytes / sec / 1e6, (double)got_blocks / sec / 1e6);
+	if (cfg.drop)
+	{
+		printf("dropped  %u (channel) %llu (seen)\n", chan->drop, (unsigned long long)lost_blocks);
+	}
+	else
+	{
+		printf("full     %llu retries\n", (unsigned long long)retries);
+	}
+	printf("corrupt  %llu\n", (unsigned long long)bad_blocks);
+	
+	return ((bad_blocks != 0u) || (got_blocks + (cfg.drop ? chan->drop : 0u) != sent_blocks)) ? 1 : 0;
+}
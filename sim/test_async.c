@@ -0,0 +1,139 @@
+/**
+  ******************************************************************************
+  * @file    test_async.c
+  * @brief   Functional test of asynchronous receive on UART1.
+  *          Task mode requests are completed by BSP_USART_AsyncRun() called
+  *          from the test, interrupt mode requests from the RX event. Async
+  *          receive needs ring buffer reception, the test is skipped in
+  *          direct mode.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 kripac@163.com
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "bsp_usart.h"
+#include "usart.h"
+#include "sim_test.h"
+
+/* Private variables ---------------------------------------------------------*/
+osSemaphoreId_t			Usart1RxSemHandle;
+static BSP_USART_Async_t	req_task;
+static BSP_USART_Async_t	req_isr;
+static uint8_t			src[128];
+static uint8_t			buf[64];
+static uint32_t			done;
+static HAL_StatusTypeDef	done_status;
+static uint16_t			done_len;
+
+/* Private functions ---------------------------------------------------------*/
+static void async_cb(BSP_USART_Async_t *req, HAL_StatusTypeDef status, uint16_t len)
+{
+	(void)req;
+	done++;
+	done_status = status;
+	done_len = len;
+}
+
+/* Exact length over two bursts, one request per port */
+static void test_len(void)
+{
+	TEST_EQ(BSP_USART_ReceiveAsync(&usart1_port, &req_task, BSP_USART_ASYNC_LEN, buf, 10u, 1000u), HAL_OK);
+	TEST_EQ(BSP_USART_ReceiveAsync(&usart1_port, &req_isr, BSP_USART_ASYNC_LEN, buf, 10u, 1000u), HAL_BUSY);
+	
+	sim_test_burst(&huart1, src, 5u);
+	TEST_EQ(BSP_USART_AsyncRun(0u), 0u);
+	TEST_EQ(done, 0u);
+	
+	sim_test_burst(&huart1, &src[5], 7u);
+	TEST_EQ(BSP_USART_AsyncRun(0u), 1u);
+	TEST_EQ(done, 1u);
+	TEST_EQ(done_status, HAL_OK);
+	TEST_EQ(done_len, 10u);
+	TEST_CHECK(memcmp(buf, src, 10u) == 0);
+}
+
+/* Interrupt mode, buffered data and a burst completing on idle line */
+static void test_any_isr(void)
+{
+	/* 2 bytes left from the length request, no RX event follows, worker completes it */
+	TEST_EQ(BSP_USART_ReceiveAsync(&usart1_port, &req_isr, BSP_USART_ASYNC_ANY, buf, sizeof(buf), 1000u), HAL_OK);
+	TEST_EQ(BSP_USART_AsyncRun(0u), 1u);
+	TEST_EQ(done, 2u);
+	TEST_EQ(done_len, 2u);
+	TEST_CHECK(memcmp(buf, &src[10], 2u) == 0);
+	
+	TEST_EQ(BSP_USART_ReceiveAsync(&usart1_port, &req_isr, BSP_USART_ASYNC_ANY, buf, sizeof(buf), 1000u), HAL_OK);
+	sim_uart_rx(&huart1, &src[20], 40u);
+	TEST_EQ(done, 2u);
+	sim_uart_idle(&huart1);
+	TEST_EQ(done, 3u);
+	TEST_EQ(done_status, HAL_OK);
+	TEST_EQ(done_len, 40u);
+	TEST_CHECK(memcmp(buf, &src[20], 40u) == 0);
+}
+
+/* Deadline passes with too little data */
+static void test_timeout(void)
+{
+	uint32_t i;
+	
+	TEST_EQ(BSP_USART_ReceiveAsync(&usart1_port, &req_task, BSP_USART_ASYNC_LEN, buf, 10u, 50u), HAL_OK);
+	sim_test_burst(&huart1, src, 3u);
+	for (i = 0u; (i < 20u) && (done == 3u); i++)
+	{
+		BSP_USART_AsyncRun(20u);
+	}
+	TEST_EQ(done, 4u);
+	TEST_EQ(done_status, HAL_TIMEOUT);
+	TEST_EQ(done_len, 0u);
+	
+	/* Data stays buffered for the next request */
+	TEST_EQ(USART1_ReadRB(buf, sizeof(buf)), 3u);
+}
+
+/* Withdrawn request never calls back */
+static void test_cancel(void)
+{
+	TEST_EQ(BSP_USART_ReceiveAsync(&usart1_port, &req_task, BSP_USART_ASYNC_LEN, buf, 10u, 50u), HAL_OK);
+	TEST_EQ(BSP_USART_CancelAsync(&usart1_port, &req_task), 1u);
+	TEST_EQ(BSP_USART_CancelAsync(&usart1_port, &req_task), 0u);
+	sim_test_burst(&huart1, src, 10u);
+	TEST_EQ(BSP_USART_AsyncRun(100u), 0u);
+	TEST_EQ(done, 4u);
+}
+
+/* Exported functions --------------------------------------------------------*/
+int main(void)
+{
+	uint32_t i;
+	
+	for (i = 0u; i < sizeof(src); i++)
+	{
+		src[i] = (uint8_t)(i + 1u);
+	}
+	Usart1RxSemHandle = osSemaphoreNew(1u, 0u, NULL);
+	USART1_Init();
+	if (usart1_port.rx_rb_len == 0u)
+	{
+		return TEST_SKIP("test_async direct");
+	}
+	BSP_USART_AsyncSetup(&req_task, async_cb, NULL, 0u);
+	BSP_USART_AsyncSetup(&req_isr, async_cb, NULL, 1u);
+	
+	test_len();
+	test_any_isr();
+	test_timeout();
+	test_cancel();
+	
+	return TEST_DONE("test_async");
+}
@@ -0,0 +1,221 @@
+/**
+  ******************************************************************************
+  * @file    test_codec.c
+  * @brief   Functional test of bsp_usart_codec decoders.
+  *          SLIP, HDLC and COBS frames with every special byte are encoded
+  *          here, sent in bursts of changing size so frames split across
+  *          decode calls and across the ring buffer wrap, and compared after
+  *          decoding. Frame pool and overlong frames are covered too.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 kripac@163.com
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "bsp_usart_codec.h"
+#include "usart.h"
+#include "sim_test.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define TEST_FRAME_MAX		(600u)
+#define TEST_STREAM_MAX		(8192u)
+
+/* Private variables ---------------------------------------------------------*/
+osSemaphoreId_t			Usart1RxSemHandle;
+
+static const uint16_t	frame_len[] = { 1u, 2u, 7u, 40u, 253u, 254u, 255u, 300u, 3u, 511u };
+static uint8_t			frames[sizeof(frame_len) / sizeof(frame_len[0])][TEST_FRAME_MAX];
+static uint8_t			stream[TEST_STREAM_MAX];
+static uint8_t			out[TEST_FRAME_MAX];
+
+/* Private functions ---------------------------------------------------------*/
+
+/* Payload with runs of ordinary bytes and every special byte of the three schemes */
+static void make_frames(void)
+{
+	static const uint8_t	special[] = { 0xC0u, 0xDBu, 0x7Eu, 0x7Du, 0x00u, 0xDCu, 0xDDu, 0x5Eu, 0x5Du };
+	uint32_t				f;
+	uint32_t				i;
+	
+	for (f = 0u; f < sizeof(frame_len) / sizeof(frame_len[0]); f++)
+	{
+		for (i = 0u; i < frame_len[f]; i++)
+		{
+			frames[f][i] = ((i % 11u) == (f % 11u)) ? special[(i + f) % sizeof(special)] : (uint8_t)(0x30u + i + f);
+		}
+	}
+}
+
+static uint32_t encode_stuffed(uint8_t *p, const uint8_t *s, uint32_t n, uint8_t end, uint8_t esc, int slip)
+{
+	uint32_t len = 0u;
+	uint32_t i;
+	
+	p[len++] = end;
+	for (i = 0u; i < n; i++)
+	{
+		if ((s[i] == end) || (s[i] == esc))
+		{
+			p[len++] = esc;
+			p[len++] = slip ? ((s[i] == end) ? 0xDCu : 0xDDu) : (uint8_t)(s[i] ^ 0x20u);
+		}
+		else
+		{
+			p[len++] = s[i];
+		}
+	}
+	p[len++] = end;
+	return len;
+}
+
+static uint32_t encode_cobs(uint8_t *p, const uint8_t *s, uint32_t n)
+{
+	uint32_t len = 1u;
+	uint32_t code_at = 0u;
+	uint8_t  code = 1u;
+	uint32_t i;
+	
+	for (i = 0u; i < n; i++)
+	{
+		if (s[i] == 0u)
+		{
+			p[code_at] = code;
+			code_at = len++;
+			code = 1u;
+		}
+		else
+		{
+			p[len++] = s[i];
+			if (++code == 0xFFu)
+			{
+				p[code_at] = code;
+				code_at = len++;
+				code = 1u;
+			}
+		}
+	}
+	p[code_at] = code;
+	p[len++] = 0u;
+	return len;
+}
+
+static uint32_t encode(BSP_Codec_Type_t type, uint8_t *p, const uint8_t *s, uint32_t n)
+{
+	switch (type)
+	{
+		case BSP_CODEC_SLIP:	return encode_stuffed(p, s, n, 0xC0u, 0xDBu, 1);
+		case BSP_CODEC_HDLC:	return encode_stuffed(p, s, n, 0x7Eu, 0x7Du, 0);
+		default:				return encode_cobs(p, s, n);
+	}
+}
+
+/* Send stream in bursts of 1 ~ 29 bytes, fits direct mode buffer too, decode after each */
+static void run_stream(BSP_Codec_t *dec, uint32_t len, const uint8_t *order, uint32_t frame_num)
+{
+	static const char	*name[] = { "slip", "hdlc", "cobs" };
+	uint32_t			sent = 0u;
+	uint32_t			chunk = 1u;
+	uint32_t			next = 0u;
+	uint16_t			n;
+	uint8_t				*frame;
+	
+	while (sent < len)
+	{
+		n = (uint16_t)(((len - sent) < chunk) ? (len - sent) : chunk);
+		sim_test_burst(&huart1, &stream[sent], n);
+		sent += n;
+		chunk = (chunk % 29u) + 1u;
+		
+		while ((n = BSP_Codec_Decode(dec, &usart1_port, &frame)) != 0u)
+		{
+			if (next >= frame_num)
+			{
+				printf("%s: extra frame of %u bytes\n", name[dec->type], n);
+				sim_test_fail++;
+				continue;
+			}
+			if ((n != frame_len[order[next]]) || (memcmp(frame, frames[order[next]], n) != 0))
+			{
+				printf("%s: frame %u bad, %u bytes\n", name[dec->type], next, n);
+				sim_test_fail++;
+			}
+			if (dec->pool != NULL)
+			{
+				BSP_Codec_PoolPut(dec->pool, frame);
+			}
+			next++;
+		}
+	}
+	TEST_EQ(next, frame_num);
+}
+
+static void test_type(BSP_Codec_Type_t type)
+{
+	BSP_Codec_t			dec;
+	uint8_t				order[sizeof(frame_len) / sizeof(frame_len[0])];
+	uint32_t			frame_num = sizeof(frame_len) / sizeof(frame_len[0]);
+	uint32_t			len = 0u;
+	uint32_t			f;
+	
+	for (f = 0u; f < frame_num; f++)
+	{
+		order[f] = (uint8_t)f;
+		len += encode(type, &stream[len], frames[f], frame_len[f]);
+	}
+	
+	BSP_Codec_Init(&dec, type, out, sizeof(out));
+	run_stream(&dec, len, order, frame_num);
+	TEST_EQ(dec.frames, frame_num);
+	TEST_EQ(dec.errors, 0u);
+}
+
+/* Pool buffers are handed out per frame, overlong frame is dropped and counted */
+static void test_pool(void)
+{
+	static const uint8_t	order[] = { 3u, 0u };
+	static uint8_t			mem[2u * TEST_FRAME_MAX];
+	BSP_Codec_Pool_t		pool;
+	BSP_Codec_t				dec;
+	uint32_t				len;
+	
+	BSP_Codec_PoolInit(&pool, mem, TEST_FRAME_MAX, 2u);
+	BSP_Codec_InitPool(&dec, BSP_CODEC_COBS, &pool);
+	len = encode(BSP_CODEC_COBS, stream, frames[3], frame_len[3]);
+	len += encode(BSP_CODEC_COBS, &stream[len], frames[0], frame_len[0]);
+	run_stream(&dec, len, order, 2u);
+	TEST_EQ(dec.errors, 0u);
+	
+	/* Frames went back to pool, decoder holds the one for next frame */
+	TEST_EQ(pool.used, 1u);
+	
+	/* Small output buffer, 40 byte frame does not fit */
+	BSP_Codec_Init(&dec, BSP_CODEC_SLIP, out, 16u);
+	len = encode(BSP_CODEC_SLIP, stream, frames[3], frame_len[3]);
+	len += encode(BSP_CODEC_SLIP, &stream[len], frames[0], frame_len[0]);
+	run_stream(&dec, len, &order[1], 1u);
+	TEST_EQ(dec.errors, 1u);
+}
+
+/* Exported functions --------------------------------------------------------*/
+int main(void)
+{
+	Usart1RxSemHandle = osSemaphoreNew(1u, 0u, NULL);
+	USART1_Init();
+	make_frames();
+	
+	test_type(BSP_CODEC_SLIP);
+	test_type(BSP_CODEC_HDLC);
+	test_type(BSP_CODEC_COBS);
+	test_pool();
+	
+	return TEST_DONE("test_codec");
+}
@@ -0,0 +1,174 @@
+/**
+  ******************************************************************************
+  * @file    test_coro.cpp
+  * @brief   Functional test of the C++20 coroutine front end on UART1.
+  *          Protocol handlers co_await port reads and are resumed by
+  *          BSP_USART_AsyncRun() called from the test thread. Covers length,
+  *          frame and timeout completion, a read refused at once while
+  *          another handler has a request pending, and that handler frames
+  *          are gone when they return. Async receive needs ring buffer
+  *          reception, the test is skipped in direct mode.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 kripac@163.com
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "bsp_usart_coro.hpp"
+#include "usart.h"
+#include "sim_test.h"
+
+/* Private types -------------------------------------------------------------*/
+
+/* Lives in a handler frame, counts frames not yet destroyed */
+struct FrameAlive
+{
+	static inline uint32_t	count = 0u;
+	FrameAlive()			{ count++; }
+	~FrameAlive()			{ count--; }
+};
+
+/* Private variables ---------------------------------------------------------*/
+extern "C" { osSemaphoreId_t Usart1RxSemHandle; }
+static uint8_t			src[64];
+static uint8_t			len_buf[16];
+static bsp::UsartResult	len_res[2];
+static uint32_t			len_step;
+static bsp::UsartResult	busy_res;
+static bsp::UsartResult	error_res;
+static uint8_t			frame_buf[2][16];
+static bsp::UsartResult	frame_res[2];
+static uint32_t			frame_step;
+
+/* Private functions ---------------------------------------------------------*/
+
+/* Exact length, then a read nobody sends data for */
+static bsp::UsartTask len_handler(void)
+{
+	FrameAlive alive;
+
+	len_res[0] = co_await bsp::UsartRead(&usart1_port, BSP_USART_ASYNC_LEN, len_buf, 10u, 1000u);
+	len_step++;
+	len_res[1] = co_await bsp::UsartRead(&usart1_port, BSP_USART_ASYNC_LEN, len_buf, 10u, 50u);
+	len_step++;
+}
+
+/* Port is taken by len_handler and a zero size is invalid, await_suspend() refuses both and the handler goes on at once */
+static bsp::UsartTask busy_handler(void)
+{
+	FrameAlive	alive;
+	uint8_t		buf[4];
+
+	busy_res = co_await bsp::UsartRead(&usart1_port, BSP_USART_ASYNC_LEN, buf, sizeof(buf), 1000u);
+	error_res = co_await bsp::UsartRead(&usart1_port, BSP_USART_ASYNC_LEN, buf, 0u, 1000u);
+}
+
+/* Two character match frames */
+static bsp::UsartTask frame_handler(void)
+{
+	FrameAlive alive;
+
+	for (frame_step = 0u; frame_step < 2u; frame_step++)
+	{
+		frame_res[frame_step] = co_await bsp::UsartRead(&usart1_port, BSP_USART_ASYNC_FRAME, frame_buf[frame_step],
+														sizeof(frame_buf[0]), HAL_MAX_DELAY);
+	}
+}
+
+/* Run worker rounds until done() or about a second passed */
+template <typename Done>
+static void run_until(Done done)
+{
+	uint32_t i;
+
+	for (i = 0u; (i < 50u) && !done(); i++)
+	{
+		BSP_USART_AsyncRun(20u);
+	}
+}
+
+static void test_len(void)
+{
+	len_handler();
+	TEST_EQ(FrameAlive::count, 1u);
+
+	busy_handler();
+	TEST_EQ(busy_res.status, HAL_BUSY);
+	TEST_EQ(busy_res.len, 0u);
+	TEST_EQ(error_res.status, HAL_ERROR);
+	TEST_EQ(error_res.len, 0u);
+	TEST_EQ(FrameAlive::count, 1u);
+
+	sim_test_burst(&huart1, src, 4u);
+	TEST_EQ(BSP_USART_AsyncRun(0u), 0u);
+	TEST_EQ(len_step, 0u);
+
+	/* Completion resumes the handler, which submits its next read */
+	sim_test_burst(&huart1, &src[4], 6u);
+	TEST_EQ(BSP_USART_AsyncRun(0u), 1u);
+	TEST_EQ(len_step, 1u);
+	TEST_EQ(len_res[0].status, HAL_OK);
+	TEST_EQ(len_res[0].len, 10u);
+	TEST_CHECK(memcmp(len_buf, src, 10u) == 0);
+
+	run_until([] { return len_step == 2u; });
+	TEST_EQ(len_step, 2u);
+	TEST_EQ(len_res[1].status, HAL_TIMEOUT);
+	TEST_EQ(len_res[1].len, 0u);
+	TEST_EQ(FrameAlive::count, 0u);
+}
+
+static void test_frame(void)
+{
+	static const char text[] = "first\nsecond\n";
+
+	BSP_USART_SetFrameChar(&usart1_port, '\n');
+	BSP_USART_Init(&usart1_port);
+
+	frame_handler();
+	sim_uart_rx(&huart1, (const uint8_t *)text, 4u);
+	TEST_EQ(BSP_USART_AsyncRun(0u), 0u);
+	sim_uart_rx(&huart1, (const uint8_t *)&text[4], sizeof(text) - 1u - 4u);
+	run_until([] { return frame_step == 2u; });
+
+	TEST_EQ(frame_step, 2u);
+	TEST_EQ(frame_res[0].status, HAL_OK);
+	TEST_EQ(frame_res[0].len, 6u);
+	TEST_CHECK(memcmp(frame_buf[0], "first\n", 6u) == 0);
+	TEST_EQ(frame_res[1].status, HAL_OK);
+	TEST_EQ(frame_res[1].len, 7u);
+	TEST_CHECK(memcmp(frame_buf[1], "second\n", 7u) == 0);
+	TEST_EQ(FrameAlive::count, 0u);
+}
+
+/* Exported functions --------------------------------------------------------*/
+int main(void)
+{
+	uint32_t i;
+
+	for (i = 0u; i < sizeof(src); i++)
+	{
+		src[i] = (uint8_t)(i * 13u + 5u);
+	}
+	Usart1RxSemHandle = osSemaphoreNew(1u, 0u, NULL);
+	sim_uart_set_irq_hook(&huart1, BSP_USART_IRQHandler);
+	USART1_Init();
+	if (usart1_port.rx_rb_len == 0u)
+	{
+		return TEST_SKIP("test_coro direct");
+	}
+
+	test_len();
+	test_frame();
+
+	return TEST_DONE("test_coro");
+}
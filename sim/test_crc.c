@@ -0,0 +1,90 @@
+/**
+  ******************************************************************************
+  * @file    test_crc.c
+  * @brief   Functional test of bsp_usart_crc.
+  *          Check values of both CRC types, and slicing kernel against a
+  *          bitwise reference over every length, alignment and split point
+  *          of a running CRC. Built again as test_crc_s8 with
+  *          BSP_CRC_SLICES=8 for the slicing-by-8 tables.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 kripac@163.com
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "bsp_usart_crc.h"
+#include "cmsis_os.h"
+#include "sim_test.h"
+
+/* Private variables ---------------------------------------------------------*/
+osSemaphoreId_t			Usart1RxSemHandle;		/* Port of linked driver, unused here */
+static uint8_t			data[80];
+
+/* Private functions ---------------------------------------------------------*/
+static uint32_t crc_bitwise(BSP_CRC_Type_t type, const uint8_t *p, size_t len)
+{
+	uint32_t	poly = (type == BSP_CRC16_MODBUS) ? 0xA001u : 0xEDB88320u;
+	uint32_t	crc = (type == BSP_CRC16_MODBUS) ? 0xFFFFu : 0xFFFFFFFFu;
+	uint32_t	k;
+	
+	while (len-- > 0u)
+	{
+		crc ^= *p++;
+		for (k = 0u; k < 8u; k++)
+		{
+			crc = (crc & 1u) ? ((crc >> 1) ^ poly) : (crc >> 1);
+		}
+	}
+	return (type == BSP_CRC32) ? (crc ^ 0xFFFFFFFFu) : crc;
+}
+
+static void test_type(BSP_CRC_Type_t type)
+{
+	uint32_t	off;
+	uint32_t	len;
+	uint32_t	cut;
+	uint32_t	ref;
+	uint32_t	crc;
+	
+	for (off = 0u; off < 8u; off++)
+	{
+		for (len = 0u; len <= sizeof(data) - off; len++)
+		{
+			ref = crc_bitwise(type, &data[off], len);
+			TEST_EQ(BSP_CRC_Calc(type, &data[off], len), ref);
+			for (cut = 1u; cut < len; cut += 5u)
+			{
+				crc = BSP_CRC_Update(type, BSP_CRC_Start(type), &data[off], cut);
+				crc = BSP_CRC_Update(type, crc, &data[off + cut], len - cut);
+				TEST_EQ(BSP_CRC_Final(type, crc), ref);
+			}
+		}
+	}
+}
+
+/* Exported functions --------------------------------------------------------*/
+int main(void)
+{
+	uint32_t i;
+	
+	BSP_CRC_Init();
+	for (i = 0u; i < sizeof(data); i++)
+	{
+		data[i] = (uint8_t)(i * 89u + 17u);
+	}
+	
+	TEST_EQ(BSP_CRC_Calc(BSP_CRC16_MODBUS, (const uint8_t *)"123456789", 9u), 0x4B37u);
+	TEST_EQ(BSP_CRC_Calc(BSP_CRC32, (const uint8_t *)"123456789", 9u), 0xCBF43926u);
+	test_type(BSP_CRC16_MODBUS);
+	test_type(BSP_CRC32);
+	
+	return TEST_DONE((BSP_CRC_SLICES == 8u) ? "test_crc slices 8" : "test_crc");
+}
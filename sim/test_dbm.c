@@ -0,0 +1,117 @@
+/**
+  ******************************************************************************
+  * @file    test_dbm.c
+  * @brief   Functional test of double buffer DMA reception on UART1.
+  *          Blocks handed over on buffer switch and idle line come out in
+  *          order, unread buffers overwritten by DMA are counted as dropped
+  *          and reported stale on release.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 kripac@163.com
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "bsp_usart.h"
+#include "usart.h"
+#include "sim_test.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define TEST_DBM_LEN		(64u)
+
+/* Private variables ---------------------------------------------------------*/
+osSemaphoreId_t			Usart1RxSemHandle;
+static uint8_t			dbm0[TEST_DBM_LEN] USART_DMA_MEM;
+static uint8_t			dbm1[TEST_DBM_LEN] USART_DMA_MEM;
+static uint8_t			src[1024];
+static uint8_t			got[1024];
+static uint32_t			got_len;
+static uint32_t			stale;
+
+/* Private functions ---------------------------------------------------------*/
+static void drain(void)
+{
+	const uint8_t	*data;
+	uint16_t		n;
+	
+	while ((n = BSP_USART_DbmAcquire(&usart1_port, &data)) != 0u)
+	{
+		memcpy(&got[got_len], data, n);
+		got_len += n;
+		if (BSP_USART_DbmRelease(&usart1_port) == 0u)
+		{
+			stale++;
+		}
+	}
+}
+
+/* Bursts ending on idle line, in the middle of a buffer and on a switch */
+static void test_stream(void)
+{
+	sim_test_burst(&huart1, src, 10u);
+	TEST_CHECK(sim_test_released(Usart1RxSemHandle));
+	drain();
+	sim_test_burst(&huart1, &src[10], 100u);
+	drain();
+	sim_uart_rx(&huart1, &src[110], 54u);
+	drain();
+	sim_test_burst(&huart1, &src[164], 36u);
+	drain();
+	
+	TEST_EQ(got_len, 200u);
+	TEST_CHECK(memcmp(got, src, got_len) == 0);
+	TEST_EQ(stale, 0u);
+	TEST_EQ(usart1_port.stats.rx_drop, 0u);
+}
+
+/* Nothing read while DMA fills both buffers more than once */
+static void test_overrun(void)
+{
+	uint32_t drop = usart1_port.stats.rx_drop;
+	uint32_t bytes = usart1_port.stats.rx_bytes;
+	
+	got_len = 0u;
+	sim_test_burst(&huart1, src, 300u);
+	drain();
+	TEST_EQ(usart1_port.stats.rx_bytes - bytes, 300u);
+	TEST_CHECK(usart1_port.stats.rx_drop > drop);
+	TEST_EQ(got_len + (usart1_port.stats.rx_drop - drop), 300u);
+	
+	/* What is handed over is the newest data, in order */
+	TEST_CHECK(memcmp(got, &src[300u - got_len], got_len) == 0);
+	
+	/* Back in step afterwards */
+	got_len = 0u;
+	sim_test_burst(&huart1, &src[400], 20u);
+	drain();
+	TEST_EQ(got_len, 20u);
+	TEST_CHECK(memcmp(got, &src[400], 20u) == 0);
+}
+
+/* Exported functions --------------------------------------------------------*/
+int main(void)
+{
+	uint32_t i;
+	
+	for (i = 0u; i < sizeof(src); i++)
+	{
+		src[i] = (uint8_t)(i * 7u + 1u);
+	}
+	Usart1RxSemHandle = osSemaphoreNew(1u, 0u, NULL);
+	BSP_USART_SetDoubleBuffer(&usart1_port, dbm0, dbm1, TEST_DBM_LEN);
+	sim_uart_set_irq_hook(&huart1, BSP_USART_IRQHandler);
+	USART1_Init();
+	
+	test_stream();
+	test_overrun();
+	
+	return TEST_DONE("test_dbm");
+}
@@ -0,0 +1,153 @@
+/**
+  ******************************************************************************
+  * @file    test_err.c
+  * @brief   Functional test of receive error recovery on UART1.
+  *          DMA restarts at buffer start after an error. Ring buffer mode
+  *          keeps what was received, direct mode drops unread bytes and its
+  *          ring buffer indexes restart with DMA. Built for both modes by
+  *          make test.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 kripac@163.com
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "bsp_usart.h"
+#include "usart.h"
+#include "sim_test.h"
+
+/* Private variables ---------------------------------------------------------*/
+osSemaphoreId_t			Usart1RxSemHandle;
+static uint8_t			src[256];
+static uint8_t			buf[256];
+
+/* Private functions ---------------------------------------------------------*/
+
+/* Data read before the error, new data after it comes out right */
+static void test_read_before(void)
+{
+	BSP_USART_Stats_t stats;
+	
+	BSP_USART_Reset(&usart1_port);
+	BSP_USART_ResetStats(&usart1_port);
+	sim_test_burst(&huart1, src, 10u);
+	TEST_EQ(BSP_USART_ReadRB(&usart1_port, buf, sizeof(buf)), 10u);
+	
+	sim_uart_error(&huart1, HAL_UART_ERROR_FE);
+	sim_test_burst(&huart1, &src[20], 5u);
+	TEST_EQ(BSP_USART_ReadRB(&usart1_port, buf, sizeof(buf)), 5u);
+	TEST_CHECK(memcmp(buf, &src[20], 5u) == 0);
+	
+	BSP_USART_GetStats(&usart1_port, &stats);
+	TEST_EQ(stats.err_cnt, 1u);
+	TEST_EQ(stats.err_fe, 1u);
+	TEST_EQ(stats.err_drop, 1u);
+}
+
+/* Data still unread at the error, kept in ring buffer mode, dropped and counted in direct mode */
+static void test_unread(void)
+{
+	BSP_USART_Stats_t	stats;
+	uint16_t			n;
+	
+	BSP_USART_Reset(&usart1_port);
+	BSP_USART_ResetStats(&usart1_port);
+	sim_test_burst(&huart1, src, 12u);
+	sim_uart_rx(&huart1, &src[12], 3u);
+	sim_uart_error(&huart1, HAL_UART_ERROR_NE);
+	sim_test_burst(&huart1, &src[40], 7u);
+	
+	n = BSP_USART_ReadRB(&usart1_port, buf, sizeof(buf));
+	BSP_USART_GetStats(&usart1_port, &stats);
+	if (usart1_port.rx_rb_len != 0u)
+	{
+		TEST_EQ(n, 22u);
+		TEST_CHECK(memcmp(buf, src, 15u) == 0);
+		TEST_CHECK(memcmp(&buf[15], &src[40], 7u) == 0);
+		TEST_EQ(stats.err_drop, 1u);
+	}
+	else
+	{
+		TEST_EQ(n, 7u);
+		TEST_CHECK(memcmp(buf, &src[40], 7u) == 0);
+		TEST_EQ(stats.err_drop, 1u + 15u);
+	}
+	TEST_EQ(stats.err_ne, 1u);
+}
+
+/* Errors at changing DMA positions, each burst read back whole */
+static void test_many(void)
+{
+	uint32_t	bad = 0u;
+	uint32_t	k;
+	uint16_t	len;
+	uint16_t	n;
+	
+	BSP_USART_Reset(&usart1_port);
+	for (k = 0u; k < 40u; k++)
+	{
+		len = (uint16_t)(1u + (k * 7u) % 29u);
+		sim_test_burst(&huart1, &src[k], len);
+		n = BSP_USART_ReadRB(&usart1_port, buf, sizeof(buf));
+		if ((n != len) || (memcmp(buf, &src[k], len) != 0))
+		{
+			bad++;
+		}
+		if ((k % 3u) == 0u)
+		{
+			sim_uart_error(&huart1, HAL_UART_ERROR_FE);
+		}
+	}
+	TEST_EQ(bad, 0u);
+}
+
+/* Direct mode, error between peek and skip tears peeked data */
+static void test_peek(void)
+{
+	BSP_USART_Block_t blk[2];
+	
+	if (usart1_port.rx_rb_len != 0u)
+	{
+		return;
+	}
+	BSP_USART_Reset(&usart1_port);
+	sim_test_burst(&huart1, src, 8u);
+	TEST_CHECK(BSP_USART_Peek(&usart1_port, blk) != 0u);
+	sim_uart_error(&huart1, HAL_UART_ERROR_FE);
+	TEST_EQ(BSP_USART_Skip(&usart1_port, blk[0].len), 0u);
+	
+	sim_test_burst(&huart1, &src[50], 4u);
+	TEST_EQ(BSP_USART_Peek(&usart1_port, blk), 1u);
+	TEST_EQ(blk[0].len, 4u);
+	TEST_CHECK(memcmp(blk[0].ptr, &src[50], 4u) == 0);
+	TEST_EQ(BSP_USART_Skip(&usart1_port, 4u), 4u);
+}
+
+/* Exported functions --------------------------------------------------------*/
+int main(void)
+{
+	uint32_t i;
+	
+	for (i = 0u; i < sizeof(src); i++)
+	{
+		src[i] = (uint8_t)(i * 7u + 1u);
+	}
+	Usart1RxSemHandle = osSemaphoreNew(1u, 0u, NULL);
+	USART1_Init();
+	
+	test_read_before();
+	test_unread();
+	test_many();
+	test_peek();
+	
+	return TEST_DONE((usart1_port.rx_rb_len != 0u) ? "test_err" : "test_err direct");
+}
@@ -0,0 +1,116 @@
+/**
+  ******************************************************************************
+  * @file    test_frame.c
+  * @brief   Functional test of hardware framing on UART1.
+  *          Character match frames split at a delimiter, also across the DMA
+  *          buffer wrap, then Modbus RTU frames ended by receiver timeout
+  *          with CRC check.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 kripac@163.com
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "bsp_usart.h"
+#include "usart.h"
+#include "sim_test.h"
+
+/* Private variables ---------------------------------------------------------*/
+osSemaphoreId_t			Usart1RxSemHandle;
+static uint8_t			buf[64];
+
+/* Private functions ---------------------------------------------------------*/
+static void send(const char *s)
+{
+	sim_uart_rx(&huart1, (const uint8_t *)s, (uint16_t)strlen(s));
+}
+
+static void check_frame(const char *s)
+{
+	uint16_t n = BSP_USART_ReadFrame(&usart1_port, buf, sizeof(buf));
+	
+	TEST_EQ(n, strlen(s));
+	TEST_CHECK(memcmp(buf, s, n) == 0);
+}
+
+/* Frames end at '\n' without idle line, delimiter included */
+static void test_char_match(void)
+{
+	BSP_USART_Block_t	blk[2];
+	uint16_t			n;
+	
+	BSP_USART_SetFrameChar(&usart1_port, '\n');
+	USART1_Init();
+	
+	send("hello\nframe two\n");
+	TEST_CHECK(sim_test_released(Usart1RxSemHandle));
+	check_frame("hello\n");
+	
+	/* In place, second block when it crosses the wrap */
+	n = BSP_USART_PeekFrame(&usart1_port, blk);
+	TEST_EQ(n, 10u);
+	TEST_CHECK(memcmp(blk[0].ptr, "frame two\n", blk[0].len) == 0);
+	BSP_USART_SkipFrame(&usart1_port);
+	
+	send("wrap around 0123\n");
+	check_frame("wrap around 0123\n");
+	
+	/* Incomplete frame waits for its delimiter */
+	send("ab");
+	TEST_EQ(BSP_USART_ReadFrame(&usart1_port, buf, sizeof(buf)), 0u);
+	send("c\n");
+	check_frame("abc\n");
+	TEST_EQ(usart1_port.stats.evt_match, 4u);
+}
+
+/* Receiver timeout ends Modbus RTU frames, bad CRC is dropped */
+static void test_rto(void)
+{
+	static const uint8_t	good[] = { 0x01u, 0x03u, 0x00u, 0x00u, 0x00u, 0x0Au, 0xC5u, 0xCDu };
+	static const uint8_t	bad[] = { 0x01u, 0x03u, 0x00u, 0x00u, 0x00u, 0x0Au, 0xC5u, 0xCEu };
+	uint32_t				frames = 0u;
+	uint32_t				k;
+	uint16_t				n;
+	
+	BSP_USART_SetModbusRTU(&usart1_port);
+	BSP_USART_Init(&usart1_port);
+	BSP_USART_ResetStats(&usart1_port);
+	TEST_CHECK(huart1.Instance->RTOR != 0u);
+	
+	for (k = 0u; k < 10u; k++)
+	{
+		sim_test_burst(&huart1, ((k % 3u) == 1u) ? bad : good, 8u);
+		TEST_EQ(BSP_USART_ReadFrame(&usart1_port, buf, sizeof(buf)), 0u);
+		sim_uart_rto(&huart1);
+		while ((n = BSP_USART_ReadFrame(&usart1_port, buf, sizeof(buf))) != 0u)
+		{
+			TEST_EQ(n, sizeof(good));
+			TEST_CHECK(memcmp(buf, good, sizeof(good)) == 0);
+			frames++;
+		}
+	}
+	TEST_EQ(frames, 7u);
+	TEST_EQ(usart1_port.stats.frame_crc_err, 3u);
+	TEST_EQ(usart1_port.stats.evt_rto, 10u);
+}
+
+/* Exported functions --------------------------------------------------------*/
+int main(void)
+{
+	Usart1RxSemHandle = osSemaphoreNew(1u, 0u, NULL);
+	sim_uart_set_irq_hook(&huart1, BSP_USART_IRQHandler);
+	
+	test_char_match();
+	test_rto();
+	
+	return TEST_DONE((usart1_port.rx_rb_len != 0u) ? "test_frame" : "test_frame direct");
+}
@@ -0,0 +1,186 @@
+/**
+  ******************************************************************************
+  * @file    test_ovr.c
+  * @brief   Functional test of direct mode reads hit by a DMA overrun.
+  *          lwrb_peek() is wrapped at link time so the RX interrupt of an
+  *          overrunning burst lands between the copy of a read and the move
+  *          of the read index. Reads must drop the torn copy and return the
+  *          newest data, never undo the skip of the interrupt. Ring buffer
+  *          reception has no such race, the test is skipped there.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 kripac@163.com
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "bsp_usart.h"
+#include "usart.h"
+#include "sim_test.h"
+
+/* Private variables ---------------------------------------------------------*/
+osSemaphoreId_t			Usart1RxSemHandle;
+static uint8_t			buf[1024];
+static uint8_t			stream[1024];
+static uint32_t			sent;
+static const uint8_t	*inject_data;		/* Burst to receive inside next peek */
+static uint16_t			inject_len;
+static uint32_t			injected;
+
+/* Private functions ---------------------------------------------------------*/
+size_t __real_lwrb_peek(const lwrb_t *buff, size_t skip_count, void *data, size_t btp);
+
+/* Copy is done, RX interrupt of the armed burst runs before the read index moves */
+size_t __wrap_lwrb_peek(const lwrb_t *buff, size_t skip_count, void *data, size_t btp)
+{
+	size_t		n = __real_lwrb_peek(buff, skip_count, data, btp);
+	uint16_t	len = inject_len;
+	
+	if (len != 0u)
+	{
+		inject_len = 0u;
+		injected++;
+		sim_test_burst(&huart1, inject_data, len);
+	}
+	return n;
+}
+
+/* Next len stream bytes, stream byte n carries n */
+static const uint8_t *next(uint16_t len)
+{
+	uint16_t i;
+	
+	for (i = 0u; i < len; i++)
+	{
+		stream[i] = (uint8_t)(sent + i);
+	}
+	sent += len;
+	return stream;
+}
+
+/* Receive a stream burst, inject one more longer than the DMA buffer on next read */
+static void arm(uint16_t len)
+{
+	sim_test_burst(&huart1, next(len), len);
+	inject_len = 2u * usart1_port.rx_dma_len;
+	inject_data = next(inject_len);
+}
+
+/* 1 when data is stream bytes first ~ first + len - 1 */
+static int is_stream(const uint8_t *data, uint16_t len, uint32_t first)
+{
+	uint16_t i;
+	
+	for (i = 0u; i < len; i++)
+	{
+		if (data[i] != (uint8_t)(first + i))
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static void test_read_rb(void)
+{
+	uint32_t	capacity = usart1_port.rx_rb.size - 1u;
+	uint32_t	drop = usart1_port.stats.rx_drop;
+	
+	arm(10u);
+	TEST_EQ(BSP_USART_ReadRB(&usart1_port, buf, sizeof(buf)), capacity);
+	TEST_EQ(injected, 1u);
+	TEST_CHECK(usart1_port.stats.rx_drop > drop);
+	TEST_CHECK(is_stream(buf, capacity, sent - capacity));
+	
+	/* Read index of the interrupt stays, nothing old comes back */
+	TEST_EQ(BSP_USART_ReadRB(&usart1_port, buf, sizeof(buf)), 0u);
+}
+
+static void test_receive(void)
+{
+	uint32_t capacity = usart1_port.rx_rb.size - 1u;
+	
+	arm(12u);
+	TEST_EQ(BSP_USART_Receive(&usart1_port, buf, 12u, 100u), HAL_OK);
+	TEST_EQ(injected, 2u);
+	TEST_CHECK(is_stream(buf, 12u, sent - capacity));
+	TEST_EQ(BSP_USART_ReadRB(&usart1_port, buf, sizeof(buf)), capacity - 12u);
+	TEST_CHECK(is_stream(buf, capacity - 12u, sent - capacity + 12u));
+}
+
+static void test_read_ts(void)
+{
+	uint32_t	capacity = usart1_port.rx_rb.size - 1u;
+	uint32_t	t_first;
+	uint32_t	t_last;
+	
+	arm(7u);
+	TEST_EQ(BSP_USART_ReadRBTs(&usart1_port, buf, sizeof(buf), &t_first, &t_last), capacity);
+	TEST_EQ(injected, 3u);
+	TEST_CHECK(is_stream(buf, capacity, sent - capacity));
+	TEST_CHECK((int32_t)(t_last - t_first) >= 0);
+}
+
+/* Character match frames, a frame read across the overrun must come out whole */
+static void test_read_frame(void)
+{
+	uint32_t	capacity = usart1_port.rx_dma_len - 1u;
+	uint16_t	len = (uint16_t)(capacity / 7u + 2u);	/* 7 frames fit the queue and overrun the buffer */
+	uint32_t	drop;
+	uint16_t	n;
+	uint16_t	k;
+	char		last = 0;
+	
+	BSP_USART_SetFrameChar(&usart1_port, '\n');
+	BSP_USART_Init(&usart1_port);
+	drop = usart1_port.stats.frame_drop;
+	
+	/* Frame k is k, filler and delimiter */
+	memset(stream, 'x', 7u * len);
+	for (k = 0u; k < 7u; k++)
+	{
+		stream[k * len] = (uint8_t)('0' + k);
+		stream[k * len + len - 1u] = '\n';
+	}
+	sim_test_burst(&huart1, (const uint8_t *)"old\n", 4u);
+	inject_data = stream;
+	inject_len = 7u * len;
+	while ((n = BSP_USART_ReadFrame(&usart1_port, buf, sizeof(buf))) != 0u)
+	{
+		TEST_EQ(n, len);
+		TEST_CHECK((char)buf[0] > last);
+		TEST_EQ(buf[1], 'x');
+		TEST_EQ(buf[len - 1u], '\n');
+		last = (char)buf[0];
+	}
+	TEST_EQ(injected, 4u);
+	TEST_EQ(last, '6');
+	TEST_CHECK(usart1_port.stats.frame_drop > drop);
+}
+
+/* Exported functions --------------------------------------------------------*/
+int main(void)
+{
+	Usart1RxSemHandle = osSemaphoreNew(1u, 0u, NULL);
+	sim_uart_set_irq_hook(&huart1, BSP_USART_IRQHandler);
+	USART1_Init();
+	if (usart1_port.rx_rb_len != 0u)
+	{
+		return TEST_SKIP("test_ovr");
+	}
+	
+	test_read_rb();
+	test_receive();
+	test_read_ts();
+	test_read_frame();
+	
+	return TEST_DONE("test_ovr direct");
+}
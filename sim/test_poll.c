@@ -0,0 +1,93 @@
+/**
+  ******************************************************************************
+  * @file    test_poll.c
+  * @brief   Functional test of BSP_USART_Poll() on UART1.
+  *          Port bit is ready once the buffered data reaches the poll level,
+  *          a blocking poll wakes on data fed from another thread.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 kripac@163.com
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <pthread.h>
+#include <unistd.h>
+#include "bsp_usart.h"
+#include "usart.h"
+#include "sim_test.h"
+
+/* Private variables ---------------------------------------------------------*/
+osSemaphoreId_t			Usart1RxSemHandle;
+static uint8_t			src[64];
+static uint8_t			buf[64];
+static uint32_t			mask;
+
+/* Private functions ---------------------------------------------------------*/
+
+/* Default level, any byte after idle line */
+static void test_ready(void)
+{
+	TEST_EQ(BSP_USART_Poll(mask, 20u), 0u);
+	sim_test_burst(&huart1, src, 5u);
+	TEST_EQ(BSP_USART_Poll(mask, 20u), mask);
+	TEST_EQ(USART1_ReadRB(buf, sizeof(buf)), 5u);
+	TEST_EQ(BSP_USART_Poll(mask, 0u), 0u);
+}
+
+/* Ready only from poll level on */
+static void test_level(void)
+{
+	BSP_USART_SetPollLevel(&usart1_port, 20u);
+	sim_test_burst(&huart1, src, 16u);
+	TEST_EQ(BSP_USART_Poll(mask, 0u), 0u);
+	sim_test_burst(&huart1, src, 8u);
+	TEST_EQ(BSP_USART_Poll(mask, 0u), mask);
+	TEST_EQ(USART1_ReadRB(buf, sizeof(buf)), 24u);
+	BSP_USART_SetPollLevel(&usart1_port, 0u);
+}
+
+/* Burst ends inside the DMA buffer, a full buffer is TC without IDLE */
+static void *feeder_thread(void *arg)
+{
+	(void)arg;
+	usleep(20000u);
+	sim_test_burst(&huart1, src, 5u);
+	return NULL;
+}
+
+/* Waiting task is woken by the port event */
+static void test_wake(void)
+{
+	pthread_t	feeder;
+	uint32_t	t0 = HAL_GetTick();
+	
+	pthread_create(&feeder, NULL, feeder_thread, NULL);
+	TEST_EQ(BSP_USART_Poll(mask, 2000u), mask);
+	TEST_CHECK(HAL_GetTick() - t0 < 1000u);
+	pthread_join(feeder, NULL);
+	TEST_EQ(USART1_ReadRB(buf, sizeof(buf)), 5u);
+}
+
+/* Exported functions --------------------------------------------------------*/
+int main(void)
+{
+	Usart1RxSemHandle = osSemaphoreNew(1u, 0u, NULL);
+	TEST_EQ(BSP_USART_PollInit(), osOK);
+	USART1_Init();
+	mask = BSP_USART_PollBit(&usart1_port);
+	TEST_CHECK(mask != 0u);
+	
+	test_ready();
+	test_level();
+	test_wake();
+	
+	return TEST_DONE((usart1_port.rx_rb_len == 0u) ? "test_poll direct" : "test_poll");
+}
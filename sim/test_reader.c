@@ -0,0 +1,168 @@
+/**
+  ******************************************************************************
+  * @file    test_reader.c
+  * @brief   Functional test of port readers on UART1.
+  *          Three readers with different overrun policies share one stream,
+  *          stream byte n carries n, so every reader checks its data against
+  *          its own position. Readers need ring buffer reception, the test
+  *          is skipped in direct mode.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 kripac@163.com
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "bsp_usart.h"
+#include "usart.h"
+#include "sim_test.h"
+
+/* Private variables ---------------------------------------------------------*/
+osSemaphoreId_t			Usart1RxSemHandle;
+static BSP_USART_Reader_t	rd_block;
+static BSP_USART_Reader_t	rd_drop;
+static BSP_USART_Reader_t	rd_detach;
+static uint32_t			sent;
+
+/* Private functions ---------------------------------------------------------*/
+
+/* Next len stream bytes, ending on idle line */
+static void feed(uint16_t len)
+{
+	uint8_t		data[256];
+	uint16_t	i;
+	
+	for (i = 0u; i < len; i++)
+	{
+		data[i] = (uint8_t)(sent + i);
+	}
+	sent += len;
+	sim_test_burst(&huart1, data, len);
+}
+
+/* Read up to max bytes of a reader, 1 when each byte matches its stream offset */
+static uint32_t take(BSP_USART_Reader_t *rd, uint32_t max, uint8_t *ok)
+{
+	BSP_USART_Block_t	blk[2];
+	uint32_t			pos = rd->pos;
+	uint32_t			n = 0u;
+	uint8_t				num;
+	uint8_t				i;
+	uint16_t			k;
+	
+	*ok = 1u;
+	num = BSP_USART_ReaderPeek(&usart1_port, rd, blk);
+	for (i = 0u; i < num; i++)
+	{
+		for (k = 0u; (k < blk[i].len) && (n < max); k++, n++)
+		{
+			if (blk[i].ptr[k] != (uint8_t)(pos + n))
+			{
+				*ok = 0u;
+			}
+		}
+	}
+	BSP_USART_ReaderSkip(&usart1_port, rd, (uint16_t)n);
+	return n;
+}
+
+/* All readers keep up */
+static void test_shared(void)
+{
+	uint8_t ok;
+	
+	feed(100u);
+	TEST_EQ(BSP_USART_ReaderWait(&usart1_port, &rd_drop, 0u), HAL_OK);
+	TEST_EQ(take(&rd_block, 100u, &ok), 100u);
+	TEST_CHECK(ok);
+	TEST_EQ(take(&rd_drop, 30u, &ok), 30u);
+	TEST_CHECK(ok);
+	TEST_EQ(take(&rd_detach, 100u, &ok), 100u);
+	TEST_CHECK(ok);
+	
+	/* Ring buffer read index follows the slowest reader */
+	TEST_EQ(lwrb_get_full(&usart1_port.rx_rb), 70u);
+}
+
+/* Only the blocking reader keeps up, the others are overrun */
+static void test_overrun(void)
+{
+	BSP_USART_Block_t blk[2];
+	uint32_t	capacity = usart1_port.rx_rb.size - 1u;
+	uint32_t	fed;
+	uint32_t	n;
+	uint8_t		ok;
+	
+	/* Twice the ring buffer capacity overruns the others */
+	for (fed = 0u; fed < 2u * capacity; fed += 100u)
+	{
+		feed(100u);
+		TEST_EQ(take(&rd_block, 100u, &ok), 100u);
+		TEST_CHECK(ok);
+	}
+	TEST_EQ(rd_block.drop, 0u);
+	TEST_EQ(usart1_port.stats.rx_drop, 0u);
+	
+	/* Drop oldest keeps the newest data, consistent with its position */
+	TEST_CHECK(rd_drop.drop > 0u);
+	n = take(&rd_drop, 0xFFFFu, &ok);
+	TEST_CHECK(ok);
+	TEST_CHECK((n > 0u) && (n <= capacity));
+	TEST_EQ(rd_drop.pos, usart1_port.rx_total);
+	TEST_EQ(30u + n + rd_drop.drop, usart1_port.rx_total);
+	
+	/* Detach policy lets go of the reader */
+	TEST_EQ(rd_detach.attached, 0u);
+	TEST_EQ(BSP_USART_ReaderWait(&usart1_port, &rd_detach, 0u), HAL_ERROR);
+	TEST_EQ(BSP_USART_ReaderPeek(&usart1_port, &rd_detach, blk), 0u);
+	BSP_USART_ReaderDetach(&usart1_port, &rd_detach);
+	TEST_EQ(usart1_port.reader_num, 2u);
+}
+
+/* A blocking reader that stops reading makes the writer drop new bytes */
+static void test_block(void)
+{
+	uint32_t	capacity = usart1_port.rx_rb.size - 1u;
+	uint32_t	drop = usart1_port.stats.rx_drop;
+	uint32_t	fed = 0u;
+	uint8_t		ok;
+	
+	BSP_USART_ReaderDetach(&usart1_port, &rd_drop);
+	while (fed <= capacity)
+	{
+		feed(100u);
+		fed += 100u;
+	}
+	TEST_EQ(usart1_port.stats.rx_drop - drop, fed - capacity);
+	TEST_EQ(take(&rd_block, 0xFFFFu, &ok), capacity);
+	TEST_CHECK(ok);
+	TEST_EQ(BSP_USART_ReaderWait(&usart1_port, &rd_block, 0u), HAL_TIMEOUT);
+}
+
+/* Exported functions --------------------------------------------------------*/
+int main(void)
+{
+	Usart1RxSemHandle = osSemaphoreNew(1u, 0u, NULL);
+	USART1_Init();
+	if (usart1_port.rx_rb_len == 0u)
+	{
+		return TEST_SKIP("test_reader direct");
+	}
+	
+	TEST_EQ(BSP_USART_ReaderAttach(&usart1_port, &rd_block, BSP_USART_RD_BLOCK), HAL_OK);
+	TEST_EQ(BSP_USART_ReaderAttach(&usart1_port, &rd_drop, BSP_USART_RD_DROP_OLDEST), HAL_OK);
+	TEST_EQ(BSP_USART_ReaderAttach(&usart1_port, &rd_detach, BSP_USART_RD_DETACH), HAL_OK);
+	
+	test_shared();
+	test_overrun();
+	test_block();
+	
+	return TEST_DONE("test_reader");
+}
@@ -0,0 +1,76 @@
+/**
+  ******************************************************************************
+  * @file    test_rts.c
+  * @brief   Functional test of GPIO RTS flow control on UART1.
+  *          RTS pin goes high when the ring buffer fills to the high level
+  *          and low again once the application has read it down to the low
+  *          level. Flow control needs ring buffer reception, the test is
+  *          skipped in direct mode.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 kripac@163.com
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "bsp_usart.h"
+#include "usart.h"
+#include "sim_test.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define TEST_RTS_HIGH		(64u)
+#define TEST_RTS_LOW		(16u)
+#define TEST_RTS_PIN		(1u << 5)
+
+/* Private variables ---------------------------------------------------------*/
+osSemaphoreId_t			Usart1RxSemHandle;
+static GPIO_TypeDef		rts_gpio;
+static uint8_t			src[128];
+static uint8_t			buf[128];
+
+/* Private functions ---------------------------------------------------------*/
+static void test_hold(void)
+{
+	/* Below high level sender may go on */
+	sim_test_burst(&huart1, src, 60u);
+	TEST_EQ(rts_gpio.ODR & TEST_RTS_PIN, 0u);
+	
+	/* High level reached */
+	sim_test_burst(&huart1, src, 10u);
+	TEST_EQ(rts_gpio.ODR & TEST_RTS_PIN, TEST_RTS_PIN);
+	TEST_EQ(usart1_port.rts_held, 1u);
+	
+	/* Still held above low level */
+	TEST_EQ(USART1_ReadRB(buf, 40u), 40u);
+	TEST_EQ(rts_gpio.ODR & TEST_RTS_PIN, TEST_RTS_PIN);
+	
+	/* Released at low level */
+	TEST_EQ(USART1_ReadRB(buf, 20u), 20u);
+	TEST_EQ(rts_gpio.ODR & TEST_RTS_PIN, 0u);
+	TEST_EQ(usart1_port.rts_held, 0u);
+	TEST_EQ(usart1_port.stats.rts_hold, 1u);
+	TEST_EQ(usart1_port.stats.rx_drop, 0u);
+}
+
+/* Exported functions --------------------------------------------------------*/
+int main(void)
+{
+	Usart1RxSemHandle = osSemaphoreNew(1u, 0u, NULL);
+	BSP_USART_SetRtsFlow(&usart1_port, TEST_RTS_HIGH, TEST_RTS_LOW, &rts_gpio, TEST_RTS_PIN);
+	USART1_Init();
+	if (usart1_port.rx_rb_len == 0u)
+	{
+		return TEST_SKIP("test_rts direct");
+	}
+	
+	test_hold();
+	
+	return TEST_DONE("test_rts");
+}
@@ -0,0 +1,140 @@
+/**
+  ******************************************************************************
+  * @file    test_tpl.cpp
+  * @brief   Functional test of bsp::UsartPort on UART2.
+  *          Data through DMA wraps and ring buffer, statistics, overflow,
+  *          blocking receive and restart after a receive error, with the
+  *          DMA buffer in the template and handed in.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 kripac@163.com
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "bsp_usart.hpp"
+#include "usart.h"
+#include "sim_test.h"
+
+/* Private variables ---------------------------------------------------------*/
+extern "C" { osSemaphoreId_t Usart1RxSemHandle; }
+static osSemaphoreId_t	Usart2RxSemHandle;
+static osSemaphoreId_t	Usart3RxSemHandle;
+static uint8_t			usart3_dma[32] USART_DMA_MEM;
+
+static bsp::UsartPort<huart2, Usart2RxSemHandle, 32, 64>				usart2;
+static bsp::UsartPort<huart3, Usart3RxSemHandle, 32, 64, usart3_dma>	usart3;
+
+extern "C" { BSP_USART_DECLARE(USART2); }
+BSP_USART_TPL_WRAPPERS(USART2, usart2)
+
+static uint8_t			src[256];
+
+/* Private functions ---------------------------------------------------------*/
+
+/* Bursts of 37 bytes wrap the 32 byte DMA buffer, each read back at once */
+template <typename Port>
+static void test_stream(Port &port, UART_HandleTypeDef &huart)
+{
+	BSP_USART_Stats_t	stats;
+	uint8_t				buf[64];
+	uint32_t			got = 0u;
+	uint32_t			bad = 0u;
+	uint32_t			k;
+	uint16_t			n;
+	uint16_t			i;
+	
+	port.Init();
+	for (k = 0u; k < 20u; k++)
+	{
+		sim_test_burst(&huart, &src[k * 7u], 37u);
+		n = port.ReadRB(buf, sizeof(buf));
+		for (i = 0u; i < n; i++)
+		{
+			bad += (buf[i] != src[k * 7u + i]) ? 1u : 0u;
+		}
+		got += n;
+	}
+	TEST_EQ(got, 20u * 37u);
+	TEST_EQ(bad, 0u);
+	
+	port.GetStats(&stats);
+	TEST_EQ(stats.rx_bytes, 20u * 37u);
+	TEST_EQ(stats.rx_drop, 0u);
+	TEST_EQ(stats.dma_wrap, 20u * 37u / 32u);
+	TEST_CHECK(stats.evt_idle != 0u);
+	TEST_CHECK(stats.evt_ht != 0u);
+	TEST_CHECK(stats.rb_peak <= 37u);
+	
+	/* Nothing read, 64 byte ring buffer drops the rest */
+	sim_test_burst(&huart, src, 100u);
+	port.GetStats(&stats);
+	TEST_EQ(stats.rx_drop, 36u);
+	TEST_EQ(stats.rb_peak, 64u);
+	TEST_EQ(port.ReadRB(buf, sizeof(buf)), 64u);
+	TEST_CHECK(memcmp(buf, src, 64u) == 0);
+	port.ResetStats();
+	port.GetStats(&stats);
+	TEST_EQ(stats.rx_bytes, 0u);
+}
+
+/* Error restarts DMA at buffer start, bytes before it stay readable */
+static void test_error(void)
+{
+	BSP_USART_Stats_t	stats;
+	uint8_t				buf[32];
+	
+	usart2.Reset();
+	sim_uart_rx(&huart2, src, 10u);
+	sim_uart_error(&huart2, HAL_UART_ERROR_FE);
+	sim_test_burst(&huart2, &src[20], 5u);
+	TEST_EQ(USART2_ReadRB(buf, sizeof(buf)), 15u);
+	TEST_CHECK(memcmp(buf, src, 10u) == 0);
+	TEST_CHECK(memcmp(&buf[10], &src[20], 5u) == 0);
+	usart2.GetStats(&stats);
+	TEST_EQ(stats.err_cnt, 1u);
+	TEST_EQ(stats.err_fe, 1u);
+	TEST_EQ(stats.err_drop, 1u);
+}
+
+/* Blocking receive, data ready and timeout, polling transmit counted */
+static void test_receive(void)
+{
+	BSP_USART_Stats_t	stats;
+	uint8_t				buf[16];
+	
+	sim_test_burst(&huart2, src, 10u);
+	TEST_EQ(USART2_Receive(buf, 10u, 10u), HAL_OK);
+	TEST_CHECK(memcmp(buf, src, 10u) == 0);
+	TEST_EQ(USART2_Receive(buf, 1u, 5u), HAL_TIMEOUT);
+	TEST_EQ(USART2_Transmit(src, 12u, 10u), HAL_OK);
+	usart2.GetStats(&stats);
+	TEST_EQ(stats.tx_bytes, 12u);
+}
+
+/* Exported functions --------------------------------------------------------*/
+int main(void)
+{
+	uint32_t i;
+	
+	for (i = 0u; i < sizeof(src); i++)
+	{
+		src[i] = (uint8_t)(i * 13u + 5u);
+	}
+	Usart2RxSemHandle = osSemaphoreNew(1u, 0u, NULL);
+	Usart3RxSemHandle = osSemaphoreNew(1u, 0u, NULL);
+	
+	test_stream(usart2, huart2);
+	test_stream(usart3, huart3);
+	test_error();
+	test_receive();
+	
+	return TEST_DONE("test_tpl");
+}
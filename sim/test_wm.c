@@ -0,0 +1,97 @@
+/**
+  ******************************************************************************
+  * @file    test_wm.c
+  * @brief   Functional test of RX watermarks on UART1.
+  *          A continuous stream has no idle gap, port semaphore is released
+  *          on HT/TC once the buffered data reaches the watermark, below it
+  *          only IDLE releases it.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 kripac@163.com
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "bsp_usart.h"
+#include "usart.h"
+#include "sim_test.h"
+
+/* Private variables ---------------------------------------------------------*/
+osSemaphoreId_t			Usart1RxSemHandle;
+static uint8_t			src[256];
+static uint8_t			buf[256];
+
+/* Private functions ---------------------------------------------------------*/
+
+/* HT at half, TC at end of the DMA buffer */
+static void test_level(void)
+{
+	uint32_t half = usart1_port.rx_dma_len / 2u;
+	
+	BSP_USART_SetRxWatermark(&usart1_port, (uint16_t)(half - half / 4u));
+	
+	/* No event before HT */
+	sim_uart_rx(&huart1, src, half / 2u);
+	TEST_CHECK(!sim_test_released(Usart1RxSemHandle));
+	
+	/* HT with watermark reached */
+	sim_uart_rx(&huart1, &src[half / 2u], half - half / 2u);
+	TEST_CHECK(sim_test_released(Usart1RxSemHandle));
+	TEST_EQ(USART1_ReadRB(buf, sizeof(buf)), half);
+	
+	/* TC with watermark reached */
+	sim_uart_rx(&huart1, src, half);
+	TEST_CHECK(sim_test_released(Usart1RxSemHandle));
+	TEST_EQ(USART1_ReadRB(buf, sizeof(buf)), half);
+	
+	/* HT below watermark waits for IDLE */
+	BSP_USART_SetRxWatermark(&usart1_port, (uint16_t)(half + 1u));
+	sim_uart_rx(&huart1, src, half);
+	TEST_CHECK(!sim_test_released(Usart1RxSemHandle));
+	sim_uart_rx(&huart1, src, 1u);
+	sim_uart_idle(&huart1);
+	TEST_CHECK(sim_test_released(Usart1RxSemHandle));
+	TEST_EQ(USART1_ReadRB(buf, sizeof(buf)), half + 1u);
+	
+	/* 0 is IDLE only */
+	BSP_USART_SetRxWatermark(&usart1_port, 0u);
+	sim_uart_rx(&huart1, src, half);
+	TEST_CHECK(!sim_test_released(Usart1RxSemHandle));
+	sim_uart_idle(&huart1);
+	TEST_CHECK(sim_test_released(Usart1RxSemHandle));
+	TEST_EQ(USART1_ReadRB(buf, sizeof(buf)), half);
+}
+
+/* Percentage of ring buffer capacity, rounded up */
+static void test_pct(void)
+{
+	uint32_t capacity = usart1_port.rx_rb.size - 1u;
+	
+	BSP_USART_SetRxWatermarkPct(&usart1_port, 50u);
+	TEST_EQ(usart1_port.rx_notify_level, (capacity * 50u + 99u) / 100u);
+	BSP_USART_SetRxWatermarkPct(&usart1_port, 100u);
+	TEST_EQ(usart1_port.rx_notify_level, capacity);
+	BSP_USART_SetRxWatermarkPct(&usart1_port, 1u);
+	TEST_CHECK(usart1_port.rx_notify_level >= 1u);
+	BSP_USART_SetRxWatermarkPct(&usart1_port, 0u);
+	TEST_EQ(usart1_port.rx_notify_level, 0u);
+}
+
+/* Exported functions --------------------------------------------------------*/
+int main(void)
+{
+	Usart1RxSemHandle = osSemaphoreNew(1u, 0u, NULL);
+	USART1_Init();
+	
+	test_level();
+	test_pct();
+	
+	return TEST_DONE((usart1_port.rx_rb_len == 0u) ? "test_wm direct" : "test_wm");
+}